@@ -14,7 +14,11 @@ uniform mat4 model;
 
 const int MAX_BONES = 100;
 const int MAX_BONE_INFLUENCE = 4;
-uniform mat4 finalBonesMatrices[MAX_BONES];
+// streamed every frame by the application, see upload_bone_palette
+layout (std140) uniform BonePalette
+{
+    mat4 finalBonesMatrices[MAX_BONES];
+};
 
 out vec2 TexCoords;
 
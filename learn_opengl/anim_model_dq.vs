@@ -0,0 +1,66 @@
+#version 330 core
+
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 tex;
+layout(location = 3) in vec3 tangent;
+layout(location = 4) in vec3 bitangent;
+layout(location = 5) in ivec4 boneIds; 
+layout(location = 6) in vec4 weights;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform mat4 model;
+
+const int MAX_BONES = 100;
+const int MAX_BONE_INFLUENCE = 4;
+// two vec4 per bone: [2*i] rotation quaternion, [2*i+1] dual (translation) part
+layout (std140) uniform BonePaletteDQ
+{
+    vec4 finalBonesDQ[MAX_BONES * 2];
+};
+
+out vec2 TexCoords;
+
+void main()
+{
+    vec4 blendReal = vec4(0.0f);
+    vec4 blendDual = vec4(0.0f);
+    vec4 pivot = vec4(0.0f);
+    bool outOfRange = false;
+    for(int i = 0 ; i < MAX_BONE_INFLUENCE ; i++)
+    {
+        if(boneIds[i] == -1) 
+            continue;
+        if(boneIds[i] >=MAX_BONES) 
+        {
+            outOfRange = true;
+            break;
+        }
+        vec4 real = finalBonesDQ[boneIds[i] * 2];
+        vec4 dual = finalBonesDQ[boneIds[i] * 2 + 1];
+        // q and -q are the same rotation: keep every influence on the first one's hemisphere
+        if(pivot == vec4(0.0f))
+            pivot = real;
+        float w = dot(pivot, real) < 0.0f ? -weights[i] : weights[i];
+        blendReal += real * w;
+        blendDual += dual * w;
+    }
+
+    vec3 totalPosition = pos;
+    vec3 totalNormal = norm;
+    float len = length(blendReal);
+    if(!outOfRange && len > 0.0f)
+    {
+        blendReal /= len;
+        blendDual /= len;
+        vec3 r = blendReal.xyz;
+        vec3 t = 2.0f * (blendReal.w * blendDual.xyz - blendDual.w * r + cross(r, blendDual.xyz));
+        totalPosition = pos + 2.0f * cross(r, cross(r, pos) + blendReal.w * pos) + t;
+        totalNormal = norm + 2.0f * cross(r, cross(r, norm) + blendReal.w * norm);
+    }
+	
+    mat4 viewModel = view * model;
+    gl_Position =  projection * viewModel * vec4(totalPosition, 1.0f);
+	TexCoords = tex;
+}
\ No newline at end of file
@@ -7,6 +7,7 @@
 #include "assimp/Importer.hpp"
 #include "animation.h"
 #include "bone.h"
+#include "dual_quaternion.h"
 
 class Animator
 {
@@ -20,6 +21,8 @@ public:
 
 		for (int i = 0; i < 100; i++)
 			m_FinalBoneMatrices.push_back(glm::mat4(1.0f));
+
+		m_FinalBoneDualQuats.resize(m_FinalBoneMatrices.size());
 	}
 
 	void UpdateAnimation(float dt)
@@ -71,6 +74,13 @@ public:
 		return m_FinalBoneMatrices;
 	}
 
+	// same palette as GetFinalBoneMatrices() packed as dual quaternions (2 vec4 per bone)
+	const std::vector<DualQuat>& GetFinalBoneDualQuats()
+	{
+		DualQuatHelpers::FromMatrices(&m_FinalBoneMatrices[0], &m_FinalBoneDualQuats[0], (int)m_FinalBoneMatrices.size());
+		return m_FinalBoneDualQuats;
+	}
+
 	void set_animation(Animation* animation)
 	{
 	    m_CurrentAnimation = animation;
@@ -78,6 +88,7 @@ public:
 
 private:
 	std::vector<glm::mat4> m_FinalBoneMatrices;
+	std::vector<DualQuat> m_FinalBoneDualQuats;
 	Animation* m_CurrentAnimation;
 	float m_CurrentTime;
 	float m_DeltaTime;
@@ -0,0 +1,169 @@
+#ifndef AUTO_EXPOSURE_H
+#define AUTO_EXPOSURE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "shader.h"
+
+#include <cmath>
+#include <iostream>
+
+#define AUTO_EXPOSURE_READBACK_FRAMES 3 // pixel buffers the adapted luminance is read back through
+
+// Automatic exposure from a log luminance histogram, built and reduced on the GPU without compute shaders.
+//
+// Histogram pass: one point per gridScale x gridScale block of the HDR buffer, drawn into a binCount x 1
+// R32F target with additive blending. The vertex shader takes the block's luminance (one bilinear tap)
+// and moves the point onto its log2 bin.
+// Adapt pass: a single point whose fragment averages the bins between lowPercent and highPercent of the
+// pixels, so a few lamps or a black corner don't swing the exposure, and moves the adapted log2 luminance
+// towards that, exponentially at adaptationSpeed per second. The result stays in a 1x1 texture the tone
+// mapping pass reads; it is only read back for display, through a ring of pixel buffers, a few frames late.
+class AutoExposure
+{
+public:
+    float minLogLuminance, maxLogLuminance; // log2 range of the histogram, anything outside lands in the end bins
+    float lowPercent, highPercent;
+    float adaptationSpeed;
+    float averageLuminance; // the adapted luminance as last read back; 0 until the first readback arrives
+
+    // width and height are the HDR buffer's, the viewport is set back to them after Update()
+    AutoExposure(int width, int height, int gridScale = 4, int binCount = 64)
+        : minLogLuminance(-10.0f), maxLogLuminance(8.0f), lowPercent(0.5f), highPercent(0.95f), adaptationSpeed(1.5f),
+          averageLuminance(0.0f), width(width), height(height), binCount(binCount), current(0), frame(0), valid(false)
+    {
+        gridWidth = width / gridScale;
+        gridHeight = height / gridScale;
+
+        // points need no vertex data, the core profile still wants a vertex array bound
+        glGenVertexArrays(1, &emptyVAO);
+
+        glGenTextures(1, &histogram);
+        glGenTextures(2, adapted);
+        glGenFramebuffers(1, &histogramFBO);
+        glGenFramebuffers(2, adaptedFBO);
+        createTarget(histogramFBO, histogram, binCount);
+        for (int i = 0; i < 2; i++)
+            createTarget(adaptedFBO[i], adapted[i], 1);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        lastWritten = adapted[0];
+
+        glGenBuffers(AUTO_EXPOSURE_READBACK_FRAMES, readbackPBO);
+        for (int i = 0; i < AUTO_EXPOSURE_READBACK_FRAMES; i++)
+        {
+            glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackPBO[i]);
+            glBufferData(GL_PIXEL_PACK_BUFFER, sizeof(float), NULL, GL_STREAM_READ);
+            readbackFences[i] = 0;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    // builds the histogram of hdrTexture and adapts towards it; deltaTime in seconds.
+    // Leaves framebuffer 0 bound and blending disabled
+    void Update(Shader &histogramShader, Shader &adaptShader, unsigned int hdrTexture, float deltaTime)
+    {
+        float logLuminanceRange = maxLogLuminance - minLogLuminance;
+        glBindVertexArray(emptyVAO);
+
+        // 1. one point per block, counted into its bin
+        glBindFramebuffer(GL_FRAMEBUFFER, histogramFBO);
+        glViewport(0, 0, binCount, 1);
+        const float zero[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+        glClearBufferfv(GL_COLOR, 0, zero);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        histogramShader.use();
+        histogramShader.setInt("hdrBuffer", 0);
+        histogramShader.setInt("gridWidth", gridWidth);
+        histogramShader.setInt("gridHeight", gridHeight);
+        histogramShader.setInt("binCount", binCount);
+        histogramShader.setFloat("minLogLuminance", minLogLuminance);
+        histogramShader.setFloat("logLuminanceRange", logLuminanceRange);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, hdrTexture);
+        glDrawArrays(GL_POINTS, 0, gridWidth * gridHeight);
+        glDisable(GL_BLEND);
+
+        // 2. reduce it to one log luminance and blend it into last frame's
+        glBindFramebuffer(GL_FRAMEBUFFER, adaptedFBO[current]);
+        glViewport(0, 0, 1, 1);
+        adaptShader.use();
+        adaptShader.setInt("histogram", 0);
+        adaptShader.setInt("previous", 1);
+        adaptShader.setInt("binCount", binCount);
+        adaptShader.setFloat("minLogLuminance", minLogLuminance);
+        adaptShader.setFloat("logLuminanceRange", logLuminanceRange);
+        adaptShader.setFloat("lowPercent", lowPercent);
+        adaptShader.setFloat("highPercent", highPercent);
+        adaptShader.setFloat("blend", 1.0f - std::exp(-deltaTime * adaptationSpeed));
+        adaptShader.setInt("reset", !valid);
+        glBindTexture(GL_TEXTURE_2D, histogram);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, adapted[1 - current]);
+        glDrawArrays(GL_POINTS, 0, 1);
+        glActiveTexture(GL_TEXTURE0);
+
+        // 3. queue a copy of the result into this frame's pixel buffer, once the copy made into it a few frames ago has been read
+        int slot = frame % AUTO_EXPOSURE_READBACK_FRAMES;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, readbackPBO[slot]);
+        if (readbackFences[slot])
+        {
+            GLenum status = glClientWaitSync(readbackFences[slot], 0, 0);
+            if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+            {
+                float logLuminance = 0.0f;
+                glGetBufferSubData(GL_PIXEL_PACK_BUFFER, 0, sizeof(float), &logLuminance);
+                averageLuminance = std::exp2(logLuminance);
+                glDeleteSync(readbackFences[slot]);
+                readbackFences[slot] = 0;
+            }
+        }
+        if (!readbackFences[slot])
+        {
+            glReadPixels(0, 0, 1, 1, GL_RED, GL_FLOAT, 0);
+            readbackFences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glBindVertexArray(0);
+        glViewport(0, 0, width, height);
+        lastWritten = adapted[current];
+        current = 1 - current;
+        valid = true;
+        frame++;
+    }
+
+    // 1x1 R32F texture holding the adapted log2 luminance, for the tone mapping pass
+    unsigned int Result() const { return lastWritten; }
+
+    // the next Update() jumps straight to the current luminance instead of adapting to it
+    void Reset() { valid = false; }
+
+private:
+    int width, height;
+    int gridWidth, gridHeight;
+    int binCount;
+    unsigned int emptyVAO;
+    unsigned int histogram, histogramFBO;
+    unsigned int adapted[2], adaptedFBO[2];
+    unsigned int lastWritten;
+    int current;
+    unsigned int frame;
+    bool valid;
+    unsigned int readbackPBO[AUTO_EXPOSURE_READBACK_FRAMES];
+    GLsync readbackFences[AUTO_EXPOSURE_READBACK_FRAMES];
+
+    void createTarget(unsigned int fbo, unsigned int texture, int size)
+    {
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, size, 1, 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::AUTO_EXPOSURE: framebuffer not complete" << std::endl;
+    }
+};
+#endif
@@ -0,0 +1,147 @@
+#ifndef CASCADED_SHADOW_MAP_H
+#define CASCADED_SHADOW_MAP_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "shader.h"
+
+#include <string>
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+
+#define MAX_SHADOW_CASCADES 4 // must match the shaders' arrays
+
+// Cascaded shadow map for a directional light.
+//
+// The camera frustum, up to shadowDistance, is cut at practical split distances: a blend, by splitLambda,
+// of logarithmic and uniform splits. Each slice gets an orthographic projection around its smallest
+// bounding sphere. The sphere keeps its size as the camera turns, and its center is snapped to whole
+// shadow map texels in light space, so shadow edges don't shimmer while the camera moves. Every cascade
+// is a layer of one depth texture array, all rendered in a single pass by a geometry shader writing
+// gl_Layer; depth clamping keeps the casters in front of a cascade's near plane.
+class CascadedShadowMap
+{
+public:
+    unsigned int ID;  // GL_TEXTURE_2D_ARRAY, one depth layer per cascade
+    unsigned int FBO; // the whole array attached, layered
+    int resolution, cascadeCount;
+    float splitLambda; // 0: uniform splits, 1: logarithmic
+    glm::mat4 lightSpaceMatrices[MAX_SHADOW_CASCADES];
+    float cascadeFar[MAX_SHADOW_CASCADES]; // view space distance each cascade ends at
+
+    CascadedShadowMap(int resolution, int cascadeCount, float splitLambda = 0.75f)
+        : resolution(resolution), cascadeCount(std::min(cascadeCount, MAX_SHADOW_CASCADES)), splitLambda(splitLambda)
+    {
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, ID);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, this->cascadeCount, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+        float borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
+        glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, ID, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::CASCADED_SHADOW_MAP: framebuffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        for (int i = 0; i < MAX_SHADOW_CASCADES; i++)
+        {
+            lightSpaceMatrices[i] = glm::mat4(1.0f);
+            cascadeFar[i] = 0.0f;
+        }
+    }
+
+    // fits the cascades to the camera; fovy in radians, lightDir points towards the light.
+    // Returns a bit per cascade whose matrix changed, whose cached shadows are out of date
+    unsigned int Update(const glm::mat4 &view, float fovy, float aspect, float zNear, float shadowDistance, const glm::vec3 &lightDir)
+    {
+        glm::mat4 inverseView = glm::inverse(view);
+        // rotation only, so snapping in light space stays on the same texel grid from frame to frame
+        glm::vec3 up = std::abs(lightDir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        glm::mat4 lightView = glm::lookAt(glm::vec3(0.0f), -lightDir, up);
+        float tanY = std::tan(fovy * 0.5f);
+        // squared distance of a frustum corner from the view axis, per unit of depth
+        float corner = tanY * tanY * (1.0f + aspect * aspect);
+
+        float nearPlane = zNear;
+        unsigned int changed = 0;
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            float t = float(i + 1) / cascadeCount;
+            float logSplit = zNear * std::pow(shadowDistance / zNear, t);
+            float uniformSplit = zNear + (shadowDistance - zNear) * t;
+            float farPlane = splitLambda * logSplit + (1.0f - splitLambda) * uniformSplit;
+            cascadeFar[i] = farPlane;
+
+            // smallest sphere around the slice: its center sits on the view axis, equally far from the near
+            // and far corners, unless that falls past the far plane
+            float nearSq = nearPlane * nearPlane * corner, farSq = farPlane * farPlane * corner;
+            float centerDepth = ((farPlane * farPlane - nearPlane * nearPlane) + (farSq - nearSq)) / (2.0f * (farPlane - nearPlane));
+            centerDepth = std::min(centerDepth, farPlane);
+            float radius = std::sqrt((centerDepth - nearPlane) * (centerDepth - nearPlane) + nearSq);
+            radius = std::max(radius, std::sqrt(farSq + (farPlane - centerDepth) * (farPlane - centerDepth)));
+            radius = std::ceil(radius * 16.0f) / 16.0f; // keep it from creeping with float error
+
+            glm::vec3 center = glm::vec3(inverseView * glm::vec4(0.0f, 0.0f, -centerDepth, 1.0f));
+            glm::vec3 centerLS = glm::vec3(lightView * glm::vec4(center, 1.0f));
+            // two texels of margin on each side: snapping moves the center by up to one, PCF reads one further
+            float texelSize = 2.0f * radius / (resolution - 4);
+            float halfExtent = 0.5f * texelSize * resolution;
+            centerLS.x = std::floor(centerLS.x / texelSize) * texelSize;
+            centerLS.y = std::floor(centerLS.y / texelSize) * texelSize;
+            // depth too, in steps of an eighth of the radius, so moving along the light direction keeps the matrix
+            // (and the cached cascade) until a step is crossed; the range grows by a step to still hold the sphere
+            // and depth clamping keeps the casters in front of it
+            float depthStep = radius / 8.0f;
+            centerLS.z = std::floor(centerLS.z / depthStep) * depthStep;
+
+            glm::mat4 lightProjection = glm::ortho(centerLS.x - halfExtent, centerLS.x + halfExtent, centerLS.y - halfExtent, centerLS.y + halfExtent,
+                                                   -(centerLS.z + radius + depthStep), -(centerLS.z - radius));
+            glm::mat4 lightSpaceMatrix = lightProjection * lightView;
+            if (lightSpaceMatrix != lightSpaceMatrices[i])
+                changed |= 1u << i;
+            lightSpaceMatrices[i] = lightSpaceMatrix;
+            nearPlane = farPlane;
+        }
+        return changed;
+    }
+
+    // binds the layered framebuffer for the depth pass, cleared, with depth clamping on
+    void BeginRender()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, resolution, resolution);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        glEnable(GL_DEPTH_CLAMP);
+    }
+
+    void EndRender(int screenWidth, int screenHeight)
+    {
+        glDisable(GL_DEPTH_CLAMP);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, screenWidth, screenHeight);
+    }
+
+    // lightSpaceMatrices[], cascadePlaneDistances[] and cascadeCount, for the depth and the lighting shaders
+    void SetUniforms(const Shader &shader) const
+    {
+        shader.setInt("cascadeCount", cascadeCount);
+        for (int i = 0; i < cascadeCount; i++)
+        {
+            shader.setMat4("lightSpaceMatrices[" + std::to_string(i) + "]", lightSpaceMatrices[i]);
+            shader.setFloat("cascadePlaneDistances[" + std::to_string(i) + "]", cascadeFar[i]);
+        }
+    }
+};
+#endif
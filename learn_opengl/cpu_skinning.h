@@ -0,0 +1,178 @@
+#pragma once
+
+/* CPU version of the anim_model.vs skinning: posed positions, normals and bounds without a GPU */
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include "glm/glm.hpp"
+#include "mesh_animation.h"
+
+#if !defined(CPU_SKINNING_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CPU_SKINNING_SSE 1
+#endif
+
+struct SkinnedBounds
+{
+	glm::vec3 min;
+	glm::vec3 max;
+};
+
+class CpuSkinning
+{
+public:
+
+	// skins every vertex with the given palette (usually Animator::GetFinalBoneMatrices()).
+	// positions/normals are resized to vertices.size(); the returned box encloses all posed positions.
+	// threadCount <= 0 uses every hardware thread.
+	static SkinnedBounds Skin(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette,
+		std::vector<glm::vec3>& positions, std::vector<glm::vec3>& normals, int threadCount = 0)
+	{
+		int count = (int)vertices.size();
+		positions.resize(count);
+		normals.resize(count);
+
+		SkinnedBounds bounds;
+		bounds.min = glm::vec3(FLT_MAX);
+		bounds.max = glm::vec3(-FLT_MAX);
+		if (count == 0)
+			return bounds;
+
+		if (threadCount <= 0)
+			threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+		// small meshes aren't worth the thread start-up
+		threadCount = std::min(threadCount, std::max(1, count / 4096));
+
+		std::vector<SkinnedBounds> partial(threadCount);
+		std::vector<std::thread> workers;
+		int chunk = (count + threadCount - 1) / threadCount;
+		for (int t = 1; t < threadCount; t++)
+		{
+			int begin = std::min(count, t * chunk);
+			int end = std::min(count, begin + chunk);
+			workers.push_back(std::thread(SkinRange, &vertices[0], begin, end, &palette[0], (int)palette.size(),
+				&positions[0], &normals[0], &partial[t]));
+		}
+		SkinRange(&vertices[0], 0, std::min(count, chunk), &palette[0], (int)palette.size(), &positions[0], &normals[0], &partial[0]);
+		for (unsigned int i = 0; i < workers.size(); i++)
+			workers[i].join();
+
+		for (int t = 0; t < threadCount; t++)
+		{
+			bounds.min = glm::min(bounds.min, partial[t].min);
+			bounds.max = glm::max(bounds.max, partial[t].max);
+		}
+		return bounds;
+	}
+
+	// skins vertices [begin, end) on the calling thread. Matches anim_model.vs except that a vertex
+	// without any bone influence keeps its bind pose instead of collapsing to the origin.
+	static void SkinRange(const Vertex* vertices, int begin, int end, const glm::mat4* palette, int paletteSize,
+		glm::vec3* positions, glm::vec3* normals, SkinnedBounds* bounds)
+	{
+#ifdef CPU_SKINNING_SSE
+		__m128 boxMin = _mm_set1_ps(FLT_MAX);
+		__m128 boxMax = _mm_set1_ps(-FLT_MAX);
+		for (int v = begin; v < end; v++)
+		{
+			const Vertex& vertex = vertices[v];
+			__m128 c0, c1, c2, c3;
+			if (!BlendPalette(vertex, palette, paletteSize, c0, c1, c2, c3))
+			{
+				c0 = _mm_setr_ps(1.0f, 0.0f, 0.0f, 0.0f);
+				c1 = _mm_setr_ps(0.0f, 1.0f, 0.0f, 0.0f);
+				c2 = _mm_setr_ps(0.0f, 0.0f, 1.0f, 0.0f);
+				c3 = _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f);
+			}
+
+			__m128 p = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Position.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Position.y))),
+				_mm_add_ps(_mm_mul_ps(c2, _mm_set1_ps(vertex.Position.z)), c3));
+			__m128 n = _mm_add_ps(_mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(vertex.Normal.x)), _mm_mul_ps(c1, _mm_set1_ps(vertex.Normal.y))),
+				_mm_mul_ps(c2, _mm_set1_ps(vertex.Normal.z)));
+			n = _mm_and_ps(n, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0)));
+
+			// renormalize, blended matrices aren't orthonormal
+			__m128 n2 = _mm_mul_ps(n, n);
+			n2 = _mm_add_ps(n2, _mm_shuffle_ps(n2, n2, _MM_SHUFFLE(2, 3, 0, 1)));
+			n2 = _mm_add_ps(n2, _mm_shuffle_ps(n2, n2, _MM_SHUFFLE(1, 0, 3, 2)));
+			n = _mm_mul_ps(n, _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(_mm_max_ps(n2, _mm_set1_ps(1e-20f)))));
+
+			boxMin = _mm_min_ps(boxMin, p);
+			boxMax = _mm_max_ps(boxMax, p);
+
+			float out[4];
+			_mm_storeu_ps(out, p);
+			positions[v] = glm::vec3(out[0], out[1], out[2]);
+			_mm_storeu_ps(out, n);
+			normals[v] = glm::vec3(out[0], out[1], out[2]);
+		}
+		float lo[4], hi[4];
+		_mm_storeu_ps(lo, boxMin);
+		_mm_storeu_ps(hi, boxMax);
+		bounds->min = glm::vec3(lo[0], lo[1], lo[2]);
+		bounds->max = glm::vec3(hi[0], hi[1], hi[2]);
+#else
+		bounds->min = glm::vec3(FLT_MAX);
+		bounds->max = glm::vec3(-FLT_MAX);
+		for (int v = begin; v < end; v++)
+		{
+			const Vertex& vertex = vertices[v];
+			glm::mat4 skin(0.0f);
+			bool skinned = false;
+			for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+			{
+				int id = vertex.m_BoneIDs[i];
+				if (id == -1)
+					continue;
+				if (id >= paletteSize)
+				{
+					skinned = false;
+					break;
+				}
+				skin += palette[id] * vertex.m_Weights[i];
+				skinned = true;
+			}
+			if (!skinned)
+				skin = glm::mat4(1.0f);
+
+			glm::vec3 p = glm::vec3(skin * glm::vec4(vertex.Position, 1.0f));
+			glm::vec3 n = glm::mat3(skin) * vertex.Normal;
+			float len = glm::length(n);
+			positions[v] = p;
+			normals[v] = len > 0.0f ? n / len : n;
+			bounds->min = glm::min(bounds->min, p);
+			bounds->max = glm::max(bounds->max, p);
+		}
+#endif
+	}
+
+private:
+#ifdef CPU_SKINNING_SSE
+	// weighted sum of the influencing bone matrices, column by column
+	static inline bool BlendPalette(const Vertex& vertex, const glm::mat4* palette, int paletteSize,
+		__m128& c0, __m128& c1, __m128& c2, __m128& c3)
+	{
+		c0 = c1 = c2 = c3 = _mm_setzero_ps();
+		bool skinned = false;
+		for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+		{
+			int id = vertex.m_BoneIDs[i];
+			if (id == -1)
+				continue;
+			if (id >= paletteSize)
+				return false;
+			const float* m = &palette[id][0][0];
+			__m128 w = _mm_set1_ps(vertex.m_Weights[i]);
+			c0 = _mm_add_ps(c0, _mm_mul_ps(_mm_loadu_ps(m), w));
+			c1 = _mm_add_ps(c1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+			c2 = _mm_add_ps(c2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+			c3 = _mm_add_ps(c3, _mm_mul_ps(_mm_loadu_ps(m + 12), w));
+			skinned = true;
+		}
+		return skinned;
+	}
+#endif
+};
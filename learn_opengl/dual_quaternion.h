@@ -0,0 +1,150 @@
+#pragma once
+
+/* Dual quaternion bone palette: two vec4s per bone instead of a full mat4 */
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+#include "glm/glm.hpp"
+#include "glm/gtc/quaternion.hpp"
+
+#if !defined(DUAL_QUATERNION_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define DUAL_QUATERNION_SSE 1
+#endif
+
+enum SkinningMode {
+	SKINNING_LINEAR,         // finalBonesMatrices[] : 4 vec4 per bone
+	SKINNING_DUAL_QUATERNION // finalBonesDQ[]       : 2 vec4 per bone
+};
+
+struct DualQuat
+{
+	/*rotation quaternion stored as (x, y, z, w)*/
+	glm::vec4 real;
+
+	/*0.5 * translation * real, stored as (x, y, z, w)*/
+	glm::vec4 dual;
+};
+
+class DualQuatHelpers
+{
+public:
+
+	// converts a rigid bone matrix to a unit dual quaternion. Any scale left in the
+	// matrix is dropped, so the palette should only hold rotation and translation.
+	static inline DualQuat FromMatrix(const glm::mat4& m)
+	{
+		DualQuat dq;
+#ifdef DUAL_QUATERNION_SSE
+		__m128 c0 = _mm_loadu_ps(&m[0][0]);
+		__m128 c1 = _mm_loadu_ps(&m[1][0]);
+		__m128 c2 = _mm_loadu_ps(&m[2][0]);
+		__m128 t  = _mm_loadu_ps(&m[3][0]);
+
+		// normalize the three basis columns so uniform scale doesn't leak into the rotation
+		c0 = _mm_mul_ps(c0, InverseLength3(c0));
+		c1 = _mm_mul_ps(c1, InverseLength3(c1));
+		c2 = _mm_mul_ps(c2, InverseLength3(c2));
+
+		float r0[4], r1[4], r2[4];
+		_mm_storeu_ps(r0, c0);
+		_mm_storeu_ps(r1, c1);
+		_mm_storeu_ps(r2, c2);
+
+		// 4 * {x,y,z,w}^2 from the diagonal; the largest one is divided into the off-diagonal terms
+		__m128 d0 = _mm_set1_ps(r0[0]);
+		__m128 d1 = _mm_set1_ps(r1[1]);
+		__m128 d2 = _mm_set1_ps(r2[2]);
+		__m128 s0 = _mm_setr_ps( 1.0f, -1.0f, -1.0f, 1.0f);
+		__m128 s1 = _mm_setr_ps(-1.0f,  1.0f, -1.0f, 1.0f);
+		__m128 s2 = _mm_setr_ps(-1.0f, -1.0f,  1.0f, 1.0f);
+		__m128 sum = _mm_add_ps(_mm_set1_ps(1.0f), _mm_mul_ps(s0, d0));
+		sum = _mm_add_ps(sum, _mm_mul_ps(s1, d1));
+		sum = _mm_add_ps(sum, _mm_mul_ps(s2, d2));
+		float s[4];
+		_mm_storeu_ps(s, sum);
+
+		int k = 3;
+		for (int i = 0; i < 3; i++)
+			if (s[i] > s[k])
+				k = i;
+
+		__m128 num;
+		if (k == 3)
+			num = _mm_setr_ps(r1[2] - r2[1], r2[0] - r0[2], r0[1] - r1[0], s[3]);
+		else if (k == 0)
+			num = _mm_setr_ps(s[0], r1[0] + r0[1], r2[0] + r0[2], r1[2] - r2[1]);
+		else if (k == 1)
+			num = _mm_setr_ps(r1[0] + r0[1], s[1], r2[1] + r1[2], r2[0] - r0[2]);
+		else
+			num = _mm_setr_ps(r2[0] + r0[2], r2[1] + r1[2], s[2], r0[1] - r1[0]);
+		__m128 q = _mm_div_ps(num, _mm_set1_ps(2.0f * std::sqrt(s[k])));
+
+		// keep w >= 0 and renormalize to absorb rounding
+		__m128 flip = _mm_and_ps(_mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3)), _mm_castsi128_ps(_mm_set1_epi32((int)0x80000000)));
+		q = _mm_xor_ps(q, flip);
+		q = _mm_div_ps(q, _mm_sqrt_ps(Dot4(q, q)));
+
+		// dual = 0.5 * (t, 0) * q
+		__m128 qw = _mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 3, 3, 3));
+		__m128 tYZX = _mm_shuffle_ps(t, t, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 qYZX = _mm_shuffle_ps(q, q, _MM_SHUFFLE(3, 0, 2, 1));
+		__m128 cross = _mm_sub_ps(_mm_mul_ps(t, qYZX), _mm_mul_ps(tYZX, q));
+		cross = _mm_shuffle_ps(cross, cross, _MM_SHUFFLE(3, 0, 2, 1)); // t x q.xyz
+		__m128 d = _mm_add_ps(_mm_mul_ps(t, qw), cross);
+		float dotTQ = _mm_cvtss_f32(Dot3(t, q));
+		d = _mm_mul_ps(d, _mm_set1_ps(0.5f));
+
+		_mm_storeu_ps(&dq.real[0], q);
+		_mm_storeu_ps(&dq.dual[0], d);
+		dq.dual.w = -0.5f * dotTQ;
+#else
+		glm::vec3 c0 = glm::normalize(glm::vec3(m[0]));
+		glm::vec3 c1 = glm::normalize(glm::vec3(m[1]));
+		glm::vec3 c2 = glm::normalize(glm::vec3(m[2]));
+		glm::vec3 t = glm::vec3(m[3]);
+
+		glm::quat r = glm::normalize(glm::quat_cast(glm::mat3(c0, c1, c2)));
+		glm::vec4 q(r.x, r.y, r.z, r.w);
+		if (q.w < 0.0f)
+			q = -q;
+
+		glm::vec3 qv(q.x, q.y, q.z);
+		dq.real = q;
+		dq.dual = glm::vec4(0.5f * (t * q.w + glm::cross(t, qv)), -0.5f * glm::dot(t, qv));
+#endif
+		return dq;
+	}
+
+	static inline void FromMatrices(const glm::mat4* matrices, DualQuat* out, int count)
+	{
+		for (int i = 0; i < count; i++)
+			out[i] = FromMatrix(matrices[i]);
+	}
+
+private:
+#ifdef DUAL_QUATERNION_SSE
+	static inline __m128 Dot3(__m128 a, __m128 b)
+	{
+		__m128 p = _mm_mul_ps(a, b);
+		__m128 y = _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 1, 1, 1));
+		__m128 z = _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 2, 2, 2));
+		return _mm_add_ss(_mm_add_ss(p, y), z); // result in the lowest lane only
+	}
+
+	static inline __m128 Dot4(__m128 a, __m128 b)
+	{
+		__m128 p = _mm_mul_ps(a, b);
+		p = _mm_add_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(2, 3, 0, 1)));
+		return _mm_add_ps(p, _mm_shuffle_ps(p, p, _MM_SHUFFLE(1, 0, 3, 2)));
+	}
+
+	static inline __m128 InverseLength3(__m128 v)
+	{
+		__m128 len2 = Dot3(v, v);
+		len2 = _mm_shuffle_ps(len2, len2, _MM_SHUFFLE(0, 0, 0, 0));
+		return _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(len2));
+	}
+#endif
+};
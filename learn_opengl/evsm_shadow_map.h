@@ -0,0 +1,159 @@
+#ifndef EVSM_SHADOW_MAP_H
+#define EVSM_SHADOW_MAP_H
+
+#include "glad.h" // holds all OpenGL type declarations
+#include "gl_extensions.h"
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+
+#include <algorithm>
+#include <iostream>
+
+// Exponential variance shadow map (EVSM), filtered from a layered depth map: a depth cube map or a depth
+// texture array.
+//
+// Each layer's depth is warped by exp(positiveExponent * d) and -exp(-negativeExponent * d), and the two
+// warped depths and their squares are stored. Unlike depth, these moments can be averaged: the resolve
+// pass warps and blurs along x (taking downsample x downsample depth texels per moment texel), the blur pass
+// blurs along y, and a mip chain is built over the result. A cube map's faces are blurred over their edges
+// into their neighbours: the resolve shader does the vertical pass as well, as it reads the other faces' depth. The lighting pass then filters the shadow with a
+// single trilinear, anisotropic fetch, and Chebyshev's inequality on each warped pair bounds how lit the
+// fragment is. Where occluders overlap at different depths the bound lets light through (light bleeding);
+// lightBleedingReduction cuts the lowest part of it off, at the cost of darker, harder penumbrae.
+// The moments take 32 bit floats: exponents up to 42 keep the squares in range.
+class EVSMShadowMap
+{
+public:
+    unsigned int ID; // same target as the depth map, GL_RGBA32F, mipmapped
+    int size, layers, downsample;
+    float positiveExponent, negativeExponent;
+    float lightBleedingReduction; // in [0, 1)
+    int blurRadius;               // moment texels on each side of the Gaussian
+
+    // target is GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY; the moments are depthSize / downsample wide
+    EVSMShadowMap(GLenum target, int depthSize, int layers, int downsample = 1)
+        : size(depthSize / downsample), layers(layers), downsample(downsample), positiveExponent(40.0f), negativeExponent(5.0f),
+          lightBleedingReduction(0.2f), blurRadius(2), target(target), staleLayers((1u << layers) - 1)
+    {
+        glGenTextures(1, &ID);
+        glBindTexture(target, ID);
+        if (target == GL_TEXTURE_CUBE_MAP)
+            for (int i = 0; i < 6; i++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGBA32F, size, size, 0, GL_RGBA, GL_FLOAT, NULL);
+        else
+            glTexImage3D(target, 0, GL_RGBA32F, size, size, layers, 0, GL_RGBA, GL_FLOAT, NULL);
+        glGenerateMipmap(target);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        if (glExt().anisotropicFiltering)
+        {
+            float maxAnisotropy = 1.0f;
+            glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &maxAnisotropy);
+            glTexParameterf(target, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(8.0f, maxAnisotropy));
+        }
+
+        // the moments of one layer between the two blur passes
+        glGenTextures(1, &blurTexture);
+        glBindTexture(GL_TEXTURE_2D, blurTexture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, size, size, 0, GL_RGBA, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::EVSM_SHADOW_MAP: framebuffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // the passes draw one triangle covering the viewport, made up in the vertex shader
+        glGenVertexArrays(1, &emptyVAO);
+    }
+
+    // every layer is filtered again on the next Update(), e.g. after a setting changed
+    void Invalidate() { staleLayers = (1u << layers) - 1; }
+
+    // filters the layers of depthTexture in layerMask, and those invalidated since, into the moments and
+    // rebuilds the mip chain. blurShader does the vertical pass with the x blurred moments in image; for a cube
+    // map it is the resolve shader, whose vertical mode reads past the face's edges. Leaves framebuffer 0 bound;
+    // the viewport is the moments' size
+    void Update(Shader &resolveShader, Shader &blurShader, unsigned int depthTexture, unsigned int layerMask)
+    {
+        layerMask |= staleLayers;
+        staleLayers = 0;
+        if (!layerMask)
+            return;
+        // a face's blur reaches into the four faces around it, so their edges are filtered again too; only the
+        // opposite face (the other one of the pair, face ^ 1) doesn't touch it
+        if (target == GL_TEXTURE_CUBE_MAP)
+        {
+            unsigned int touched = layerMask;
+            for (int i = 0; i < 6; i++)
+                if (touched & (1u << i))
+                    layerMask |= 0x3Fu & ~(1u << (i ^ 1));
+        }
+
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glViewport(0, 0, size, size);
+        glBindVertexArray(emptyVAO);
+        glActiveTexture(GL_TEXTURE0);
+        for (int i = 0; i < layers; i++)
+        {
+            if (!(layerMask & (1u << i)))
+                continue;
+            // 1. warp, and blur along x, into the blur texture
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, blurTexture, 0);
+            resolveShader.use();
+            resolveShader.setInt("depthMap", 0);
+            resolveShader.setInt("layer", i);
+            resolveShader.setInt("downsample", downsample);
+            resolveShader.setInt("blurRadius", blurRadius);
+            resolveShader.setVec2("exponents", glm::vec2(positiveExponent, negativeExponent));
+            resolveShader.setBool("vertical", false);
+            resolveShader.setInt("image", 1); // unused here, but kept off the depth map's unit
+            glBindTexture(target, depthTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+
+            // 2. blur along y into the layer
+            if (target == GL_TEXTURE_CUBE_MAP)
+                glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, ID, 0);
+            else
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, ID, 0, i);
+            blurShader.use();
+            blurShader.setInt("image", 1);
+            blurShader.setInt("blurRadius", blurRadius);
+            blurShader.setBool("vertical", true);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, blurTexture);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            // the blur texture is the next layer's render target
+            glBindTexture(GL_TEXTURE_2D, 0);
+            glActiveTexture(GL_TEXTURE0);
+        }
+        glBindVertexArray(0);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        glBindTexture(target, ID);
+        glGenerateMipmap(target);
+    }
+
+    // evsmExponents and lightBleedingReduction, for the lighting shader
+    void SetUniforms(const Shader &shader) const
+    {
+        shader.setVec2("evsmExponents", glm::vec2(positiveExponent, negativeExponent));
+        shader.setFloat("lightBleedingReduction", lightBleedingReduction);
+    }
+
+private:
+    GLenum target;
+    unsigned int staleLayers;
+    unsigned int blurTexture;
+    unsigned int FBO;
+    unsigned int emptyVAO;
+};
+#endif
@@ -0,0 +1,101 @@
+#ifndef GL_EXTENSIONS_LOADER_H
+#define GL_EXTENSIONS_LOADER_H
+
+// glad.h is generated for a 3.3 core profile only. This picks up the few newer entry points the
+// samples use when the driver offers them, so every feature that needs one keeps a 3.3 fallback.
+
+#include "glad.h"
+
+#include <string>
+#include <cstring>
+
+// ARB_draw_indirect / ARB_multi_draw_indirect (core in 4.0 / 4.3)
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+typedef void (APIENTRYP PFNGLMULTIDRAWELEMENTSINDIRECTPROC)(GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride);
+
+// ARB_buffer_storage (core in 4.4)
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+typedef void (APIENTRYP PFNGLBUFFERSTORAGEPROC)(GLenum target, GLsizeiptr size, const void *data, GLbitfield flags);
+
+// ARB_copy_image (core in 4.3)
+typedef void (APIENTRYP PFNGLCOPYIMAGESUBDATAPROC)(GLuint srcName, GLenum srcTarget, GLint srcLevel, GLint srcX, GLint srcY, GLint srcZ,
+                                                   GLuint dstName, GLenum dstTarget, GLint dstLevel, GLint dstX, GLint dstY, GLint dstZ,
+                                                   GLsizei srcWidth, GLsizei srcHeight, GLsizei srcDepth);
+
+// EXT_texture_filter_anisotropic (core in 4.6)
+#ifndef GL_TEXTURE_MAX_ANISOTROPY_EXT
+#define GL_TEXTURE_MAX_ANISOTROPY_EXT 0x84FE
+#define GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT 0x84FF
+#endif
+
+// layout of one GL_DRAW_INDIRECT_BUFFER entry for glMultiDrawElementsIndirect
+struct DrawElementsIndirectCommand {
+    GLuint count;
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint  baseVertex;
+    GLuint baseInstance;
+};
+
+struct GLExtensionTable {
+    bool loaded;
+    bool multiDrawIndirect;
+    bool bufferStorage;
+    bool copyImage;
+    bool anisotropicFiltering;
+    PFNGLMULTIDRAWELEMENTSINDIRECTPROC MultiDrawElementsIndirect;
+    PFNGLBUFFERSTORAGEPROC BufferStorage;
+    PFNGLCOPYIMAGESUBDATAPROC CopyImageSubData;
+};
+
+// the one table shared by everything that includes this header
+inline GLExtensionTable& glExt()
+{
+    static GLExtensionTable table = { false, false, false, false, false, 0, 0, 0 };
+    return table;
+}
+
+inline bool glHasVersion(int major, int minor)
+{
+    return GLVersion.major > major || (GLVersion.major == major && GLVersion.minor >= minor);
+}
+
+inline bool glHasExtension(const char *name)
+{
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++)
+    {
+        const char *extension = (const char *)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && std::strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+// call once right after gladLoadGLLoader, with the same loader
+inline void glLoadExtensions(GLADloadproc load)
+{
+    GLExtensionTable &ext = glExt();
+    // baseInstance carries the draw ID, so the extension path also needs ARB_base_instance
+    if (glHasVersion(4, 3) || (glHasExtension("GL_ARB_multi_draw_indirect") && glHasExtension("GL_ARB_base_instance")))
+        ext.MultiDrawElementsIndirect = (PFNGLMULTIDRAWELEMENTSINDIRECTPROC)load("glMultiDrawElementsIndirect");
+    ext.multiDrawIndirect = ext.MultiDrawElementsIndirect != 0;
+
+    if (glHasVersion(4, 4) || glHasExtension("GL_ARB_buffer_storage"))
+        ext.BufferStorage = (PFNGLBUFFERSTORAGEPROC)load("glBufferStorage");
+    ext.bufferStorage = ext.BufferStorage != 0;
+
+    if (glHasVersion(4, 3) || glHasExtension("GL_ARB_copy_image"))
+        ext.CopyImageSubData = (PFNGLCOPYIMAGESUBDATAPROC)load("glCopyImageSubData");
+    ext.copyImage = ext.CopyImageSubData != 0;
+
+    ext.anisotropicFiltering = glHasVersion(4, 6) || glHasExtension("GL_EXT_texture_filter_anisotropic") || glHasExtension("GL_ARB_texture_filter_anisotropic");
+    ext.loaded = true;
+}
+#endif
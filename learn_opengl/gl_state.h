@@ -0,0 +1,244 @@
+#ifndef GL_STATE_H
+#define GL_STATE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include <map>
+#include <iostream>
+
+#define GL_STATE_MAX_TEXTURE_UNITS 32
+
+// kinds of calls the cache shadows, used to index the per-frame counters
+enum GLStateCall {
+    CALL_PROGRAM,
+    CALL_VERTEX_ARRAY,
+    CALL_ACTIVE_TEXTURE,
+    CALL_BIND_TEXTURE,
+    CALL_BIND_BUFFER,
+    CALL_CAPABILITY,
+    CALL_BLEND_FUNC,
+    CALL_DEPTH_FUNC,
+    CALL_CULL_FACE,
+    CALL_UNIFORM,
+    CALL_COUNT
+};
+
+struct GLStateStats {
+    unsigned int issued[CALL_COUNT];
+    unsigned int elided[CALL_COUNT];
+};
+
+// Shadows the bind/enable state the samples change per draw and skips calls that wouldn't change anything.
+//
+// Tracking is off by default: every call goes straight to GL and is only counted. Turn it on only
+// when all of the program's state changes go through the cache (Shader::use, Mesh::Draw, ... do),
+// or call Invalidate() after raw GL calls so the shadow copy can't go stale. That includes integer
+// uniforms: Shader::setInt and setBool go through Uniform1i(), a raw glUniform1i doesn't.
+class GLStateCache
+{
+public:
+    GLStateStats frame;     // counters of the frame in progress
+    GLStateStats lastFrame; // counters of the last finished frame
+
+    GLStateCache() : enabled(false)
+    {
+        resetStats(frame);
+        resetStats(lastFrame);
+        Invalidate();
+    }
+
+    void SetEnabled(bool enable)
+    {
+        enabled = enable;
+        Invalidate();
+    }
+    bool Enabled() const { return enabled; }
+
+    // forget everything we think is bound; the next call of each kind is always issued
+    void Invalidate()
+    {
+        program = vertexArray = activeUnit = UNKNOWN;
+        for (int i = 0; i < GL_STATE_MAX_TEXTURE_UNITS; i++)
+            textures[i] = textureTargets[i] = UNKNOWN;
+        buffers.clear();
+        capabilities.clear();
+        uniforms.clear();
+        blendSrc = blendDst = depthFunc = cullFace = UNKNOWN;
+    }
+
+    // call once per frame, e.g. right before swapping buffers
+    void EndFrame()
+    {
+        lastFrame = frame;
+        resetStats(frame);
+    }
+
+    void UseProgram(unsigned int id)
+    {
+        if (changed(CALL_PROGRAM, program, id))
+        {
+            glUseProgram(id);
+            // sampler/uniform values are per program but cached by location only
+            uniforms.clear();
+        }
+    }
+
+    void BindVertexArray(unsigned int id)
+    {
+        if (changed(CALL_VERTEX_ARRAY, vertexArray, id))
+            glBindVertexArray(id);
+    }
+
+    void ActiveTexture(unsigned int unit)
+    {
+        if (changed(CALL_ACTIVE_TEXTURE, activeUnit, unit))
+            glActiveTexture(GL_TEXTURE0 + unit);
+    }
+
+    // only one target is shadowed per unit, switching targets on a unit always rebinds
+    void BindTexture(unsigned int unit, GLenum target, unsigned int id)
+    {
+        bool same = enabled && unit < GL_STATE_MAX_TEXTURE_UNITS && textures[unit] == id && textureTargets[unit] == target;
+        count(CALL_BIND_TEXTURE, !same);
+        if (same)
+            return;
+        if (unit < GL_STATE_MAX_TEXTURE_UNITS)
+        {
+            textures[unit] = id;
+            textureTargets[unit] = target;
+        }
+        ActiveTexture(unit);
+        glBindTexture(target, id);
+    }
+
+    // GL_ELEMENT_ARRAY_BUFFER belongs to the bound VAO, so it is never elided
+    void BindBuffer(GLenum target, unsigned int id)
+    {
+        if (target == GL_ELEMENT_ARRAY_BUFFER)
+        {
+            count(CALL_BIND_BUFFER, true);
+            glBindBuffer(target, id);
+            return;
+        }
+        std::map<GLenum, unsigned int>::iterator it = buffers.find(target);
+        unsigned int &bound = it != buffers.end() ? it->second : (buffers[target] = UNKNOWN);
+        if (changed(CALL_BIND_BUFFER, bound, id))
+            glBindBuffer(target, id);
+    }
+
+    // glEnable/glDisable for GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE, ...
+    void SetCapability(GLenum capability, bool enable)
+    {
+        std::map<GLenum, unsigned int>::iterator it = capabilities.find(capability);
+        unsigned int &state = it != capabilities.end() ? it->second : (capabilities[capability] = UNKNOWN);
+        if (changed(CALL_CAPABILITY, state, enable ? 1u : 0u))
+        {
+            if (enable)
+                glEnable(capability);
+            else
+                glDisable(capability);
+        }
+    }
+
+    void BlendFunc(GLenum src, GLenum dst)
+    {
+        bool same = enabled && blendSrc == src && blendDst == dst;
+        count(CALL_BLEND_FUNC, !same);
+        if (!same)
+        {
+            blendSrc = src;
+            blendDst = dst;
+            glBlendFunc(src, dst);
+        }
+    }
+
+    void DepthFunc(GLenum func)
+    {
+        if (changed(CALL_DEPTH_FUNC, depthFunc, func))
+            glDepthFunc(func);
+    }
+
+    void CullFace(GLenum face)
+    {
+        if (changed(CALL_CULL_FACE, cullFace, face))
+            glCullFace(face);
+    }
+
+    // integer uniform of the current program, meant for sampler units that rarely change. The values are
+    // forgotten when another program is used; call ForgetUniforms() after relinking the current one
+    void Uniform1i(int location, int value)
+    {
+        if (location < 0)
+            return;
+        std::map<int, unsigned int>::iterator it = uniforms.find(location);
+        unsigned int &cached = it != uniforms.end() ? it->second : (uniforms[location] = UNKNOWN);
+        if (changed(CALL_UNIFORM, cached, static_cast<unsigned int>(value)))
+            glUniform1i(location, value);
+    }
+
+    // the current program's uniforms were reset behind the cache's back, e.g. by glLinkProgram
+    void ForgetUniforms() { uniforms.clear(); }
+
+    void PrintStats(std::ostream &out) const
+    {
+        static const char *names[CALL_COUNT] = { "program", "vao", "active texture", "texture", "buffer",
+                                                 "enable/disable", "blend func", "depth func", "cull face", "uniform" };
+        unsigned int issued = 0, elided = 0;
+        for (int i = 0; i < CALL_COUNT; i++)
+        {
+            issued += lastFrame.issued[i];
+            elided += lastFrame.elided[i];
+        }
+        out << "GL calls issued: " << issued << " elided: " << elided << " (";
+        for (int i = 0; i < CALL_COUNT; i++)
+        {
+            if (lastFrame.issued[i] + lastFrame.elided[i] == 0)
+                continue;
+            out << names[i] << " " << lastFrame.issued[i] << "/" << lastFrame.elided[i] << " ";
+        }
+        out << ")" << std::endl;
+    }
+
+private:
+    static const unsigned int UNKNOWN = 0xFFFFFFFFu;
+
+    bool enabled;
+    unsigned int program, vertexArray, activeUnit;
+    unsigned int textures[GL_STATE_MAX_TEXTURE_UNITS];
+    unsigned int textureTargets[GL_STATE_MAX_TEXTURE_UNITS];
+    unsigned int blendSrc, blendDst, depthFunc, cullFace;
+    std::map<GLenum, unsigned int> buffers;
+    std::map<GLenum, unsigned int> capabilities;
+    std::map<int, unsigned int> uniforms;
+
+    // updates the shadow copy; returns whether the call has to be issued
+    bool changed(GLStateCall call, unsigned int &shadow, unsigned int value)
+    {
+        bool issue = !enabled || shadow != value;
+        shadow = value;
+        count(call, issue);
+        return issue;
+    }
+
+    void count(GLStateCall call, bool issued)
+    {
+        if (issued)
+            frame.issued[call]++;
+        else
+            frame.elided[call]++;
+    }
+
+    static void resetStats(GLStateStats &stats)
+    {
+        for (int i = 0; i < CALL_COUNT; i++)
+            stats.issued[i] = stats.elided[i] = 0;
+    }
+};
+
+// the one cache shared by everything that includes this header
+inline GLStateCache& glState()
+{
+    static GLStateCache cache;
+    return cache;
+}
+#endif
@@ -0,0 +1,29 @@
+#ifndef HALF_FLOAT_H
+#define HALF_FLOAT_H
+
+#include <cstring>
+
+// float to IEEE half float bits, rounding to the nearest half with ties to even. Values beyond the half range
+// saturate to the largest finite half, 65504, keeping their sign; what lighting data overflows is better clamped
+// than turned into infinity. Shared by the IBL cache files and the HDR decoder
+inline unsigned short halfFromFloat(float value)
+{
+    unsigned int bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    unsigned short sign = static_cast<unsigned short>((bits >> 16) & 0x8000);
+    bits &= 0x7FFFFFFF;
+    if (bits > 0x477FE000u)
+        return sign | 0x7BFF;
+    if (bits < (113u << 23))
+    {
+        // below 2^-14 the half is denormal: adding 0.5 lines the mantissa up with the half's
+        float shifted;
+        std::memcpy(&shifted, &bits, sizeof(shifted));
+        shifted += 0.5f;
+        std::memcpy(&bits, &shifted, sizeof(bits));
+        return sign | static_cast<unsigned short>(bits - 0x3F000000u);
+    }
+    unsigned int odd = (bits >> 13) & 1;
+    return sign | static_cast<unsigned short>((bits - (112u << 23) + 0xFFF + odd) >> 13);
+}
+#endif
@@ -0,0 +1,486 @@
+#ifndef HDR_DECODER_H
+#define HDR_DECODER_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "half_float.h"
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <iostream>
+
+#if !defined(HDR_DECODER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define HDR_DECODER_SSE 1
+#endif
+
+// what HDRDecoder stores the pixels as
+enum HDRPixelFormat {
+    HDR_RGB9_E5, // GL_RGB9_E5 from GL_UNSIGNED_INT_5_9_9_9_REV, 4 bytes a pixel
+    HDR_RGB16F   // GL_RGB16F from GL_HALF_FLOAT, 6 bytes a pixel
+};
+
+// Radiance .hdr (RGBE) decoder that never holds the image as floats.
+//
+// stbi_loadf() expands the whole image to 32 bit floats, 12 bytes a pixel, on one thread, before the sample uploads
+// it. Here the file is read through a small buffer, a band of scanlines at a time, and the work is pipelined: the
+// calling thread undoes the run length encoding of band k + 1, a run with memset and a literal span with memcpy into
+// one plane per channel, while a pool of workers, started once per Decode(), interleaves band k and converts it
+// straight to the texture's format, its rows split between them. Then band k is handed on (to glTexSubImage2D, by
+// LoadTexture()) from the calling thread. What is held is two bands before and after conversion, whatever the size of
+// the image.
+//
+// RGBE is a shared exponent with 8 bit mantissas, so RGB9_E5, a shared exponent with 9 bit mantissas, takes every
+// pixel exactly from 2^-15 up to its largest value, 65408, with integer operations and a float scale for what lies
+// outside. Half floats keep 11 bits of each channel. Both conversions take four pixels at a time with SSE2; values
+// beyond either format saturate to its largest. Like stb_image, it reads "-Y height +X width" images with flat or
+// new style run length encoded scanlines.
+class HDRDecoder
+{
+public:
+    int width, height;
+    int threadCount; // <= 0 uses every hardware thread
+    int bandRows;    // scanlines decoded at a time
+
+    HDRDecoder(int threadCount = 0, int bandRows = 64)
+        : width(0), height(0), threadCount(threadCount), bandRows(bandRows), file(NULL), filePosition(0), fileEnd(0)
+    {
+    }
+    ~HDRDecoder() { close(); }
+
+    static int BytesPerPixel(HDRPixelFormat format) { return format == HDR_RGB9_E5 ? 4 : 6; }
+
+    // the most memory Decode() holds: the file buffer, two bands before and after conversion and a scanline per thread
+    size_t BufferBytes(HDRPixelFormat format) const
+    {
+        int threads = threadCount > 0 ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+        return fileBuffer.size() + 2 * (size_t)bandRows * (width * (4 + BytesPerPixel(format)) + 1) + (size_t)threads * width * 4;
+    }
+
+    // opens path and reads its header: width and height are known from here on. False when it isn't a Radiance file
+    // this decoder reads
+    bool Open(const char *path)
+    {
+        close();
+        file = std::fopen(path, "rb");
+        if (!file)
+        {
+            std::cout << "ERROR::HDR_DECODER: can't open " << path << std::endl;
+            return false;
+        }
+        fileBuffer.resize(64 * 1024);
+        filePosition = fileEnd = 0;
+
+        std::string line;
+        if (!readLine(line) || (line.compare(0, 10, "#?RADIANCE") != 0 && line.compare(0, 6, "#?RGBE") != 0))
+            return fail("not a Radiance file");
+        bool rgbe = false;
+        while (readLine(line) && !line.empty())
+            if (line == "FORMAT=32-bit_rle_rgbe")
+                rgbe = true;
+        if (!rgbe)
+            return fail("not in the 32-bit_rle_rgbe format");
+        if (!readLine(line) || std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || width <= 0 || height <= 0)
+            return fail("unsupported image orientation");
+        return true;
+    }
+
+    // decodes the opened file band by band, calling band(firstRow, rowCount, pixels) with each: rowCount rows of width
+    // pixels in format, tightly packed, from row firstRow of the image on. With flipVertically the image's first row is
+    // its bottom one, as with stbi_set_flip_vertically_on_load(true). Closes the file
+    template <typename Function>
+    bool Decode(HDRPixelFormat format, bool flipVertically, Function band)
+    {
+        if (!file)
+            return false;
+        int threads = threadCount > 0 ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+        // the calling thread reads the file meanwhile, so it takes one of the threads
+        int workers = std::min(threads - 1, bandRows);
+        int pixelBytes = BytesPerPixel(format);
+        // per slot: a band as read (per scanline, interleaved pixels or, if run length encoded, one plane per
+        // channel) and converted. Band k uses slot k % 2
+        std::vector<unsigned char> rgbe[2], planar[2], pixels[2];
+        for (int slot = 0; slot < 2; slot++)
+        {
+            rgbe[slot].resize((size_t)bandRows * width * 4);
+            planar[slot].resize(bandRows);
+            pixels[slot].resize((size_t)bandRows * width * pixelBytes);
+        }
+        std::vector<std::vector<unsigned char> > scanlines(std::max(workers, 1), std::vector<unsigned char>((size_t)width * 4));
+
+        // the pool: a posted band is split evenly between the workers, the caller waits for all of them to finish
+        // it before posting the next
+        std::mutex poolMutex;
+        std::condition_variable posted, finished;
+        int generation = 0, done = 0, jobSlot = 0, jobRows = 0;
+        bool stopping = false;
+        std::vector<std::thread> pool;
+        for (int t = 0; t < workers; t++)
+        {
+            pool.push_back(std::thread([&, t]() {
+                int seen = 0;
+                for (;;)
+                {
+                    std::unique_lock<std::mutex> lock(poolMutex);
+                    posted.wait(lock, [&]() { return stopping || generation != seen; });
+                    if (stopping)
+                        return;
+                    seen = generation;
+                    int slot = jobSlot, rows = jobRows;
+                    lock.unlock();
+                    convertRows(&rgbe[slot][0], &planar[slot][0], &pixels[slot][0], rows, t * rows / workers, (t + 1) * rows / workers,
+                                flipVertically, format, &scanlines[t][0]);
+                    lock.lock();
+                    if (++done == workers)
+                        finished.notify_one();
+                }
+            }));
+        }
+        auto waitForBand = [&]() {
+            std::unique_lock<std::mutex> lock(poolMutex);
+            finished.wait(lock, [&]() { return done == workers; });
+        };
+        auto stopPool = [&]() {
+            {
+                std::lock_guard<std::mutex> lock(poolMutex);
+                stopping = true;
+            }
+            posted.notify_all();
+            for (unsigned int t = 0; t < pool.size(); t++)
+                pool[t].join();
+        };
+
+        int bands = (height + bandRows - 1) / bandRows;
+        for (int k = 0; k <= bands; k++)
+        {
+            int slot = k % 2;
+            int rows = k < bands ? std::min(bandRows, height - k * bandRows) : 0;
+            for (int row = 0; row < rows; row++)
+            {
+                bool isPlanar = false;
+                if (!readScanline(&rgbe[slot][(size_t)row * width * 4], isPlanar))
+                {
+                    stopPool();
+                    return fail("corrupt scanline");
+                }
+                planar[slot][row] = isPlanar;
+            }
+
+            if (workers > 0)
+            {
+                if (k > 0)
+                    waitForBand();
+                if (k < bands)
+                {
+                    std::lock_guard<std::mutex> lock(poolMutex);
+                    jobSlot = slot;
+                    jobRows = rows;
+                    done = 0;
+                    generation++;
+                    posted.notify_all();
+                }
+            }
+            else if (k < bands)
+                convertRows(&rgbe[slot][0], &planar[slot][0], &pixels[slot][0], rows, 0, rows, flipVertically, format, &scanlines[0][0]);
+
+            // band k - 1 is handed on while the workers convert band k
+            if (k > 0)
+            {
+                int firstScanline = (k - 1) * bandRows, previousRows = std::min(bandRows, height - firstScanline);
+                band(flipVertically ? height - firstScanline - previousRows : firstScanline, previousRows, &pixels[slot ^ 1][0]);
+            }
+        }
+        stopPool();
+        close();
+        return true;
+    }
+
+    // path as a new GL_TEXTURE_2D, bottom row first like the stb_image path it replaces, and without mipmaps. 0 when
+    // the file can't be read
+    unsigned int LoadTexture(const char *path, HDRPixelFormat format)
+    {
+        if (!Open(path))
+            return 0;
+        GLenum internalFormat = format == HDR_RGB9_E5 ? GL_RGB9_E5 : GL_RGB16F;
+        GLenum type = format == HDR_RGB9_E5 ? GL_UNSIGNED_INT_5_9_9_9_REV : GL_HALF_FLOAT;
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, GL_RGB, type, NULL);
+        // half float rows of an odd width aren't 4 byte aligned
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 2);
+        bool decoded = Decode(format, true, [&](int firstRow, int rowCount, const unsigned char *pixels) {
+            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, firstRow, width, rowCount, GL_RGB, type, pixels);
+        });
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        if (!decoded)
+        {
+            glDeleteTextures(1, &texture);
+            return 0;
+        }
+        return texture;
+    }
+
+    // one pixel at a time, as the SSE2 path does it
+    static unsigned int ToRGB9E5(const unsigned char *rgbe)
+    {
+        // m * 2^(e - 136) is 2m * 2^((e - 113) - 15 - 9): the exponent moves by 113 and the mantissas gain a bit.
+        // Exponents outside [0, 31] are clamped and what is left over scales the mantissas
+        int exponent = rgbe[3] - 113;
+        int clamped = std::min(std::max(exponent, 0), 31);
+        float scale = std::ldexp(1.0f, exponent - clamped);
+        unsigned int result = (unsigned int)clamped << 27;
+        for (int c = 0; c < 3; c++)
+            result |= (unsigned int)std::min(2.0f * rgbe[c] * scale, 511.0f) << (9 * c);
+        return result;
+    }
+
+    static void ToHalf(const unsigned char *rgbe, unsigned short *half)
+    {
+        float scale = rgbe[3] < 10 ? 0.0f : std::ldexp(1.0f, rgbe[3] - 136);
+        for (int c = 0; c < 3; c++)
+            half[c] = halfFromFloat(rgbe[c] * scale);
+    }
+
+private:
+    std::FILE *file;
+    std::vector<unsigned char> fileBuffer;
+    size_t filePosition, fileEnd;
+
+    void close()
+    {
+        if (file)
+            std::fclose(file);
+        file = NULL;
+    }
+
+    bool fail(const char *message)
+    {
+        std::cout << "ERROR::HDR_DECODER: " << message << std::endl;
+        close();
+        return false;
+    }
+
+    // the next byte of the file, -1 at its end
+    int nextByte()
+    {
+        if (filePosition == fileEnd)
+        {
+            fileEnd = std::fread(&fileBuffer[0], 1, fileBuffer.size(), file);
+            filePosition = 0;
+            if (fileEnd == 0)
+                return -1;
+        }
+        return fileBuffer[filePosition++];
+    }
+
+    bool readBytes(unsigned char *destination, size_t count)
+    {
+        while (count)
+        {
+            if (filePosition == fileEnd)
+            {
+                fileEnd = std::fread(&fileBuffer[0], 1, fileBuffer.size(), file);
+                filePosition = 0;
+                if (fileEnd == 0)
+                    return false;
+            }
+            size_t n = std::min(count, fileEnd - filePosition);
+            std::memcpy(destination, &fileBuffer[filePosition], n);
+            filePosition += n;
+            destination += n;
+            count -= n;
+        }
+        return true;
+    }
+
+    bool readLine(std::string &line)
+    {
+        line.clear();
+        for (int c = nextByte(); c != '\n'; c = nextByte())
+        {
+            if (c < 0 || line.size() > 1024)
+                return false;
+            line += (char)c;
+        }
+        if (!line.empty() && line[line.size() - 1] == '\r')
+            line.erase(line.size() - 1);
+        return true;
+    }
+
+    // one scanline into width RGBE pixels or, when planar comes back true, into four planes of width bytes, one per
+    // channel: that is how run length encoded scanlines are stored, and convertRows() interleaves them
+    bool readScanline(unsigned char *rgbe, bool &planar)
+    {
+        unsigned char head[4];
+        if (!readBytes(head, 4))
+            return false;
+        if (width < 8 || width >= 32768 || head[0] != 2 || head[1] != 2 || (head[2] & 0x80))
+        {
+            // flat: what was read is the first pixel
+            planar = false;
+            std::memcpy(rgbe, head, 4);
+            return readBytes(rgbe + 4, (size_t)(width - 1) * 4);
+        }
+        if ((head[2] << 8 | head[3]) != width)
+            return false;
+        // run length encoded: the four channels one after the other, each as runs of one value or of literal values
+        planar = true;
+        for (int c = 0; c < 4; c++)
+        {
+            unsigned char *plane = rgbe + (size_t)c * width;
+            for (int x = 0; x < width;)
+            {
+                int count = nextByte();
+                if (count > 128)
+                {
+                    count -= 128;
+                    int value = nextByte();
+                    if (value < 0 || x + count > width)
+                        return false;
+                    std::memset(plane + x, value, count);
+                }
+                else if (count <= 0 || x + count > width || !readBytes(plane + x, count))
+                    return false;
+                x += count;
+            }
+        }
+        return true;
+    }
+
+    // rows [begin, end) of a band of rows scanlines as read into pixels, flipped within the band if flipVertically;
+    // scanline is width * 4 bytes to interleave a planar row into
+    void convertRows(const unsigned char *rgbe, const unsigned char *planar, unsigned char *pixels, int rows, int begin, int end,
+                     bool flipVertically, HDRPixelFormat format, unsigned char *scanline) const
+    {
+        for (int row = begin; row < end; row++)
+        {
+            const unsigned char *source = rgbe + (size_t)row * width * 4;
+            if (planar[row])
+            {
+                interleave(source, scanline);
+                source = scanline;
+            }
+            int target = flipVertically ? rows - 1 - row : row;
+            convert(source, pixels + (size_t)target * width * BytesPerPixel(format), format);
+        }
+    }
+
+    // four planes of width bytes into width RGBE pixels
+    void interleave(const unsigned char *planes, unsigned char *rgbe) const
+    {
+        const unsigned char *r = planes, *g = planes + width, *b = planes + 2 * width, *e = planes + 3 * width;
+        int x = 0;
+#ifdef HDR_DECODER_SSE
+        for (; x + 16 <= width; x += 16)
+        {
+            __m128i r16 = _mm_loadu_si128((const __m128i*)(r + x)), g16 = _mm_loadu_si128((const __m128i*)(g + x));
+            __m128i b16 = _mm_loadu_si128((const __m128i*)(b + x)), e16 = _mm_loadu_si128((const __m128i*)(e + x));
+            __m128i rgLow = _mm_unpacklo_epi8(r16, g16), rgHigh = _mm_unpackhi_epi8(r16, g16);
+            __m128i beLow = _mm_unpacklo_epi8(b16, e16), beHigh = _mm_unpackhi_epi8(b16, e16);
+            __m128i *out = (__m128i*)(rgbe + x * 4);
+            _mm_storeu_si128(out, _mm_unpacklo_epi16(rgLow, beLow));
+            _mm_storeu_si128(out + 1, _mm_unpackhi_epi16(rgLow, beLow));
+            _mm_storeu_si128(out + 2, _mm_unpacklo_epi16(rgHigh, beHigh));
+            _mm_storeu_si128(out + 3, _mm_unpackhi_epi16(rgHigh, beHigh));
+        }
+#endif
+        for (; x < width; x++)
+        {
+            rgbe[x * 4 + 0] = r[x];
+            rgbe[x * 4 + 1] = g[x];
+            rgbe[x * 4 + 2] = b[x];
+            rgbe[x * 4 + 3] = e[x];
+        }
+    }
+
+    // a scanline of RGBE pixels into format
+    void convert(const unsigned char *rgbe, unsigned char *pixels, HDRPixelFormat format) const
+    {
+        int x = 0;
+#ifdef HDR_DECODER_SSE
+        const __m128i byteMask = _mm_set1_epi32(0xFF), zero = _mm_setzero_si128();
+        for (; x + 4 <= width; x += 4)
+        {
+            __m128i p = _mm_loadu_si128((const __m128i*)(rgbe + x * 4));
+            __m128i r = _mm_and_si128(p, byteMask);
+            __m128i g = _mm_and_si128(_mm_srli_epi32(p, 8), byteMask);
+            __m128i b = _mm_and_si128(_mm_srli_epi32(p, 16), byteMask);
+            __m128i e = _mm_srli_epi32(p, 24);
+            if (format == HDR_RGB9_E5)
+            {
+                // see ToRGB9E5(): clamp the exponent to [0, 31] and scale the mantissas by 2^(exponent - clamped),
+                // built from the float's exponent bits
+                __m128i exponent = _mm_sub_epi32(e, _mm_set1_epi32(113));
+                __m128i clamped = _mm_andnot_si128(_mm_cmplt_epi32(exponent, zero), exponent);
+                __m128i above = _mm_cmpgt_epi32(clamped, _mm_set1_epi32(31));
+                clamped = _mm_or_si128(_mm_and_si128(above, _mm_set1_epi32(31)), _mm_andnot_si128(above, clamped));
+                __m128 scale = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(_mm_sub_epi32(exponent, clamped), _mm_set1_epi32(127)), 23));
+                __m128 largest = _mm_set1_ps(511.0f);
+                __m128i r9 = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(r, r)), scale), largest));
+                __m128i g9 = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(g, g)), scale), largest));
+                __m128i b9 = _mm_cvttps_epi32(_mm_min_ps(_mm_mul_ps(_mm_cvtepi32_ps(_mm_add_epi32(b, b)), scale), largest));
+                __m128i packed = _mm_or_si128(_mm_or_si128(r9, _mm_slli_epi32(g9, 9)), _mm_or_si128(_mm_slli_epi32(b9, 18), _mm_slli_epi32(clamped, 27)));
+                _mm_storeu_si128((__m128i*)(pixels + x * 4), packed);
+            }
+            else
+            {
+                // 2^(e - 136) from the float's exponent bits, zero for the exponents too small to have any
+                __m128i tiny = _mm_cmplt_epi32(e, _mm_set1_epi32(10));
+                __m128 scale = _mm_castsi128_ps(_mm_andnot_si128(tiny, _mm_slli_epi32(_mm_sub_epi32(e, _mm_set1_epi32(9)), 23)));
+                __m128i rh = floatToHalf(_mm_mul_ps(_mm_cvtepi32_ps(r), scale));
+                __m128i gh = floatToHalf(_mm_mul_ps(_mm_cvtepi32_ps(g), scale));
+                __m128i bh = floatToHalf(_mm_mul_ps(_mm_cvtepi32_ps(b), scale));
+                // the halves fit 15 bits, so the signed packs keep them
+                unsigned short lanes[16];
+                _mm_storeu_si128((__m128i*)lanes, _mm_packs_epi32(rh, gh));
+                _mm_storeu_si128((__m128i*)(lanes + 8), _mm_packs_epi32(bh, zero));
+                unsigned short *half = (unsigned short*)(pixels + x * 6);
+                for (int i = 0; i < 4; i++)
+                {
+                    half[i * 3 + 0] = lanes[i];
+                    half[i * 3 + 1] = lanes[4 + i];
+                    half[i * 3 + 2] = lanes[8 + i];
+                }
+            }
+        }
+#endif
+        for (; x < width; x++)
+        {
+            if (format == HDR_RGB9_E5)
+            {
+                unsigned int packed = ToRGB9E5(rgbe + x * 4);
+                std::memcpy(pixels + x * 4, &packed, 4);
+            }
+            else
+            {
+                unsigned short half[3];
+                ToHalf(rgbe + x * 4, half);
+                std::memcpy(pixels + x * 6, half, 6);
+            }
+        }
+    }
+
+#ifdef HDR_DECODER_SSE
+    // halfFromFloat() four at a time, for values >= 0 (RGBE has no sign)
+    static __m128i floatToHalf(__m128 value)
+    {
+        __m128i bits = _mm_castps_si128(value);
+        __m128i overflow = _mm_cmpgt_epi32(bits, _mm_set1_epi32(0x477FE000));
+        __m128i denormal = _mm_cmplt_epi32(bits, _mm_set1_epi32(113 << 23));
+        __m128i small = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(value, _mm_set1_ps(0.5f))), _mm_set1_epi32(0x3F000000));
+        __m128i odd = _mm_and_si128(_mm_srli_epi32(bits, 13), _mm_set1_epi32(1));
+        __m128i normal = _mm_srli_epi32(_mm_add_epi32(_mm_sub_epi32(bits, _mm_set1_epi32(112 << 23)), _mm_add_epi32(_mm_set1_epi32(0xFFF), odd)), 13);
+        __m128i half = _mm_or_si128(_mm_and_si128(denormal, small), _mm_andnot_si128(denormal, normal));
+        return _mm_or_si128(_mm_and_si128(overflow, _mm_set1_epi32(0x7BFF)), _mm_andnot_si128(overflow, half));
+    }
+#endif
+};
+#endif
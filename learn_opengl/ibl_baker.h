@@ -0,0 +1,449 @@
+#ifndef IBL_BAKER_H
+#define IBL_BAKER_H
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <cmath>
+
+#if !defined(IBL_BAKER_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define IBL_BAKER_SSE 1
+#endif
+
+// one level of an RGB float cube map: faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X order, each size x size texels with the
+// rows bottom up, as glTexImage2D takes them
+struct CubeMapLevel {
+    int size;
+    std::vector<float> texels;
+
+    void Resize(int levelSize)
+    {
+        size = levelSize;
+        texels.assign(6 * size * size * 3, 0.0f);
+    }
+    float* Texel(int face, int x, int y) { return &texels[((face * size + y) * size + x) * 3]; }
+    const float* Texel(int face, int x, int y) const { return &texels[((face * size + y) * size + x) * 3]; }
+};
+
+// CPU version of the Specular IBL precomputation: the environment cube map from an equirectangular HDR image, its
+// irradiance and GGX prefiltered cube maps and the split sum BRDF lookup table, without a GPU.
+//
+// Each bake follows its shader (2.2.1.equirectangular_to_cubemap.fs, 2.2.1.irradiance_convolution.fs,
+// 2.2.1.prefilter.fs, 2.2.1.brdf.fs) and spreads rows of texels over every core. The shaders' brute force loops
+// are cut down where the result allows it:
+// - irradiance is a smooth function, so it is integrated exactly, texel by texel with their solid angles, over a
+//   small level of the environment's mip chain instead of 16000 lookups per texel; four source texels at a time
+//   with SSE2.
+// - the prefilter takes prefilterSampleCount GGX samples instead of 1024. Each one reads the environment's mip level
+//   whose texels cover as much solid angle as the sample stands for (filtered importance sampling, as the shader
+//   does), so fewer samples blur rather than add noise.
+// - the BRDF lookup table takes the shader's 1024 samples, four at a time with SSE2.
+class IBLBaker
+{
+public:
+    int threadCount;          // <= 0 uses every hardware thread
+    int prefilterSampleCount; // per texel and roughness above 0
+    int irradianceSourceSize; // size of the environment level the irradiance is integrated over
+
+    std::vector<CubeMapLevel> environment; // the whole mip chain, box filtered like glGenerateMipmap
+    std::vector<CubeMapLevel> irradiance;  // one level
+    std::vector<CubeMapLevel> prefilter;   // one level per roughness
+    std::vector<float> brdfLUT;            // RG, brdfLUTSize x brdfLUTSize, NdotV along x, roughness along y
+    int brdfLUTSize;
+
+    IBLBaker(int threadCount = 0)
+        : threadCount(threadCount), prefilterSampleCount(256), irradianceSourceSize(32), brdfLUTSize(0)
+    {
+    }
+
+    // equirectangular: width x height texels of channels floats, bottom row first (stbi_loadf with vertical flip)
+    void BakeEnvironment(const float *equirectangular, int width, int height, int channels, int size)
+    {
+        int levels = 1;
+        while ((size >> levels) > 0)
+            levels++;
+        environment.resize(levels);
+        environment[0].Resize(size);
+        CubeMapLevel &base = environment[0];
+        parallelFor(6 * size, [&](int row) {
+            int face = row / size, y = row % size;
+            for (int x = 0; x < size; x++)
+            {
+                glm::vec3 v = glm::normalize(FaceDirection(face, (x + 0.5f) / size * 2.0f - 1.0f, (y + 0.5f) / size * 2.0f - 1.0f));
+                // SampleSphericalMap, constants and all
+                glm::vec2 uv = glm::vec2(std::atan2(v.z, v.x), std::asin(v.y)) * glm::vec2(0.1591f, 0.3183f) + 0.5f;
+                glm::vec3 color = sampleEquirectangular(equirectangular, width, height, channels, uv);
+                float *texel = base.Texel(face, x, y);
+                texel[0] = color.r; texel[1] = color.g; texel[2] = color.b;
+            }
+        });
+        for (int level = 1; level < levels; level++)
+        {
+            const CubeMapLevel &source = environment[level - 1];
+            CubeMapLevel &target = environment[level];
+            target.Resize(std::max(1, source.size / 2));
+            parallelFor(6 * target.size, [&](int row) {
+                int face = row / target.size, y = row % target.size;
+                for (int x = 0; x < target.size; x++)
+                {
+                    int x0 = std::min(2 * x, source.size - 1), x1 = std::min(2 * x + 1, source.size - 1);
+                    int y0 = std::min(2 * y, source.size - 1), y1 = std::min(2 * y + 1, source.size - 1);
+                    for (int c = 0; c < 3; c++)
+                        target.Texel(face, x, y)[c] = 0.25f * (source.Texel(face, x0, y0)[c] + source.Texel(face, x1, y0)[c] +
+                                                               source.Texel(face, x0, y1)[c] + source.Texel(face, x1, y1)[c]);
+                }
+            });
+        }
+    }
+
+    // after BakeEnvironment(): E(N) / PI, the cosine weighted average of the environment over the hemisphere around N
+    void BakeIrradiance(int size)
+    {
+        int sourceLevel = 0;
+        while (sourceLevel < (int)environment.size() - 1 && environment[sourceLevel].size > irradianceSourceSize)
+            sourceLevel++;
+        const CubeMapLevel &source = environment[sourceLevel];
+
+        // every source texel's direction and radiance times its solid angle, as structures of arrays padded to a
+        // multiple of four with texels of no weight
+        int count = 6 * source.size * source.size;
+        int padded = (count + 3) & ~3;
+        std::vector<float> dx(padded, 0.0f), dy(padded, 0.0f), dz(padded, 0.0f), r(padded, 0.0f), g(padded, 0.0f), b(padded, 0.0f);
+        for (int face = 0, i = 0; face < 6; face++)
+        {
+            for (int y = 0; y < source.size; y++)
+            {
+                for (int x = 0; x < source.size; x++, i++)
+                {
+                    float u0 = 2.0f * x / source.size - 1.0f, u1 = 2.0f * (x + 1) / source.size - 1.0f;
+                    float v0 = 2.0f * y / source.size - 1.0f, v1 = 2.0f * (y + 1) / source.size - 1.0f;
+                    float weight = TexelSolidAngle(u0, v0, u1, v1) / 3.14159265359f;
+                    glm::vec3 d = glm::normalize(FaceDirection(face, 0.5f * (u0 + u1), 0.5f * (v0 + v1)));
+                    const float *texel = source.Texel(face, x, y);
+                    dx[i] = d.x; dy[i] = d.y; dz[i] = d.z;
+                    r[i] = texel[0] * weight; g[i] = texel[1] * weight; b[i] = texel[2] * weight;
+                }
+            }
+        }
+
+        irradiance.resize(1);
+        irradiance[0].Resize(size);
+        CubeMapLevel &target = irradiance[0];
+        parallelFor(6 * size, [&](int row) {
+            int face = row / size, y = row % size;
+            for (int x = 0; x < size; x++)
+            {
+                glm::vec3 n = glm::normalize(FaceDirection(face, (x + 0.5f) / size * 2.0f - 1.0f, (y + 0.5f) / size * 2.0f - 1.0f));
+                float sum[3];
+#ifdef IBL_BAKER_SSE
+                __m128 nx = _mm_set1_ps(n.x), ny = _mm_set1_ps(n.y), nz = _mm_set1_ps(n.z), zero = _mm_setzero_ps();
+                __m128 sumR = zero, sumG = zero, sumB = zero;
+                for (int i = 0; i < padded; i += 4)
+                {
+                    __m128 cosine = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, _mm_loadu_ps(&dx[i])), _mm_mul_ps(ny, _mm_loadu_ps(&dy[i]))),
+                                               _mm_mul_ps(nz, _mm_loadu_ps(&dz[i])));
+                    cosine = _mm_max_ps(cosine, zero);
+                    sumR = _mm_add_ps(sumR, _mm_mul_ps(cosine, _mm_loadu_ps(&r[i])));
+                    sumG = _mm_add_ps(sumG, _mm_mul_ps(cosine, _mm_loadu_ps(&g[i])));
+                    sumB = _mm_add_ps(sumB, _mm_mul_ps(cosine, _mm_loadu_ps(&b[i])));
+                }
+                sum[0] = horizontalSum(sumR); sum[1] = horizontalSum(sumG); sum[2] = horizontalSum(sumB);
+#else
+                sum[0] = sum[1] = sum[2] = 0.0f;
+                for (int i = 0; i < padded; i++)
+                {
+                    float cosine = std::max(n.x * dx[i] + n.y * dy[i] + n.z * dz[i], 0.0f);
+                    sum[0] += cosine * r[i]; sum[1] += cosine * g[i]; sum[2] += cosine * b[i];
+                }
+#endif
+                float *texel = target.Texel(face, x, y);
+                texel[0] = sum[0]; texel[1] = sum[1]; texel[2] = sum[2];
+            }
+        });
+    }
+
+    // after BakeEnvironment(): mipLevels levels from size down, roughness 0 to 1
+    void BakePrefilter(int size, int mipLevels)
+    {
+        prefilter.resize(mipLevels);
+        for (int mip = 0; mip < mipLevels; mip++)
+        {
+            float roughness = mipLevels > 1 ? (float)mip / (float)(mipLevels - 1) : 0.0f;
+            // with N = V the samples only depend on the roughness: their light directions in tangent space, NdotL
+            // in w, and the level each one reads, worked out once per level. At roughness 0 they all fall on N
+            int sampleCount = roughness == 0.0f ? 1 : prefilterSampleCount;
+            std::vector<glm::vec4> samples;
+            std::vector<float> lods;
+            for (int i = 0; i < sampleCount; i++)
+            {
+                glm::vec3 h = ImportanceSampleGGX(Hammersley(i, sampleCount), glm::vec3(0.0f, 0.0f, 1.0f), roughness);
+                glm::vec3 l = glm::normalize(2.0f * h.z * h - glm::vec3(0.0f, 0.0f, 1.0f));
+                if (l.z <= 0.0f)
+                    continue;
+                samples.push_back(glm::vec4(l, l.z));
+                lods.push_back(roughness == 0.0f ? 0.0f : SampleLod(h.z, roughness, sampleCount, environment[0].size));
+            }
+
+            prefilter[mip].Resize(std::max(1, size >> mip));
+            CubeMapLevel &target = prefilter[mip];
+            parallelFor(6 * target.size, [&](int row) {
+                int face = row / target.size, y = row % target.size;
+                for (int x = 0; x < target.size; x++)
+                {
+                    glm::vec3 n = glm::normalize(FaceDirection(face, (x + 0.5f) / target.size * 2.0f - 1.0f, (y + 0.5f) / target.size * 2.0f - 1.0f));
+                    glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+                    glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+                    glm::vec3 bitangent = glm::cross(n, tangent);
+                    glm::vec3 color(0.0f);
+                    float totalWeight = 0.0f;
+                    for (unsigned int i = 0; i < samples.size(); i++)
+                    {
+                        glm::vec3 l = tangent * samples[i].x + bitangent * samples[i].y + n * samples[i].z;
+                        color += SampleEnvironment(l, lods[i]) * samples[i].w;
+                        totalWeight += samples[i].w;
+                    }
+                    color /= totalWeight;
+                    float *texel = target.Texel(face, x, y);
+                    texel[0] = color.r; texel[1] = color.g; texel[2] = color.b;
+                }
+            });
+        }
+    }
+
+    void BakeBRDFLUT(int size, int sampleCount = 1024)
+    {
+        brdfLUTSize = size;
+        brdfLUT.assign(size * size * 2, 0.0f);
+        parallelFor(size, [&](int y) {
+            float roughness = (y + 0.5f) / size;
+            // the row's half vectors: their x and z are all the integral needs, as V has no y
+            int padded = (sampleCount + 3) & ~3;
+            std::vector<float> hx(padded, 0.0f), hz(padded, 1.0f), valid(padded, 0.0f);
+            for (int i = 0; i < sampleCount; i++)
+            {
+                glm::vec3 h = ImportanceSampleGGX(Hammersley(i, sampleCount), glm::vec3(0.0f, 0.0f, 1.0f), roughness);
+                hx[i] = h.x; hz[i] = h.z; valid[i] = 1.0f;
+            }
+            float k = roughness * roughness / 2.0f;
+            for (int x = 0; x < size; x++)
+            {
+                float NdotV = (x + 0.5f) / size;
+                float vx = std::sqrt(1.0f - NdotV * NdotV), vz = NdotV;
+                float geometryV = NdotV / (NdotV * (1.0f - k) + k);
+                float a, b;
+#ifdef IBL_BAKER_SSE
+                __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), two = _mm_set1_ps(2.0f);
+                __m128 vx4 = _mm_set1_ps(vx), vz4 = _mm_set1_ps(vz), k4 = _mm_set1_ps(k), oneMinusK = _mm_set1_ps(1.0f - k);
+                __m128 scale = _mm_set1_ps(geometryV / NdotV);
+                __m128 sumA = zero, sumB = zero;
+                for (int i = 0; i < padded; i += 4)
+                {
+                    __m128 h_x = _mm_loadu_ps(&hx[i]), h_z = _mm_loadu_ps(&hz[i]);
+                    __m128 VdotHSigned = _mm_add_ps(_mm_mul_ps(vx4, h_x), _mm_mul_ps(vz4, h_z));
+                    __m128 NdotL = _mm_sub_ps(_mm_mul_ps(_mm_mul_ps(two, VdotHSigned), h_z), vz4);
+                    __m128 mask = _mm_and_ps(_mm_cmpgt_ps(NdotL, zero), _mm_cmpgt_ps(_mm_loadu_ps(&valid[i]), zero));
+                    NdotL = _mm_max_ps(NdotL, zero);
+                    __m128 VdotH = _mm_max_ps(VdotHSigned, zero);
+                    __m128 geometryL = _mm_div_ps(NdotL, _mm_add_ps(_mm_mul_ps(NdotL, oneMinusK), k4));
+                    // G * VdotH / (NdotH * NdotV), with G's view half folded into scale
+                    __m128 visibility = _mm_div_ps(_mm_mul_ps(_mm_mul_ps(geometryL, scale), VdotH), h_z);
+                    visibility = _mm_and_ps(visibility, mask);
+                    __m128 f = _mm_sub_ps(one, VdotH);
+                    __m128 f2 = _mm_mul_ps(f, f);
+                    __m128 fresnel = _mm_mul_ps(_mm_mul_ps(f2, f2), f);
+                    sumA = _mm_add_ps(sumA, _mm_mul_ps(_mm_sub_ps(one, fresnel), visibility));
+                    sumB = _mm_add_ps(sumB, _mm_mul_ps(fresnel, visibility));
+                }
+                a = horizontalSum(sumA);
+                b = horizontalSum(sumB);
+#else
+                a = b = 0.0f;
+                for (int i = 0; i < sampleCount; i++)
+                {
+                    float VdotHSigned = vx * hx[i] + vz * hz[i];
+                    float NdotL = 2.0f * VdotHSigned * hz[i] - vz;
+                    if (NdotL <= 0.0f)
+                        continue;
+                    float VdotH = std::max(VdotHSigned, 0.0f);
+                    float geometryL = NdotL / (NdotL * (1.0f - k) + k);
+                    float visibility = geometryL * geometryV * VdotH / (hz[i] * NdotV);
+                    float fresnel = std::pow(1.0f - VdotH, 5.0f);
+                    a += (1.0f - fresnel) * visibility;
+                    b += fresnel * visibility;
+                }
+#endif
+                brdfLUT[(y * size + x) * 2 + 0] = a / sampleCount;
+                brdfLUT[(y * size + x) * 2 + 1] = b / sampleCount;
+            }
+        });
+    }
+
+    // trilinear lookup in the environment's mip chain, lod clamped to it like textureLod; faces clamp at their edges
+    glm::vec3 SampleEnvironment(const glm::vec3 &direction, float lod) const
+    {
+        lod = std::min(std::max(lod, 0.0f), (float)(environment.size() - 1));
+        int level = (int)lod;
+        float t = lod - level;
+        glm::vec3 color = sampleLevel(environment[level], direction);
+        if (t > 0.0f && level + 1 < (int)environment.size())
+            color = glm::mix(color, sampleLevel(environment[level + 1], direction), t);
+        return color;
+    }
+
+    // the direction through a cube map face at u, v in [-1, 1], not normalized
+    static glm::vec3 FaceDirection(int face, float u, float v)
+    {
+        switch (face)
+        {
+            case 0: return glm::vec3( 1.0f, -v, -u);
+            case 1: return glm::vec3(-1.0f, -v,  u);
+            case 2: return glm::vec3( u,  1.0f,  v);
+            case 3: return glm::vec3( u, -1.0f, -v);
+            case 4: return glm::vec3( u, -v,  1.0f);
+            default: return glm::vec3(-u, -v, -1.0f);
+        }
+    }
+
+    // solid angle of the part of a cube map face between u0, v0 and u1, v1
+    static float TexelSolidAngle(float u0, float v0, float u1, float v1)
+    {
+        return areaElement(u0, v0) - areaElement(u0, v1) - areaElement(u1, v0) + areaElement(u1, v1);
+    }
+
+    static glm::vec2 Hammersley(unsigned int i, unsigned int n)
+    {
+        unsigned int bits = i;
+        bits = (bits << 16u) | (bits >> 16u);
+        bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+        bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+        bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+        bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+        return glm::vec2((float)i / (float)n, (float)bits * 2.3283064365386963e-10f);
+    }
+
+    static glm::vec3 ImportanceSampleGGX(const glm::vec2 &xi, const glm::vec3 &n, float roughness)
+    {
+        float a = roughness * roughness;
+        float phi = 2.0f * 3.14159265359f * xi.x;
+        float cosTheta = std::sqrt((1.0f - xi.y) / (1.0f + (a * a - 1.0f) * xi.y));
+        float sinTheta = std::sqrt(1.0f - cosTheta * cosTheta);
+        glm::vec3 h(std::cos(phi) * sinTheta, std::sin(phi) * sinTheta, cosTheta);
+        glm::vec3 up = std::abs(n.z) < 0.999f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(1.0f, 0.0f, 0.0f);
+        glm::vec3 tangent = glm::normalize(glm::cross(up, n));
+        glm::vec3 bitangent = glm::cross(n, tangent);
+        return glm::normalize(tangent * h.x + bitangent * h.y + n * h.z);
+    }
+
+    // the environment level a GGX sample reads, from the solid angle it stands for: 2.2.1.prefilter.fs with N = V
+    static float SampleLod(float NdotH, float roughness, int sampleCount, int environmentSize)
+    {
+        float a = roughness * roughness;
+        float a2 = a * a;
+        float denominator = NdotH * NdotH * (a2 - 1.0f) + 1.0f;
+        float D = a2 / (3.14159265359f * denominator * denominator);
+        float pdf = D * NdotH / (4.0f * NdotH) + 0.0001f;
+        float saTexel = 4.0f * 3.14159265359f / (6.0f * environmentSize * environmentSize);
+        float saSample = 1.0f / (float(sampleCount) * pdf + 0.0001f);
+        return 0.5f * std::log2(saSample / saTexel);
+    }
+
+private:
+    template <typename Function>
+    void parallelFor(int count, Function function) const
+    {
+        int threads = threadCount > 0 ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+        threads = std::max(1, std::min(threads, count));
+        // rows cost different amounts, so they are handed out one at a time
+        std::atomic<int> next(0);
+        auto work = [&]() {
+            for (int i = next++; i < count; i = next++)
+                function(i);
+        };
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++)
+            workers.push_back(std::thread(work));
+        work();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+    }
+
+    static float areaElement(float x, float y)
+    {
+        return std::atan2(x * y, std::sqrt(x * x + y * y + 1.0f));
+    }
+
+#ifdef IBL_BAKER_SSE
+    static float horizontalSum(__m128 v)
+    {
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1)));
+        v = _mm_add_ps(v, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 0, 3, 2)));
+        return _mm_cvtss_f32(v);
+    }
+#endif
+
+    // bilinear, clamped to the edges like GL_CLAMP_TO_EDGE; uv as SampleSphericalMap makes them
+    static glm::vec3 sampleEquirectangular(const float *image, int width, int height, int channels, glm::vec2 uv)
+    {
+        float x = uv.x * width - 0.5f, y = uv.y * height - 0.5f;
+        int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+        float fx = x - x0, fy = y - y0;
+        glm::vec3 color(0.0f);
+        for (int j = 0; j < 2; j++)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                int px = std::min(std::max(x0 + i, 0), width - 1), py = std::min(std::max(y0 + j, 0), height - 1);
+                const float *texel = &image[(py * width + px) * channels];
+                float weight = (i ? fx : 1.0f - fx) * (j ? fy : 1.0f - fy);
+                color += weight * glm::vec3(texel[0], texel[channels > 1 ? 1 : 0], texel[channels > 2 ? 2 : 0]);
+            }
+        }
+        return color;
+    }
+
+    static glm::vec3 sampleLevel(const CubeMapLevel &level, const glm::vec3 &d)
+    {
+        // face and coordinates as the GL spec picks them
+        glm::vec3 a = glm::abs(d);
+        int face;
+        float sc, tc, ma;
+        if (a.x >= a.y && a.x >= a.z)
+        {
+            ma = a.x;
+            face = d.x > 0.0f ? 0 : 1;
+            sc = d.x > 0.0f ? -d.z : d.z;
+            tc = -d.y;
+        }
+        else if (a.y >= a.z)
+        {
+            ma = a.y;
+            face = d.y > 0.0f ? 2 : 3;
+            sc = d.x;
+            tc = d.y > 0.0f ? d.z : -d.z;
+        }
+        else
+        {
+            ma = a.z;
+            face = d.z > 0.0f ? 4 : 5;
+            sc = d.z > 0.0f ? d.x : -d.x;
+            tc = -d.y;
+        }
+        float x = (sc / ma + 1.0f) * 0.5f * level.size - 0.5f, y = (tc / ma + 1.0f) * 0.5f * level.size - 0.5f;
+        int x0 = (int)std::floor(x), y0 = (int)std::floor(y);
+        float fx = x - x0, fy = y - y0;
+        int x1 = std::min(x0 + 1, level.size - 1), y1 = std::min(y0 + 1, level.size - 1);
+        x0 = std::max(x0, 0);
+        y0 = std::max(y0, 0);
+        const float *t00 = level.Texel(face, x0, y0), *t10 = level.Texel(face, x1, y0);
+        const float *t01 = level.Texel(face, x0, y1), *t11 = level.Texel(face, x1, y1);
+        glm::vec3 color;
+        for (int c = 0; c < 3; c++)
+            color[c] = (t00[c] * (1.0f - fx) + t10[c] * fx) * (1.0f - fy) + (t01[c] * (1.0f - fx) + t11[c] * fx) * fy;
+        return color;
+    }
+};
+#endif
@@ -0,0 +1,302 @@
+#ifndef IBL_CACHE_H
+#define IBL_CACHE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "half_float.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <iostream>
+
+// 64 bit FNV-1a hash of whatever a precomputed texture is derived from: input files, shader sources, sizes
+struct ContentHash {
+    unsigned long long value;
+
+    ContentHash() : value(14695981039346656037ULL) {}
+
+    ContentHash& Add(const void *data, size_t size)
+    {
+        const unsigned char *bytes = static_cast<const unsigned char*>(data);
+        for (size_t i = 0; i < size; i++)
+        {
+            value ^= bytes[i];
+            value *= 1099511628211ULL;
+        }
+        return *this;
+    }
+
+    ContentHash& AddString(const std::string &text)
+    {
+        return Add(text.c_str(), text.size() + 1);
+    }
+
+    // the file's contents; a missing file adds its path instead, so its key matches nothing cached from when it existed
+    ContentHash& AddFile(const std::string &path)
+    {
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file)
+            return AddString("missing:" + path);
+        char buffer[65536];
+        while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+            Add(buffer, static_cast<size_t>(file.gcount()));
+        return *this;
+    }
+
+    std::string Hex() const
+    {
+        char text[17];
+        std::snprintf(text, sizeof(text), "%016llx", value);
+        return text;
+    }
+};
+
+// the fixed part of a KTX 1.1 file
+struct KTXHeader {
+    unsigned char identifier[12];
+    unsigned int endianness;
+    unsigned int glType, glTypeSize, glFormat, glInternalFormat, glBaseInternalFormat;
+    unsigned int pixelWidth, pixelHeight, pixelDepth;
+    unsigned int numberOfArrayElements, numberOfFaces, numberOfMipmapLevels;
+    unsigned int bytesOfKeyValueData;
+};
+
+// On-disk cache for precomputed image based lighting textures: the environment cube map, its irradiance and
+// prefiltered cube maps, the BRDF lookup table.
+//
+// Each texture is stored, with all its mip levels, as half floats in a KTX 1.1 file named after the texture and
+// the ContentHash of its inputs, which is also kept in the file's key/value data. A texture whose inputs changed
+// gets a new name, so a stale file is never loaded; it is simply left behind. Load() makes the texture straight
+// from the file, with clamp to edge wrapping and (mipmapped) linear filtering; when it fails the caller renders
+// the texture as before and Save()s it. Textures made without GL, e.g. by ibl_baker.h, are stored with Write().
+// Only GL_RGB16F and GL_RG16F textures are handled.
+class IBLCache
+{
+public:
+    std::string prefix; // prepended to the file names, directory included
+    unsigned int loaded, saved;
+
+    IBLCache(const std::string &prefix = "ibl_cache_") : prefix(prefix), loaded(0), saved(0) {}
+
+    // target is GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D. On success texture is a new texture holding the cached
+    // levels, with GL_TEXTURE_MAX_LEVEL set to the last one. A file that doesn't hold what its header promises is
+    // rejected before anything is allocated for it, and the caller renders the texture again
+    bool Load(const std::string &name, const ContentHash &key, GLenum target, GLenum internalFormat, unsigned int &texture)
+    {
+        std::string path = fileName(name, key);
+        std::ifstream file(path.c_str(), std::ios::binary);
+        if (!file)
+            return false;
+        file.seekg(0, std::ios::end);
+        unsigned long long fileSize = static_cast<unsigned long long>(file.tellg());
+        file.seekg(0, std::ios::beg);
+        KTXHeader header;
+        if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || !validHeader(header, target, internalFormat, fileSize))
+        {
+            std::cout << "ERROR::IBL_CACHE: " << path << " is corrupt, rendering it again" << std::endl;
+            return false;
+        }
+        std::vector<char> keyValueData(header.bytesOfKeyValueData);
+        if (!keyValueData.empty() && !file.read(&keyValueData[0], keyValueData.size()))
+            return false;
+        if (keyValueData != makeKeyValueData(key))
+            return false;
+
+        unsigned int format = header.glFormat;
+        std::vector<std::vector<char> > levels(header.numberOfMipmapLevels);
+        for (unsigned int level = 0; level < header.numberOfMipmapLevels; level++)
+        {
+            unsigned int imageSize = 0;
+            if (!file.read(reinterpret_cast<char*>(&imageSize), sizeof(imageSize)))
+                return false;
+            int width = std::max(1u, header.pixelWidth >> level), height = std::max(1u, header.pixelHeight >> level);
+            if (imageSize != faceSize(format, width, height))
+                return false;
+            levels[level].resize(static_cast<size_t>(imageSize) * header.numberOfFaces);
+            if (!file.read(&levels[level][0], levels[level].size()))
+                return false;
+        }
+
+        glGenTextures(1, &texture);
+        glBindTexture(target, texture);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4); // KTX rows are 4 byte aligned
+        for (unsigned int level = 0; level < header.numberOfMipmapLevels; level++)
+        {
+            int width = std::max(1u, header.pixelWidth >> level), height = std::max(1u, header.pixelHeight >> level);
+            size_t size = faceSize(format, width, height);
+            for (unsigned int face = 0; face < header.numberOfFaces; face++)
+                glTexImage2D(faceTarget(target, face), level, internalFormat, width, height, 0, format, GL_HALF_FLOAT, &levels[level][face * size]);
+        }
+        glTexParameteri(target, GL_TEXTURE_MAX_LEVEL, header.numberOfMipmapLevels - 1);
+        glTexParameteri(target, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, header.numberOfMipmapLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        loaded++;
+        return true;
+    }
+
+    // reads the first levelCount levels of texture back and writes them out; the file is written under a temporary
+    // name and renamed, so an interrupted run never leaves a truncated file to be loaded
+    void Save(const std::string &name, const ContentHash &key, GLenum target, GLenum internalFormat, unsigned int texture, int levelCount)
+    {
+        GLint width = 0, height = 0;
+        glBindTexture(target, texture);
+        glGetTexLevelParameteriv(faceTarget(target, 0), 0, GL_TEXTURE_WIDTH, &width);
+        glGetTexLevelParameteriv(faceTarget(target, 0), 0, GL_TEXTURE_HEIGHT, &height);
+        unsigned int format = internalFormat == GL_RGB16F ? GL_RGB : GL_RG;
+        unsigned int faces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        std::vector<std::vector<char> > levels(levelCount);
+        for (int level = 0; level < levelCount; level++)
+        {
+            size_t size = faceSize(format, std::max(1, width >> level), std::max(1, height >> level));
+            levels[level].resize(size * faces);
+            for (unsigned int face = 0; face < faces; face++)
+                glGetTexImage(faceTarget(target, face), level, format, GL_HALF_FLOAT, &levels[level][face * size]);
+        }
+        Write(name, key, target, internalFormat, width, height, levels);
+    }
+
+    // writes levels already in the file's layout: per level every face in turn, half floats, rows padded to 4 bytes
+    // (see PackHalf()). The file is written under a temporary name and renamed, so an interrupted run never leaves a
+    // truncated file to be loaded
+    void Write(const std::string &name, const ContentHash &key, GLenum target, GLenum internalFormat, int width, int height,
+               const std::vector<std::vector<char> > &levels)
+    {
+        KTXHeader header = makeHeader(target, internalFormat, width, height, static_cast<unsigned int>(levels.size()));
+        std::vector<char> keyValueData = makeKeyValueData(key);
+        header.bytesOfKeyValueData = static_cast<unsigned int>(keyValueData.size());
+
+        std::string path = fileName(name, key);
+        std::string temporaryPath = path + ".tmp";
+        std::ofstream file(temporaryPath.c_str(), std::ios::binary);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(&keyValueData[0], keyValueData.size());
+        for (unsigned int level = 0; level < levels.size(); level++)
+        {
+            unsigned int imageSize = static_cast<unsigned int>(levels[level].size() / header.numberOfFaces);
+            file.write(reinterpret_cast<const char*>(&imageSize), sizeof(imageSize));
+            file.write(&levels[level][0], levels[level].size());
+        }
+        file.close();
+        if (!file)
+        {
+            std::cout << "ERROR::IBL_CACHE: could not write " << temporaryPath << std::endl;
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+        std::remove(path.c_str());
+        if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+        {
+            std::cout << "ERROR::IBL_CACHE: could not rename " << temporaryPath << std::endl;
+            std::remove(temporaryPath.c_str());
+            return;
+        }
+        saved++;
+    }
+
+    // one level for Write(): faces x height x width texels of channels (2 or 3) floats, as half floats with the rows
+    // padded to 4 bytes
+    static std::vector<char> PackHalf(const float *texels, int channels, int width, int height, int faces)
+    {
+        size_t rowSize = faceSize(channels == 3 ? GL_RGB : GL_RG, width, 1);
+        std::vector<char> data(rowSize * height * faces, 0);
+        for (int row = 0; row < height * faces; row++)
+        {
+            for (int i = 0; i < width * channels; i++)
+            {
+                unsigned short half = halfFromFloat(texels[static_cast<size_t>(row) * width * channels + i]);
+                std::memcpy(&data[row * rowSize + i * sizeof(half)], &half, sizeof(half));
+            }
+        }
+        return data;
+    }
+
+private:
+    // header matches the texture asked for and describes levels the GL can make and the file can hold
+    static bool validHeader(const KTXHeader &header, GLenum target, GLenum internalFormat, unsigned long long fileSize)
+    {
+        KTXHeader expected = makeHeader(target, internalFormat, header.pixelWidth, header.pixelHeight, header.numberOfMipmapLevels);
+        if (std::memcmp(header.identifier, expected.identifier, sizeof(header.identifier)) != 0 || header.endianness != expected.endianness ||
+            header.glType != GL_HALF_FLOAT || header.glFormat != expected.glFormat || header.glInternalFormat != internalFormat ||
+            header.numberOfFaces != expected.numberOfFaces || header.pixelWidth == 0 || header.pixelHeight == 0)
+            return false;
+        GLint maxSize = 0;
+        glGetIntegerv(target == GL_TEXTURE_CUBE_MAP ? GL_MAX_CUBE_MAP_TEXTURE_SIZE : GL_MAX_TEXTURE_SIZE, &maxSize);
+        if (maxSize <= 0)
+            maxSize = 16384; // the query failed, keep the sizes below from overflowing anyway
+        unsigned int largest = std::max(header.pixelWidth, header.pixelHeight);
+        if (largest > static_cast<unsigned int>(maxSize))
+            return false;
+        unsigned int maxLevels = 1;
+        while (largest >> maxLevels)
+            maxLevels++;
+        if (header.numberOfMipmapLevels == 0 || header.numberOfMipmapLevels > maxLevels)
+            return false;
+        // key/value data, then every level's size and faces
+        unsigned long long dataSize = sizeof(header) + static_cast<unsigned long long>(header.bytesOfKeyValueData);
+        for (unsigned int level = 0; level < header.numberOfMipmapLevels; level++)
+        {
+            int width = std::max(1u, header.pixelWidth >> level), height = std::max(1u, header.pixelHeight >> level);
+            dataSize += sizeof(unsigned int) + static_cast<unsigned long long>(faceSize(header.glFormat, width, height)) * header.numberOfFaces;
+        }
+        return dataSize <= fileSize;
+    }
+
+    std::string fileName(const std::string &name, const ContentHash &key) const
+    {
+        return prefix + name + "_" + key.Hex() + ".ktx";
+    }
+
+    static GLenum faceTarget(GLenum target, unsigned int face)
+    {
+        return target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : target;
+    }
+
+    // bytes in one face of one level, rows padded to 4 bytes
+    static unsigned int faceSize(unsigned int format, int width, int height)
+    {
+        unsigned int channels = format == GL_RGB ? 3 : 2;
+        unsigned int rowSize = (width * channels * 2 + 3) & ~3u;
+        return rowSize * height;
+    }
+
+    static KTXHeader makeHeader(GLenum target, GLenum internalFormat, unsigned int width, unsigned int height, unsigned int levels)
+    {
+        static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+        KTXHeader header;
+        std::memcpy(header.identifier, identifier, sizeof(identifier));
+        header.endianness = 0x04030201;
+        header.glType = GL_HALF_FLOAT;
+        header.glTypeSize = 2;
+        header.glFormat = internalFormat == GL_RGB16F ? GL_RGB : GL_RG;
+        header.glInternalFormat = internalFormat;
+        header.glBaseInternalFormat = header.glFormat;
+        header.pixelWidth = width;
+        header.pixelHeight = height;
+        header.pixelDepth = 0;
+        header.numberOfArrayElements = 0;
+        header.numberOfFaces = target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+        header.numberOfMipmapLevels = levels;
+        header.bytesOfKeyValueData = 0;
+        return header;
+    }
+
+    // one key/value pair holding the content hash, padded to 4 bytes
+    static std::vector<char> makeKeyValueData(const ContentHash &key)
+    {
+        std::string pair = std::string("LearnOpenGL.contentHash") + '\0' + key.Hex() + '\0';
+        unsigned int pairSize = static_cast<unsigned int>(pair.size());
+        std::vector<char> data(sizeof(pairSize) + ((pairSize + 3) & ~3u), 0);
+        std::memcpy(&data[0], &pairSize, sizeof(pairSize));
+        std::memcpy(&data[sizeof(pairSize)], pair.data(), pair.size());
+        return data;
+    }
+};
+#endif
@@ -0,0 +1,309 @@
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include "shader.h"
+#include "gl_state.h"
+
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if !defined(LIGHT_CLUSTERS_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define LIGHT_CLUSTERS_SSE 1
+#endif
+
+// point light as the deferred samples use it; Radius is where the attenuation drops below visible
+struct ClusterLight {
+    glm::vec3 Position;
+    glm::vec3 Color;
+    float Linear;
+    float Quadratic;
+    float Radius;
+};
+
+struct LightClusterStats {
+    unsigned int lights;        // lights that touched at least one cluster
+    unsigned int indices;       // total entries of the light index list
+    unsigned int maxPerCluster; // worst cluster
+    unsigned int binTimeUs;     // CPU time of the last Build()
+};
+
+// Clustered light assignment for a fullscreen lighting pass.
+//
+// The view frustum is cut into tileSize x tileSize pixel tiles and `slices` exponential depth slices.
+// Build() bins every light into the clusters its sphere touches (sphere vs cluster AABB, 4 tiles
+// at a time with SSE) and uploads three buffer textures the lighting shader reads:
+//   lightData     RGBA32F, 3 texels per light: (Position, Radius), (Color, 0), (Linear, Quadratic, 0, 0)
+//   clusterGrid   RG32UI, per cluster: (first index, count), cluster = (slice * tilesY + tileY) * tilesX + tileX
+//   lightIndices  R32UI, the light indices of every cluster back to back
+// Buffer textures are core in 3.1, so this needs no compute shaders.
+class LightClusters
+{
+public:
+    int tilesX, tilesY, slices, tileSize;
+    LightClusterStats stats;
+
+    LightClusters(int screenWidth, int screenHeight, int tileSize = 32, int slices = 16)
+        : slices(slices), tileSize(tileSize), width(screenWidth), height(screenHeight), nearPlane(0.1f), farPlane(100.0f),
+          tanX(1.0f), tanY(1.0f), lightCount(0)
+    {
+        tilesX = (screenWidth + tileSize - 1) / tileSize;
+        tilesY = (screenHeight + tileSize - 1) / tileSize;
+        paddedX = (tilesX + 3) & ~3;
+        stats.lights = stats.indices = stats.maxPerCluster = stats.binTimeUs = 0;
+
+        glGenBuffers(3, buffers);
+        glGenTextures(3, textures);
+        GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+        for (int i = 0; i < 3; i++)
+        {
+            glState().BindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+            glBufferData(GL_TEXTURE_BUFFER, 16, NULL, GL_STREAM_DRAW);
+            glState().BindTexture(0, GL_TEXTURE_BUFFER, textures[i]);
+            glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+        }
+        glState().BindTexture(0, GL_TEXTURE_BUFFER, 0);
+        glState().BindBuffer(GL_TEXTURE_BUFFER, 0);
+    }
+
+    // must match the projection the lighting pass reconstructs positions with; call again when it changes
+    void SetProjection(float fovy, float aspect, float zNear, float zFar)
+    {
+        nearPlane = zNear;
+        farPlane = zFar;
+        tanY = std::tan(fovy * 0.5f);
+        tanX = tanY * aspect;
+        int count = paddedX * tilesY * slices;
+        for (int a = 0; a < 3; a++)
+        {
+            boundsMin[a].assign(count, 1e30f);  // padding tiles stay empty and never hit
+            boundsMax[a].assign(count, -1e30f);
+        }
+        for (int z = 0; z < slices; z++)
+        {
+            float d0 = sliceDepth(z), d1 = sliceDepth(z + 1);
+            for (int y = 0; y < tilesY; y++)
+            {
+                float ny0 = 2.0f * (y * tileSize) / height - 1.0f;
+                float ny1 = 2.0f * std::min((y + 1) * tileSize, height) / height - 1.0f;
+                for (int x = 0; x < tilesX; x++)
+                {
+                    float nx0 = 2.0f * (x * tileSize) / width - 1.0f;
+                    float nx1 = 2.0f * std::min((x + 1) * tileSize, width) / width - 1.0f;
+                    // the tile's corner rays cut at both slice depths; view space looks down -z
+                    glm::vec3 lo(1e30f), hi(-1e30f);
+                    float depths[2] = { d0, d1 };
+                    float nxs[2] = { nx0, nx1 }, nys[2] = { ny0, ny1 };
+                    for (int i = 0; i < 8; i++)
+                    {
+                        float d = depths[i & 1];
+                        glm::vec3 p(nxs[(i >> 1) & 1] * tanX * d, nys[i >> 2] * tanY * d, -d);
+                        lo = glm::min(lo, p);
+                        hi = glm::max(hi, p);
+                    }
+                    int c = (z * tilesY + y) * paddedX + x;
+                    for (int a = 0; a < 3; a++)
+                    {
+                        boundsMin[a][c] = lo[a];
+                        boundsMax[a][c] = hi[a];
+                    }
+                }
+            }
+        }
+    }
+
+    // bins lights [0, count) for this view and uploads the cluster buffers
+    void Build(const std::vector<ClusterLight> &lights, unsigned int count, const glm::mat4 &view)
+    {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        count = std::min(count, static_cast<unsigned int>(lights.size()));
+        int clusterCount = tilesX * tilesY * slices;
+        counts.assign(clusterCount, 0);
+        hits.clear();
+        stats.lights = 0;
+
+        for (unsigned int i = 0; i < count; i++)
+        {
+            size_t before = hits.size();
+            binLight(glm::vec3(view * glm::vec4(lights[i].Position, 1.0f)), lights[i].Radius, i);
+            if (hits.size() != before)
+                stats.lights++;
+        }
+
+        // counting sort of the (cluster, light) pairs into one index list
+        grid.resize(clusterCount * 2);
+        unsigned int offset = 0;
+        stats.maxPerCluster = 0;
+        for (int c = 0; c < clusterCount; c++)
+        {
+            grid[c * 2] = offset;
+            grid[c * 2 + 1] = 0;
+            offset += counts[c];
+            stats.maxPerCluster = std::max(stats.maxPerCluster, counts[c]);
+        }
+        indices.resize(std::max<size_t>(hits.size(), 1));
+        for (size_t h = 0; h < hits.size(); h++)
+        {
+            unsigned int c = hits[h].cluster;
+            indices[grid[c * 2] + grid[c * 2 + 1]++] = hits[h].light;
+        }
+        stats.indices = static_cast<unsigned int>(hits.size());
+
+        lightData.resize(std::max(count, 1u) * 3);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            lightData[i * 3 + 0] = glm::vec4(lights[i].Position, lights[i].Radius);
+            lightData[i * 3 + 1] = glm::vec4(lights[i].Color, 0.0f);
+            lightData[i * 3 + 2] = glm::vec4(lights[i].Linear, lights[i].Quadratic, 0.0f, 0.0f);
+        }
+        stats.binTimeUs = static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count());
+
+        // orphan and refill: last frame's lighting pass may still be reading the old storage
+        upload(0, &lightData[0], lightData.size() * sizeof(glm::vec4));
+        upload(1, &grid[0], grid.size() * sizeof(unsigned int));
+        upload(2, &indices[0], indices.size() * sizeof(unsigned int));
+        lightCount = count;
+    }
+
+    // binds the buffers to units firstUnit..firstUnit+2 and sets the cluster uniforms
+    void Bind(Shader &shader, unsigned int firstUnit)
+    {
+        shader.use();
+        for (int i = 0; i < 3; i++)
+            glState().BindTexture(firstUnit + i, GL_TEXTURE_BUFFER, textures[i]);
+        shader.setInt("lightData", firstUnit);
+        shader.setInt("clusterGrid", firstUnit + 1);
+        shader.setInt("lightIndices", firstUnit + 2);
+        shader.setInt("lightCount", static_cast<int>(lightCount));
+        shader.setInt("tileSize", tileSize);
+        glUniform3i(glGetUniformLocation(shader.ID, "clusterCounts"), tilesX, tilesY, slices);
+        // slice = log(depth) * sliceScale + sliceBias
+        float logRatio = std::log(farPlane / nearPlane);
+        shader.setFloat("sliceScale", slices / logRatio);
+        shader.setFloat("sliceBias", -slices * std::log(nearPlane) / logRatio);
+    }
+
+private:
+    struct Hit {
+        unsigned int cluster;
+        unsigned int light;
+    };
+
+    int width, height, paddedX;
+    float nearPlane, farPlane, tanX, tanY;
+    unsigned int lightCount;
+    unsigned int buffers[3], textures[3];
+    std::vector<float> boundsMin[3], boundsMax[3]; // SoA cluster AABBs in view space, rows padded to 4 tiles
+    std::vector<unsigned int> counts, grid, indices;
+    std::vector<Hit> hits;
+    std::vector<glm::vec4> lightData;
+
+    float sliceDepth(int slice) const
+    {
+        return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / slices);
+    }
+
+    int sliceOf(float depth) const
+    {
+        int slice = static_cast<int>(std::floor(std::log(depth / nearPlane) / std::log(farPlane / nearPlane) * slices));
+        return std::max(0, std::min(slices - 1, slice));
+    }
+
+    int tileOf(float ndc, int pixels, int tiles) const
+    {
+        int tile = static_cast<int>(std::floor((ndc * 0.5f + 0.5f) * pixels / tileSize));
+        return std::max(0, std::min(tiles - 1, tile));
+    }
+
+    void binLight(const glm::vec3 &center, float radius, unsigned int light)
+    {
+        float depth = -center.z;
+        if (depth + radius < nearPlane || depth - radius > farPlane)
+            return;
+        int z0 = sliceOf(std::max(depth - radius, nearPlane));
+        int z1 = sliceOf(std::min(depth + radius, farPlane));
+
+        // screen rectangle of the sphere's bounding box; a sphere crossing the near plane may cover anything
+        int x0 = 0, x1 = tilesX - 1, y0 = 0, y1 = tilesY - 1;
+        if (depth - radius > nearPlane)
+        {
+            float nearD = depth - radius, farD = depth + radius;
+            float lx = center.x - radius, hx = center.x + radius;
+            float ly = center.y - radius, hy = center.y + radius;
+            float minX = std::min(lx / nearD, lx / farD) / tanX, maxX = std::max(hx / nearD, hx / farD) / tanX;
+            float minY = std::min(ly / nearD, ly / farD) / tanY, maxY = std::max(hy / nearD, hy / farD) / tanY;
+            if (minX > 1.0f || maxX < -1.0f || minY > 1.0f || maxY < -1.0f)
+                return;
+            x0 = tileOf(minX, width, tilesX);
+            x1 = tileOf(maxX, width, tilesX);
+            y0 = tileOf(minY, height, tilesY);
+            y1 = tileOf(maxY, height, tilesY);
+        }
+
+        float radius2 = radius * radius;
+        for (int z = z0; z <= z1; z++)
+            for (int y = y0; y <= y1; y++)
+            {
+                int row = (z * tilesY + y) * paddedX;
+                for (int x = x0 & ~3; x <= x1; x += 4)
+                {
+                    int mask = sphereHits4(row + x, center, radius2);
+                    for (int k = 0; k < 4; k++)
+                    {
+                        if (!(mask & (1 << k)) || x + k < x0 || x + k > x1)
+                            continue;
+                        Hit hit;
+                        hit.cluster = (z * tilesY + y) * tilesX + x + k;
+                        hit.light = light;
+                        hits.push_back(hit);
+                        counts[hit.cluster]++;
+                    }
+                }
+            }
+    }
+
+    // sphere vs the AABBs of 4 consecutive clusters, one bit per hit
+    int sphereHits4(int first, const glm::vec3 &center, float radius2) const
+    {
+#ifdef LIGHT_CLUSTERS_SSE
+        __m128 distance2 = _mm_setzero_ps();
+        for (int a = 0; a < 3; a++)
+        {
+            __m128 c = _mm_set1_ps(center[a]);
+            __m128 below = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boundsMin[a][first]), c), _mm_setzero_ps());
+            __m128 above = _mm_max_ps(_mm_sub_ps(c, _mm_loadu_ps(&boundsMax[a][first])), _mm_setzero_ps());
+            __m128 e = _mm_add_ps(below, above);
+            distance2 = _mm_add_ps(distance2, _mm_mul_ps(e, e));
+        }
+        return _mm_movemask_ps(_mm_cmple_ps(distance2, _mm_set1_ps(radius2)));
+#else
+        int mask = 0;
+        for (int k = 0; k < 4; k++)
+        {
+            float distance2 = 0.0f;
+            for (int a = 0; a < 3; a++)
+            {
+                float e = std::max(boundsMin[a][first + k] - center[a], 0.0f) + std::max(center[a] - boundsMax[a][first + k], 0.0f);
+                distance2 += e * e;
+            }
+            if (distance2 <= radius2)
+                mask |= 1 << k;
+        }
+        return mask;
+#endif
+    }
+
+    void upload(int i, const void *data, size_t size)
+    {
+        glState().BindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_TEXTURE_BUFFER, 0, size, data);
+    }
+};
+#endif
@@ -7,6 +7,7 @@
 #include "glm/gtc/matrix_transform.hpp"
 
 #include "shader.h"
+#include "render_queue.h"
 
 #include <string>
 #include <vector>
@@ -79,7 +80,6 @@ public:
         unsigned int heightNr   = 1;
         for(unsigned int i = 0; i < textures.size(); i++)
         {
-            glActiveTexture(GL_TEXTURE0 + i); // active proper texture unit before binding
             // retrieve texture number (the N in diffuse_textureN)
             string number;
             string name = textures[i].type;
@@ -93,18 +93,34 @@ public:
                 number = std::to_string(heightNr++); // transfer unsigned int to string
 
             // now set the sampler to the correct texture unit
-            glUniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
-            // and finally bind the texture
-            glBindTexture(GL_TEXTURE_2D, textures[i].id);
+            glState().Uniform1i(glGetUniformLocation(shader.ID, (name + number).c_str()), i);
+            // and finally bind the texture (activating the proper texture unit first)
+            glState().BindTexture(i, GL_TEXTURE_2D, textures[i].id);
         }
 
         // draw mesh
-        glBindVertexArray(VAO);
+        glState().BindVertexArray(VAO);
         glDrawElements(GL_TRIANGLES, static_cast<unsigned int>(indices.size()), GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
 
-        // always good practice to set everything back to defaults once configured.
-        glActiveTexture(GL_TEXTURE0);
+        // always good practice to set everything back to defaults once configured, unless the state
+        // cache tracks what is bound: then the next draw only changes what actually differs.
+        if (!glState().Enabled())
+        {
+            glState().BindVertexArray(0);
+            glState().ActiveTexture(0);
+        }
+    }
+
+    // queue the mesh instead of drawing it right away. Textures go to units 0..n-1 in the same order
+    // as Draw() uses, but the sampler uniforms are left to the caller (set them once per program).
+    void Enqueue(RenderQueue &queue, Shader &shader, const glm::mat4 &model, RenderPass pass = PASS_OPAQUE)
+    {
+        unsigned int textureIds[RENDER_QUEUE_MAX_TEXTURES];
+        unsigned int textureCount = 0;
+        for(unsigned int i = 0; i < textures.size() && i < RENDER_QUEUE_MAX_TEXTURES; i++)
+            textureIds[textureCount++] = textures[i].id;
+        unsigned int material = textureCount > 0 ? textureIds[0] : 0;
+        queue.Submit(pass, shader.ID, material, VAO, static_cast<unsigned int>(indices.size()), textureIds, textureCount, model);
     }
 
 private:
@@ -119,9 +135,9 @@ private:
         glGenBuffers(1, &VBO);
         glGenBuffers(1, &EBO);
 
-        glBindVertexArray(VAO);
+        glState().BindVertexArray(VAO);
         // load data into vertex buffers
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glState().BindBuffer(GL_ARRAY_BUFFER, VBO);
         // A great thing about structs is that their memory layout is sequential for all its items.
         // The effect is that we can simply pass a pointer to the struct and it translates perfectly to a glm::vec3/2 array which
         // again translates to 3/2 floats which translates to a byte array.
@@ -153,7 +169,7 @@ private:
 		// weights
 		glEnableVertexAttribArray(6);
 		glVertexAttribPointer(6, 4, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, m_Weights));
-        glBindVertexArray(0);
+        glState().BindVertexArray(0);
     }
 };
 #endif
@@ -46,6 +46,13 @@ public:
             meshes[i].Draw(shader);
     }
 
+    // queues all its meshes with the given model matrix, see Mesh::Enqueue
+    void Enqueue(RenderQueue &queue, Shader &shader, const glm::mat4 &model, RenderPass pass = PASS_OPAQUE)
+    {
+        for(unsigned int i = 0; i < meshes.size(); i++)
+            meshes[i].Enqueue(queue, shader, model, pass);
+    }
+
 private:
     // loads a model with supported ASSIMP extensions from file and stores the resulting meshes in the meshes vector.
     void loadModel(string const &path)
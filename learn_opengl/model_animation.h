@@ -22,6 +22,7 @@
 #include <vector>
 #include "assimp_glm_helpers.h"
 #include "animdata.h"
+#include "dual_quaternion.h"
 
 using namespace std;
 
@@ -33,11 +34,12 @@ public:
     vector<Mesh>    meshes;
     string directory;
     bool gammaCorrection;
+    SkinningMode skinningMode; // which bone palette the model's shader expects
 
 
 
     // constructor, expects a filepath to a 3D model.
-    Model(string const &path, bool gamma = false) : gammaCorrection(gamma)
+    Model(string const &path, bool gamma = false, SkinningMode skinning = SKINNING_LINEAR) : gammaCorrection(gamma), skinningMode(skinning)
     {
         loadModel(path);
     }
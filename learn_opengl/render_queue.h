@@ -0,0 +1,246 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include "gl_state.h"
+
+#include <vector>
+#include <map>
+#include <stdint.h>
+
+#define RENDER_QUEUE_MAX_TEXTURES 4
+
+enum RenderPass {
+    PASS_OPAQUE = 0,
+    PASS_TRANSPARENT = 1
+};
+
+// a single indexed draw, everything needed to submit it without touching the Mesh again
+struct DrawPacket {
+    uint64_t key;
+    unsigned int program;
+    unsigned int VAO;
+    unsigned int textures[RENDER_QUEUE_MAX_TEXTURES]; // bound to texture units 0..textureCount-1
+    unsigned int textureCount;
+    unsigned int indexCount;
+    glm::mat4 model;
+};
+
+// state changes a list of packets costs when submitted in a given order
+struct RenderQueueStats {
+    unsigned int drawCalls;
+    unsigned int programSwitches;
+    unsigned int textureBinds;
+    unsigned int vaoBinds;
+};
+
+// Collects a frame's draws, sorts them by a packed 64-bit key and submits them with minimal state changes.
+//
+// key layout, most significant bits first:
+//   opaque      : pass(2) | program(12) | material(16) | depth(24)            -> grouped by state, then front to back
+//   transparent : pass(2) | inverted depth(24) | program(12) | material(16)   -> back to front first, for correct blending
+class RenderQueue
+{
+public:
+    RenderQueueStats submittedStats; // the frame as it was submitted
+    RenderQueueStats sortedStats;    // the frame as it was actually drawn
+
+    RenderQueue() : nearPlane(0.1f), farPlane(100.0f), view(1.0f)
+    {
+        resetStats(submittedStats);
+        resetStats(sortedStats);
+    }
+
+    // start a new frame; view and clip planes are used to quantize each packet's depth
+    void Begin(const glm::mat4 &viewMatrix, float zNear, float zFar)
+    {
+        view = viewMatrix;
+        nearPlane = zNear;
+        farPlane = zFar;
+        packets.clear();
+    }
+
+    // queues an indexed triangle draw; material is any id shared by draws with the same textures
+    void Submit(RenderPass pass, unsigned int program, unsigned int material, unsigned int VAO, unsigned int indexCount,
+                const unsigned int *textures, unsigned int textureCount, const glm::mat4 &model)
+    {
+        DrawPacket packet;
+        packet.program = program;
+        packet.VAO = VAO;
+        packet.textureCount = textureCount < RENDER_QUEUE_MAX_TEXTURES ? textureCount : RENDER_QUEUE_MAX_TEXTURES;
+        for (unsigned int i = 0; i < packet.textureCount; i++)
+            packet.textures[i] = textures[i];
+        packet.indexCount = indexCount;
+        packet.model = model;
+
+        float depth = -(view * model[3]).z;
+        packet.key = MakeKey(pass, program, material, (depth - nearPlane) / (farPlane - nearPlane));
+        packets.push_back(packet);
+    }
+
+    static uint64_t MakeKey(RenderPass pass, unsigned int program, unsigned int material, float depth01)
+    {
+        depth01 = depth01 < 0.0f ? 0.0f : (depth01 > 1.0f ? 1.0f : depth01);
+        uint64_t depth = (uint64_t)(depth01 * 0xFFFFFF);
+        uint64_t key = (uint64_t)(pass & 0x3) << 62;
+        if (pass == PASS_TRANSPARENT)
+        {
+            key |= (0xFFFFFF - depth) << 38;
+            key |= (uint64_t)(program & 0xFFF) << 26;
+            key |= (uint64_t)(material & 0xFFFF) << 10;
+        }
+        else
+        {
+            key |= (uint64_t)(program & 0xFFF) << 50;
+            key |= (uint64_t)(material & 0xFFFF) << 34;
+            key |= depth << 10;
+        }
+        return key;
+    }
+
+    // sorts the frame's packets and draws them. Every program that shows up must have a mat4 "model" uniform.
+    void Flush()
+    {
+        measure(submittedStats, NULL);
+        sort();
+        if (order.empty())
+        {
+            resetStats(sortedStats);
+            return;
+        }
+        measure(sortedStats, &order[0]);
+
+        unsigned int currentProgram = 0, currentVAO = 0;
+        unsigned int boundTextures[RENDER_QUEUE_MAX_TEXTURES] = { 0 };
+        int modelLocation = -1;
+        for (unsigned int i = 0; i < order.size(); i++)
+        {
+            const DrawPacket &packet = packets[order[i].index];
+            if (packet.program != currentProgram)
+            {
+                glState().UseProgram(packet.program);
+                currentProgram = packet.program;
+                modelLocation = modelUniform(packet.program);
+            }
+            if (packet.VAO != currentVAO)
+            {
+                glState().BindVertexArray(packet.VAO);
+                currentVAO = packet.VAO;
+            }
+            for (unsigned int t = 0; t < packet.textureCount; t++)
+            {
+                if (boundTextures[t] != packet.textures[t])
+                {
+                    glState().BindTexture(t, GL_TEXTURE_2D, packet.textures[t]);
+                    boundTextures[t] = packet.textures[t];
+                }
+            }
+            glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &packet.model[0][0]);
+            glDrawElements(GL_TRIANGLES, packet.indexCount, GL_UNSIGNED_INT, 0);
+        }
+        if (!glState().Enabled())
+        {
+            glState().BindVertexArray(0);
+            glState().ActiveTexture(0);
+        }
+    }
+
+    unsigned int Size() const { return static_cast<unsigned int>(packets.size()); }
+
+private:
+    struct SortItem {
+        uint64_t key;
+        unsigned int index;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<SortItem> order, scratch;
+    std::map<unsigned int, int> modelLocations;
+    float nearPlane, farPlane;
+    glm::mat4 view;
+
+    // LSD radix sort, 8 bits per pass; passes where every key has the same byte are skipped
+    void sort()
+    {
+        unsigned int count = static_cast<unsigned int>(packets.size());
+        order.resize(count);
+        scratch.resize(count);
+        for (unsigned int i = 0; i < count; i++)
+        {
+            order[i].key = packets[i].key;
+            order[i].index = i;
+        }
+        if (count < 2)
+            return;
+
+        for (unsigned int shift = 0; shift < 64; shift += 8)
+        {
+            unsigned int histogram[256] = { 0 };
+            for (unsigned int i = 0; i < count; i++)
+                histogram[(order[i].key >> shift) & 0xFF]++;
+            if (histogram[(order[0].key >> shift) & 0xFF] == count)
+                continue;
+
+            unsigned int offset = 0;
+            for (unsigned int b = 0; b < 256; b++)
+            {
+                unsigned int n = histogram[b];
+                histogram[b] = offset;
+                offset += n;
+            }
+            for (unsigned int i = 0; i < count; i++)
+                scratch[histogram[(order[i].key >> shift) & 0xFF]++] = order[i];
+            order.swap(scratch);
+        }
+    }
+
+    // counts the state changes Flush() issues for the given order (NULL = submission order)
+    void measure(RenderQueueStats &stats, const SortItem *sorted)
+    {
+        resetStats(stats);
+        unsigned int currentProgram = 0, currentVAO = 0;
+        unsigned int boundTextures[RENDER_QUEUE_MAX_TEXTURES] = { 0 };
+        for (unsigned int i = 0; i < packets.size(); i++)
+        {
+            const DrawPacket &packet = packets[sorted ? sorted[i].index : i];
+            if (packet.program != currentProgram)
+            {
+                stats.programSwitches++;
+                currentProgram = packet.program;
+            }
+            if (packet.VAO != currentVAO)
+            {
+                stats.vaoBinds++;
+                currentVAO = packet.VAO;
+            }
+            for (unsigned int t = 0; t < packet.textureCount; t++)
+            {
+                if (boundTextures[t] != packet.textures[t])
+                {
+                    stats.textureBinds++;
+                    boundTextures[t] = packet.textures[t];
+                }
+            }
+            stats.drawCalls++;
+        }
+    }
+
+    int modelUniform(unsigned int program)
+    {
+        std::map<unsigned int, int>::iterator it = modelLocations.find(program);
+        if (it != modelLocations.end())
+            return it->second;
+        int location = glGetUniformLocation(program, "model");
+        modelLocations[program] = location;
+        return location;
+    }
+
+    static void resetStats(RenderQueueStats &stats)
+    {
+        stats.drawCalls = stats.programSwitches = stats.textureBinds = stats.vaoBinds = 0;
+    }
+};
+#endif
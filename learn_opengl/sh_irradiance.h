@@ -0,0 +1,186 @@
+#ifndef SH_IRRADIANCE_H
+#define SH_IRRADIANCE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include "ibl_baker.h"
+
+#include <vector>
+#include <thread>
+#include <algorithm>
+
+// Diffuse irradiance as 9 spherical harmonics coefficients (bands 0 to 2) instead of an irradiance cube map.
+//
+// Irradiance is so smooth that its first three bands hold nearly all of it (Ramamoorthi and Hanrahan, "An
+// Efficient Representation for Irradiance Environment Maps"). Project() integrates the environment's radiance
+// against the 9 basis functions over every texel of a small cube map level, weighted by the texels' solid angles,
+// then folds in the cosine lobe's convolution, the 1 / PI the irradiance map is stored with and the basis
+// functions' constants. What is left for the shader (IrradianceSH() in the PBR shaders) is a quadratic polynomial
+// in the normal, read from a uniform block: no convolution pass at startup and no cube map fetch per fragment.
+//
+// A 32 x 32 level is about 6000 texels; they are split over the cores and taken four at a time with SSE2, so the
+// projection is cheap enough to run every frame the environment changes, e.g. as it rotates.
+class SHIrradiance
+{
+public:
+    int threadCount;              // <= 0 uses every hardware thread
+    glm::vec4 coefficients[9];    // rgb per basis function, padded to std140 array elements
+
+    SHIrradiance(int threadCount = 0) : threadCount(threadCount), directionsSize(0)
+    {
+        for (int i = 0; i < 9; i++)
+            coefficients[i] = glm::vec4(0.0f);
+    }
+
+    // projects the radiance of level, a cube map whose texel directions are turned by rotation into world space
+    void Project(const CubeMapLevel &level, const glm::mat3 &rotation = glm::mat3(1.0f))
+    {
+        prepare(level.size);
+        int count = 6 * level.size * level.size;
+        int threads = threadCount > 0 ? threadCount : std::max(1, (int)std::thread::hardware_concurrency());
+        threads = std::max(1, std::min(threads, count / 1024)); // a thread costs about as much as 1000 texels
+        // contiguous runs of texels, a multiple of four long; each thread sums its run into its own 27 floats and
+        // the runs are added in order, so the result doesn't depend on which thread finishes first
+        int run = ((count + threads - 1) / threads + 3) & ~3;
+        std::vector<float> sums(threads * 27, 0.0f);
+        std::vector<std::thread> workers;
+        for (int t = 1; t < threads; t++)
+            workers.push_back(std::thread(&SHIrradiance::accumulate, this, std::cref(level), std::cref(rotation),
+                                          t * run, std::min(count, (t + 1) * run), &sums[t * 27]));
+        accumulate(level, rotation, 0, std::min(count, run), &sums[0]);
+        for (unsigned int t = 0; t < workers.size(); t++)
+            workers[t].join();
+
+        // the basis functions' constants squared (once to project, once to evaluate) times the cosine lobe's
+        // factor for the band, PI, 2 PI / 3 or PI / 4, over the PI of E(N) / PI
+        const float PI = 3.14159265359f;
+        const float scale[9] = {
+            1.0f / (4.0f * PI),
+            1.0f / (2.0f * PI), 1.0f / (2.0f * PI), 1.0f / (2.0f * PI),
+            15.0f / (16.0f * PI), 15.0f / (16.0f * PI), 5.0f / (64.0f * PI), 15.0f / (16.0f * PI), 15.0f / (64.0f * PI)
+        };
+        for (int i = 0; i < 9; i++)
+        {
+            glm::vec3 sum(0.0f);
+            for (int t = 0; t < threads; t++)
+                sum += glm::vec3(sums[t * 27 + i], sums[t * 27 + 9 + i], sums[t * 27 + 18 + i]);
+            coefficients[i] = glm::vec4(sum * scale[i], 0.0f);
+        }
+    }
+
+    // E(N) / PI, like a fetch from the irradiance map; the same polynomial as IrradianceSH() in the shaders
+    glm::vec3 Evaluate(const glm::vec3 &n) const
+    {
+        glm::vec3 e = glm::vec3(coefficients[0])
+                    + glm::vec3(coefficients[1]) * n.y + glm::vec3(coefficients[2]) * n.z + glm::vec3(coefficients[3]) * n.x
+                    + glm::vec3(coefficients[4]) * (n.x * n.y) + glm::vec3(coefficients[5]) * (n.y * n.z)
+                    + glm::vec3(coefficients[6]) * (3.0f * n.z * n.z - 1.0f) + glm::vec3(coefficients[7]) * (n.x * n.z)
+                    + glm::vec3(coefficients[8]) * (n.x * n.x - n.y * n.y);
+        return glm::max(e, glm::vec3(0.0f));
+    }
+
+    // reads a level of an RGB cube map texture back for Project(), e.g. a small one of the environment's mip chain
+    static void ReadBack(unsigned int cubemap, int level, CubeMapLevel &texels)
+    {
+        glBindTexture(GL_TEXTURE_CUBE_MAP, cubemap);
+        int size = 0;
+        glGetTexLevelParameteriv(GL_TEXTURE_CUBE_MAP_POSITIVE_X, level, GL_TEXTURE_WIDTH, &size);
+        texels.Resize(size);
+        for (int face = 0; face < 6; face++)
+            glGetTexImage(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, level, GL_RGB, GL_FLOAT, texels.Texel(face, 0, 0));
+    }
+
+private:
+    // every texel's direction and solid angle for the current size, as structures of arrays padded to a multiple of
+    // four with texels of no weight
+    int directionsSize;
+    std::vector<float> dx, dy, dz, solidAngle;
+
+    void prepare(int size)
+    {
+        if (size == directionsSize)
+            return;
+        directionsSize = size;
+        int padded = (6 * size * size + 3) & ~3;
+        dx.assign(padded, 0.0f); dy.assign(padded, 0.0f); dz.assign(padded, 0.0f); solidAngle.assign(padded, 0.0f);
+        for (int face = 0, i = 0; face < 6; face++)
+        {
+            for (int y = 0; y < size; y++)
+            {
+                for (int x = 0; x < size; x++, i++)
+                {
+                    float u0 = 2.0f * x / size - 1.0f, u1 = 2.0f * (x + 1) / size - 1.0f;
+                    float v0 = 2.0f * y / size - 1.0f, v1 = 2.0f * (y + 1) / size - 1.0f;
+                    glm::vec3 d = glm::normalize(IBLBaker::FaceDirection(face, 0.5f * (u0 + u1), 0.5f * (v0 + v1)));
+                    dx[i] = d.x; dy[i] = d.y; dz[i] = d.z;
+                    solidAngle[i] = IBLBaker::TexelSolidAngle(u0, v0, u1, v1);
+                }
+            }
+        }
+    }
+
+    // texels [begin, end) into sums: 9 per channel, the basis functions without their constants
+    void accumulate(const CubeMapLevel &level, const glm::mat3 &rotation, int begin, int end, float *sums) const
+    {
+        const float *texels = &level.texels[0];
+        int i = begin;
+#ifdef IBL_BAKER_SSE
+        __m128 m[9];
+        for (int column = 0; column < 3; column++)
+            for (int row = 0; row < 3; row++)
+                m[column * 3 + row] = _mm_set1_ps(rotation[column][row]);
+        __m128 sumR[9], sumG[9], sumB[9];
+        for (int k = 0; k < 9; k++)
+            sumR[k] = sumG[k] = sumB[k] = _mm_setzero_ps();
+        __m128 three = _mm_set1_ps(3.0f), one = _mm_set1_ps(1.0f);
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 ex = _mm_loadu_ps(&dx[i]), ey = _mm_loadu_ps(&dy[i]), ez = _mm_loadu_ps(&dz[i]);
+            __m128 x = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0], ex), _mm_mul_ps(m[3], ey)), _mm_mul_ps(m[6], ez));
+            __m128 y = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[1], ex), _mm_mul_ps(m[4], ey)), _mm_mul_ps(m[7], ez));
+            __m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(m[2], ex), _mm_mul_ps(m[5], ey)), _mm_mul_ps(m[8], ez));
+            __m128 w = _mm_loadu_ps(&solidAngle[i]);
+            const float *t = texels + i * 3;
+            __m128 r = _mm_mul_ps(w, _mm_setr_ps(t[0], t[3], t[6], t[9]));
+            __m128 g = _mm_mul_ps(w, _mm_setr_ps(t[1], t[4], t[7], t[10]));
+            __m128 b = _mm_mul_ps(w, _mm_setr_ps(t[2], t[5], t[8], t[11]));
+            __m128 basis[9] = {
+                one, y, z, x,
+                _mm_mul_ps(x, y), _mm_mul_ps(y, z), _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one), _mm_mul_ps(x, z),
+                _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y))
+            };
+            for (int k = 0; k < 9; k++)
+            {
+                sumR[k] = _mm_add_ps(sumR[k], _mm_mul_ps(basis[k], r));
+                sumG[k] = _mm_add_ps(sumG[k], _mm_mul_ps(basis[k], g));
+                sumB[k] = _mm_add_ps(sumB[k], _mm_mul_ps(basis[k], b));
+            }
+        }
+        for (int k = 0; k < 9; k++)
+        {
+            float lanes[4];
+            _mm_storeu_ps(lanes, sumR[k]);
+            sums[k] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, sumG[k]);
+            sums[9 + k] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+            _mm_storeu_ps(lanes, sumB[k]);
+            sums[18 + k] += lanes[0] + lanes[1] + lanes[2] + lanes[3];
+        }
+#endif
+        for (; i < end; i++)
+        {
+            glm::vec3 d = rotation * glm::vec3(dx[i], dy[i], dz[i]);
+            const float *t = texels + i * 3;
+            float basis[9] = { 1.0f, d.y, d.z, d.x, d.x * d.y, d.y * d.z, 3.0f * d.z * d.z - 1.0f, d.x * d.z, d.x * d.x - d.y * d.y };
+            for (int k = 0; k < 9; k++)
+            {
+                sums[k] += basis[k] * t[0] * solidAngle[i];
+                sums[9 + k] += basis[k] * t[1] * solidAngle[i];
+                sums[18 + k] += basis[k] * t[2] * solidAngle[i];
+            }
+        }
+    }
+};
+#endif
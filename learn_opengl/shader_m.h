@@ -3,6 +3,7 @@
 
 #include "glad.h"
 #include "glm/glm.hpp"
+#include "gl_state.h"
 
 #include <string>
 #include <fstream>
@@ -74,18 +75,18 @@ public:
     // ------------------------------------------------------------------------
     void use() const
     {
-        glUseProgram(ID);
+        glState().UseProgram(ID);
     }
     // utility uniform functions
     // ------------------------------------------------------------------------
     void setBool(const std::string &name, bool value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
+        glState().Uniform1i(glGetUniformLocation(ID, name.c_str()), (int)value);
     }
     // ------------------------------------------------------------------------
     void setInt(const std::string &name, int value) const
     {
-        glUniform1i(glGetUniformLocation(ID, name.c_str()), value);
+        glState().Uniform1i(glGetUniformLocation(ID, name.c_str()), value);
     }
     // ------------------------------------------------------------------------
     void setFloat(const std::string &name, float value) const
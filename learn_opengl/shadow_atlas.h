@@ -0,0 +1,305 @@
+#ifndef SHADOW_ATLAS_H
+#define SHADOW_ATLAS_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include <vector>
+#include <list>
+#include <map>
+#include <iostream>
+
+// where a shadow view landed in the atlas, in atlas pixels
+struct ShadowTile {
+    int x, y, size;
+    bool stale; // newly placed, or its view changed since it was rendered: render it before sampling it
+
+    // x, y, width, height in texture coordinates, for the lighting shader
+    glm::vec4 Rect(int atlasSize) const
+    {
+        return glm::vec4(x, y, size, size) / static_cast<float>(atlasSize);
+    }
+};
+
+struct ShadowAtlasStats {
+    unsigned int tiles;     // resident
+    unsigned int rendered;  // tiles rendered in the last frame
+    unsigned int evictions; // tiles dropped to make room, since startup
+    float occupancy;        // fraction of the atlas held by tiles
+};
+
+// one shadow view known to the atlas
+struct ShadowAtlasEntry {
+    glm::ivec2 node;                       // corner of its tile
+    int level;                             // tile size is atlas size >> level
+    unsigned int version;                  // of the view the tile was rendered for
+    unsigned int lastUsed;                 // frame the tile was last requested in
+    std::list<unsigned int>::iterator lru; // position in the resident list
+};
+
+// One depth texture holding the shadow maps of many lights, as power of two tiles of different sizes.
+//
+// Every frame each shadow view (a spot light, one face of a point light) asks for a tile with Request(),
+// at the resolution its light is worth on screen, most important first: when space runs out the later
+// ones are given smaller tiles, then none. Tiles are split from and merged back into a quadtree of free
+// squares (a buddy allocator), so the atlas doesn't fragment. A view keeps its tile between frames, and
+// the tile is only rendered again when the view's version changes, e.g. when the light moves. Tiles not
+// requested in a frame stay resident, to be reused as they are when the light comes back into view, until
+// their space is needed: the least recently used go first. The depth is compared in hardware, with
+// bilinear PCF.
+class ShadowAtlas
+{
+public:
+    unsigned int ID;  // GL_DEPTH_COMPONENT24, size x size
+    unsigned int FBO;
+    int size, minTileSize, maxTileSize; // powers of two
+    ShadowAtlasStats stats;
+
+    ShadowAtlas(int size = 2048, int minTileSize = 64, int maxTileSize = 512)
+        : size(size), minTileSize(minTileSize), maxTileSize(maxTileSize), frame(0), usedPixels(0)
+    {
+        stats.tiles = stats.rendered = stats.evictions = 0;
+        stats.occupancy = 0.0f;
+        levels = 1;
+        while ((size >> (levels - 1)) > minTileSize)
+            levels++;
+        freeNodes.resize(levels);
+        freeNodes[0].push_back(glm::ivec2(0));
+
+        glGenTextures(1, &ID);
+        glBindTexture(GL_TEXTURE_2D, ID);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, ID, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SHADOW_ATLAS: framebuffer not complete" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // before the frame's first Request()
+    void BeginFrame()
+    {
+        frame++;
+        stats.rendered = 0;
+    }
+
+    // a tile for the shadow view key, about resolution pixels wide (rounded down to a power of two within
+    // [minTileSize, maxTileSize]). version is anything that changes when what the view sees changes.
+    // Returns false when the atlas is full of tiles requested this frame
+    bool Request(unsigned int key, int resolution, unsigned int version, ShadowTile &tile)
+    {
+        int level = levelFor(resolution);
+        glm::ivec2 node;
+        std::map<unsigned int, ShadowAtlasEntry>::iterator it = entries.find(key);
+        if (it != entries.end())
+        {
+            ShadowAtlasEntry &entry = it->second;
+            // used this frame, so allocate() below can't evict it
+            entry.lastUsed = frame;
+            resident.splice(resident.begin(), resident, entry.lru);
+            bool moved = false;
+            if (entry.level > level)
+            {
+                // smaller than asked: move into a larger tile if one can be had, otherwise keep this one
+                for (int l = level; l < entry.level && !moved; l++)
+                {
+                    if (allocate(l, node))
+                    {
+                        release(entry);
+                        place(entry, node, l);
+                        moved = true;
+                    }
+                }
+            }
+            else if (entry.level < level - 1)
+            {
+                // more than one size larger than asked: give the space back. One size larger is kept, so a
+                // light sitting on a size boundary isn't rendered again every frame
+                release(entry);
+                allocate(level, node);
+                place(entry, node, level);
+                moved = true;
+            }
+            fill(entry, tile);
+            tile.stale = moved || entry.version != version;
+            entry.version = version;
+            return true;
+        }
+
+        // new view: the largest tile it may have, down to the smallest
+        for (; level < levels; level++)
+        {
+            if (allocate(level, node))
+            {
+                resident.push_front(key);
+                ShadowAtlasEntry &entry = entries[key];
+                entry.lru = resident.begin();
+                entry.lastUsed = frame;
+                entry.version = version;
+                place(entry, node, level);
+                fill(entry, tile);
+                tile.stale = true;
+                stats.tiles = static_cast<unsigned int>(entries.size());
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // binds the atlas for rendering tiles, with the scissor test on so a tile's clear stays inside it
+    void BeginRender()
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glEnable(GL_SCISSOR_TEST);
+    }
+
+    // points viewport and scissor at the tile and clears it
+    void BeginTile(const ShadowTile &tile)
+    {
+        glViewport(tile.x, tile.y, tile.size, tile.size);
+        glScissor(tile.x, tile.y, tile.size, tile.size);
+        glClear(GL_DEPTH_BUFFER_BIT);
+        stats.rendered++;
+    }
+
+    void EndRender(int screenWidth, int screenHeight)
+    {
+        glDisable(GL_SCISSOR_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, screenWidth, screenHeight);
+    }
+
+private:
+    int levels;
+    unsigned int frame;
+    long long usedPixels;
+    std::vector<std::vector<glm::ivec2> > freeNodes; // per level, free squares of size >> level
+    std::map<unsigned int, ShadowAtlasEntry> entries;
+    std::list<unsigned int> resident;                // keys, most recently used first
+
+    int levelFor(int resolution) const
+    {
+        int level = 0;
+        while (level < levels - 1 && ((size >> level) > maxTileSize || (size >> level) > resolution))
+            level++;
+        return level;
+    }
+
+    void fill(const ShadowAtlasEntry &entry, ShadowTile &tile) const
+    {
+        tile.x = entry.node.x;
+        tile.y = entry.node.y;
+        tile.size = size >> entry.level;
+    }
+
+    void place(ShadowAtlasEntry &entry, glm::ivec2 node, int level)
+    {
+        entry.node = node;
+        entry.level = level;
+        long long tileSize = size >> level;
+        usedPixels += tileSize * tileSize;
+        stats.occupancy = static_cast<float>(usedPixels) / (static_cast<float>(size) * size);
+    }
+
+    void release(const ShadowAtlasEntry &entry)
+    {
+        long long tileSize = size >> entry.level;
+        usedPixels -= tileSize * tileSize;
+        stats.occupancy = static_cast<float>(usedPixels) / (static_cast<float>(size) * size);
+        freeNode(freeNodes, entry.node, entry.level);
+    }
+
+    // a free square at level, split from a larger one if needed; evicts the least recently used tiles not
+    // requested this frame until one fits. False when none does, and then nothing is evicted
+    bool allocate(int level, glm::ivec2 &node)
+    {
+        if (!fits(freeNodes, level))
+        {
+            // free the candidates on a copy of the free lists first, so tiles are only dropped if that makes room
+            std::vector<std::vector<glm::ivec2> > trial = freeNodes;
+            int victims = 0;
+            bool room = false;
+            for (std::list<unsigned int>::reverse_iterator it = resident.rbegin(); it != resident.rend() && !room; ++it)
+            {
+                const ShadowAtlasEntry &candidate = entries.find(*it)->second;
+                if (candidate.lastUsed == frame)
+                    break;
+                freeNode(trial, candidate.node, candidate.level);
+                victims++;
+                room = fits(trial, level);
+            }
+            if (!room)
+                return false;
+            for (; victims > 0; victims--)
+            {
+                std::map<unsigned int, ShadowAtlasEntry>::iterator victim = entries.find(resident.back());
+                release(victim->second);
+                resident.pop_back();
+                entries.erase(victim);
+                stats.evictions++;
+            }
+            stats.tiles = static_cast<unsigned int>(entries.size());
+        }
+
+        int from = level;
+        while (freeNodes[from].empty())
+            from--;
+        node = freeNodes[from].back();
+        freeNodes[from].pop_back();
+        // keep the first quarter, free the other three, down to the level asked for
+        for (; from < level; from++)
+        {
+            int half = size >> (from + 1);
+            freeNodes[from + 1].push_back(glm::ivec2(node.x + half, node.y));
+            freeNodes[from + 1].push_back(glm::ivec2(node.x, node.y + half));
+            freeNodes[from + 1].push_back(glm::ivec2(node.x + half, node.y + half));
+        }
+        return true;
+    }
+
+    // whether lists hold a square at level or one of the larger ones it can be split from
+    static bool fits(const std::vector<std::vector<glm::ivec2> > &lists, int level)
+    {
+        for (int from = level; from >= 0; from--)
+            if (!lists[from].empty())
+                return true;
+        return false;
+    }
+
+    // gives the square back to lists, merged with its three siblings into their parent whenever they are all free
+    void freeNode(std::vector<std::vector<glm::ivec2> > &lists, glm::ivec2 node, int level) const
+    {
+        while (level > 0)
+        {
+            int parentSize = size >> (level - 1);
+            glm::ivec2 parent(node.x & ~(parentSize - 1), node.y & ~(parentSize - 1));
+            std::vector<glm::ivec2> &list = lists[level];
+            std::vector<size_t> siblings;
+            for (size_t i = 0; i < list.size(); i++)
+                if ((list[i].x & ~(parentSize - 1)) == parent.x && (list[i].y & ~(parentSize - 1)) == parent.y)
+                    siblings.push_back(i);
+            if (siblings.size() < 3)
+                break;
+            for (size_t i = siblings.size(); i-- > 0;)
+            {
+                list[siblings[i]] = list.back();
+                list.pop_back();
+            }
+            node = parent;
+            level--;
+        }
+        lists[level].push_back(node);
+    }
+};
+#endif
@@ -0,0 +1,171 @@
+#ifndef SHADOW_CACHE_H
+#define SHADOW_CACHE_H
+
+#include "glad.h" // holds all OpenGL type declarations
+#include "gl_extensions.h"
+
+#include "glm/glm.hpp"
+
+#include <iostream>
+
+// Static/dynamic split for a layered shadow map: a depth cube map or a depth texture array.
+//
+// The static casters are drawn once into a cache of the same size and format, and again only into the layers
+// Invalidate() marks, when the light or a layer's projection moved. Each frame the layers dynamic casters moved
+// in are copied back from the cache into the shadow map and every dynamic caster is drawn over them, the
+// geometry shader skipping the other layers; layers nothing moved in keep last frame's depth. With the light
+// and the casters still, the shadow pass does no work at all. The copy is glCopyImageSubData where the driver
+// has it (4.3 or ARB_copy_image), otherwise a depth blit per layer.
+class ShadowCache
+{
+public:
+    unsigned int ID;  // the cache: static casters only
+    unsigned int FBO; // the whole cache attached, layered
+    // last frame's work, in layers
+    unsigned int staticLayersDrawn, layersCopied, dynamicLayersDrawn;
+
+    // target is GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY; shadowMapFBO has shadowMap attached layered,
+    // and both are size x size with the given depth format
+    ShadowCache(GLenum target, unsigned int shadowMap, unsigned int shadowMapFBO, int size, int layers, GLenum internalFormat = GL_DEPTH_COMPONENT24)
+        : staticLayersDrawn(0), layersCopied(0), dynamicLayersDrawn(0), target(target), shadowMap(shadowMap), shadowMapFBO(shadowMapFBO),
+          size(size), layers(layers), allLayers((1u << layers) - 1), staleLayers(allLayers), redrawnLayers(0)
+    {
+        glGenTextures(1, &ID);
+        glBindTexture(target, ID);
+        if (target == GL_TEXTURE_CUBE_MAP)
+            for (int i = 0; i < 6; i++)
+                glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, internalFormat, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        else
+            glTexImage3D(target, 0, internalFormat, size, size, layers, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        // a single level; glCopyImageSubData refuses incomplete textures
+        glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &FBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, ID, 0);
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "ERROR::SHADOW_CACHE: framebuffer not complete" << std::endl;
+
+        // one layer at a time, to clear the stale cache layers and, without glCopyImageSubData, to blit
+        glGenFramebuffers(2, layerFBO);
+        for (int i = 0; i < 2; i++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[i]);
+            glDrawBuffer(GL_NONE);
+            glReadBuffer(GL_NONE);
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    // the static depth of these layers is out of date, e.g. all of them when the light moved
+    void Invalidate(unsigned int layerMask = ~0u) { staleLayers |= layerMask & allLayers; }
+
+    // clears the stale cache layers and binds the cache, viewport set, for the static casters. Returns the
+    // layers to draw them into, for the geometry shader; 0 when the cache is up to date and nothing needs drawing
+    unsigned int BeginStatic()
+    {
+        redrawnLayers = staleLayers;
+        staleLayers = 0;
+        staticLayersDrawn = countLayers(redrawnLayers);
+        if (!redrawnLayers)
+            return 0;
+
+        glBindFramebuffer(GL_FRAMEBUFFER, layerFBO[1]);
+        glViewport(0, 0, size, size);
+        for (int i = 0; i < layers; i++)
+        {
+            if (redrawnLayers & (1u << i))
+            {
+                attachLayer(GL_FRAMEBUFFER, ID, i);
+                glClear(GL_DEPTH_BUFFER_BIT);
+            }
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+        return redrawnLayers;
+    }
+
+    // movedLayers: where dynamic casters that moved since last frame are now, and where they were. Those layers
+    // and the ones BeginStatic() just redrew are copied from the cache into the shadow map, which is left bound
+    // with the viewport set. Returns them, for the geometry shader: every dynamic caster reaching into them is
+    // drawn, not only the ones that moved, since the copy wiped them all. 0 when nothing needs drawing
+    unsigned int BeginDynamic(unsigned int movedLayers)
+    {
+        unsigned int refresh = (movedLayers & allLayers) | redrawnLayers;
+        redrawnLayers = 0;
+        layersCopied = dynamicLayersDrawn = countLayers(refresh);
+        for (int i = 0; i < layers; i++)
+            if (refresh & (1u << i))
+                copyLayer(i);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, shadowMapFBO);
+        glViewport(0, 0, size, size);
+        return refresh;
+    }
+
+    // bit i set when the sphere may reach into the frustum of lightSpaceMatrices[i]. The near plane isn't tested:
+    // with depth clamping casters in front of it still cast shadows, and for a point light it only errs on the
+    // side of drawing
+    static unsigned int LayersTouching(const glm::mat4 *lightSpaceMatrices, int count, const glm::vec3 &center, float radius)
+    {
+        unsigned int mask = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const glm::mat4 &m = lightSpaceMatrices[i];
+            glm::vec4 row[4];
+            for (int r = 0; r < 4; r++)
+                row[r] = glm::vec4(m[0][r], m[1][r], m[2][r], m[3][r]);
+            // left, right, bottom, top and far planes, pointing inwards
+            glm::vec4 planes[5] = { row[3] + row[0], row[3] - row[0], row[3] + row[1], row[3] - row[1], row[3] - row[2] };
+            bool inside = true;
+            for (int p = 0; p < 5 && inside; p++)
+                inside = glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius * glm::length(glm::vec3(planes[p]));
+            if (inside)
+                mask |= 1u << i;
+        }
+        return mask;
+    }
+
+private:
+    GLenum target;
+    unsigned int shadowMap, shadowMapFBO;
+    int size, layers;
+    unsigned int allLayers;
+    unsigned int staleLayers;   // waiting for BeginStatic()
+    unsigned int redrawnLayers; // by BeginStatic(), waiting to be copied by BeginDynamic()
+    unsigned int layerFBO[2];
+
+    static unsigned int countLayers(unsigned int mask)
+    {
+        unsigned int count = 0;
+        for (; mask; mask &= mask - 1)
+            count++;
+        return count;
+    }
+
+    void attachLayer(GLenum framebuffer, unsigned int texture, int layer)
+    {
+        if (target == GL_TEXTURE_CUBE_MAP)
+            glFramebufferTexture2D(framebuffer, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + layer, texture, 0);
+        else
+            glFramebufferTextureLayer(framebuffer, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+    }
+
+    void copyLayer(int layer)
+    {
+        if (glExt().copyImage)
+        {
+            // cube map faces are addressed as layers too
+            glExt().CopyImageSubData(ID, target, 0, 0, 0, layer, shadowMap, target, 0, 0, 0, layer, size, size, 1);
+            return;
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, layerFBO[0]);
+        attachLayer(GL_READ_FRAMEBUFFER, ID, layer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, layerFBO[1]);
+        attachLayer(GL_DRAW_FRAMEBUFFER, shadowMap, layer);
+        glBlitFramebuffer(0, 0, size, size, 0, 0, size, size, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+    }
+};
+#endif
@@ -0,0 +1,68 @@
+#version 330 core
+out vec3 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;   // the level above in the mip chain, or the scene for the first pass
+uniform bool prefilter;    // first pass only: keep the parts above the threshold, with a soft knee
+uniform float threshold;
+uniform float knee;
+
+float Luminance(vec3 color)
+{
+    return dot(color, vec3(0.2126, 0.7152, 0.0722));
+}
+
+// weights a 2x2 box down by its brightness, so a single very bright pixel can't flicker in and out of the bloom
+vec3 KarisAverage(vec3 a, vec3 b, vec3 c, vec3 d)
+{
+    vec4 sum = vec4(a, 1.0) / (1.0 + Luminance(a)) + vec4(b, 1.0) / (1.0 + Luminance(b))
+             + vec4(c, 1.0) / (1.0 + Luminance(c)) + vec4(d, 1.0) / (1.0 + Luminance(d));
+    return sum.rgb / sum.a;
+}
+
+void main()
+{
+    // 13 bilinear taps covering a 6x6 texel area around this (half size) pixel:
+    // a - b - c
+    // - j - k -
+    // d - e - f
+    // - l - m -
+    // g - h - i
+    vec2 texel = 1.0 / vec2(textureSize(image, 0));
+    vec3 a = texture(image, TexCoords + texel * vec2(-2.0,  2.0)).rgb;
+    vec3 b = texture(image, TexCoords + texel * vec2( 0.0,  2.0)).rgb;
+    vec3 c = texture(image, TexCoords + texel * vec2( 2.0,  2.0)).rgb;
+    vec3 d = texture(image, TexCoords + texel * vec2(-2.0,  0.0)).rgb;
+    vec3 e = texture(image, TexCoords).rgb;
+    vec3 f = texture(image, TexCoords + texel * vec2( 2.0,  0.0)).rgb;
+    vec3 g = texture(image, TexCoords + texel * vec2(-2.0, -2.0)).rgb;
+    vec3 h = texture(image, TexCoords + texel * vec2( 0.0, -2.0)).rgb;
+    vec3 i = texture(image, TexCoords + texel * vec2( 2.0, -2.0)).rgb;
+    vec3 j = texture(image, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 k = texture(image, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 l = texture(image, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 m = texture(image, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    // the five overlapping 2x2 boxes: the center one weighs 0.5, the corner ones 0.125 each
+    vec3 result;
+    if (prefilter)
+    {
+        result = KarisAverage(j, k, l, m) * 0.5
+               + (KarisAverage(a, b, d, e) + KarisAverage(b, c, e, f)
+                + KarisAverage(d, e, g, h) + KarisAverage(e, f, h, i)) * 0.125;
+        // soft threshold: a quadratic ramp from threshold - knee up to threshold + knee, linear above
+        float brightness = Luminance(result);
+        float soft = clamp(brightness - threshold + knee, 0.0, 2.0 * knee);
+        soft = soft * soft / (4.0 * knee + 0.0001);
+        result *= max(soft, brightness - threshold) / max(brightness, 0.0001);
+    }
+    else
+    {
+        result = e * 0.125;
+        result += (a + c + g + i) * 0.03125;
+        result += (b + d + f + h) * 0.0625;
+        result += (j + k + l + m) * 0.125;
+    }
+    FragColor = result;
+}
\ No newline at end of file
@@ -5,8 +5,13 @@ in vec2 TexCoords;
 
 uniform sampler2D scene;
 uniform sampler2D bloomBlur;
+uniform sampler2D adaptedLuminance; // 1x1, log2 of the scene's adapted average luminance
 uniform bool bloom;
-uniform float exposure;
+uniform bool autoExposure;
+uniform float bloomStrength; // the upsampled mip chain adds up every level, this averages them back
+uniform float exposure; // with autoExposure on, a compensation on top of it
+
+const float keyValue = 0.3; // what the adapted average luminance is scaled to before tone mapping
 
 void main()
 {             
@@ -14,9 +19,12 @@ void main()
     vec3 hdrColor = texture(scene, TexCoords).rgb;      
     vec3 bloomColor = texture(bloomBlur, TexCoords).rgb;
     if(bloom)
-        hdrColor += bloomColor; // additive blending
+        hdrColor += bloomColor * bloomStrength; // additive blending
     // tone mapping
-    vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+    float exposureValue = exposure;
+    if(autoExposure)
+        exposureValue *= keyValue / exp2(texelFetch(adaptedLuminance, ivec2(0, 0), 0).r);
+    vec3 result = vec3(1.0) - exp(-hdrColor * exposureValue);
     // also gamma correct while we're at it       
     result = pow(result, vec3(1.0 / gamma));
     FragColor = vec4(result, 1.0);
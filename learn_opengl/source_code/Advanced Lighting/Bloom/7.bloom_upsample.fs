@@ -0,0 +1,30 @@
+#version 330 core
+out vec3 FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D image;   // the level below in the mip chain; the result is added onto the level above
+uniform float filterRadius; // tent radius, in texels of that level
+
+void main()
+{
+    // 3x3 tent filter:
+    // 1 2 1
+    // 2 4 2 / 16
+    // 1 2 1
+    vec2 texel = filterRadius / vec2(textureSize(image, 0));
+    vec3 a = texture(image, TexCoords + texel * vec2(-1.0,  1.0)).rgb;
+    vec3 b = texture(image, TexCoords + texel * vec2( 0.0,  1.0)).rgb;
+    vec3 c = texture(image, TexCoords + texel * vec2( 1.0,  1.0)).rgb;
+    vec3 d = texture(image, TexCoords + texel * vec2(-1.0,  0.0)).rgb;
+    vec3 e = texture(image, TexCoords).rgb;
+    vec3 f = texture(image, TexCoords + texel * vec2( 1.0,  0.0)).rgb;
+    vec3 g = texture(image, TexCoords + texel * vec2(-1.0, -1.0)).rgb;
+    vec3 h = texture(image, TexCoords + texel * vec2( 0.0, -1.0)).rgb;
+    vec3 i = texture(image, TexCoords + texel * vec2( 1.0, -1.0)).rgb;
+
+    vec3 result = e * 4.0;
+    result += (b + d + f + h) * 2.0;
+    result += (a + c + g + i);
+    FragColor = result / 16.0;
+}
\ No newline at end of file
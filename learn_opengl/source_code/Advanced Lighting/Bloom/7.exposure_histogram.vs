@@ -0,0 +1,21 @@
+#version 330 core
+// one point per block of the HDR buffer (a gridWidth x gridHeight grid), placed on the bin of the block's luminance;
+// drawn with additive blending into a binCount x 1 target, so every bin ends up holding its block count
+
+uniform sampler2D hdrBuffer;
+uniform int gridWidth;
+uniform int gridHeight;
+uniform int binCount;
+uniform float minLogLuminance;
+uniform float logLuminanceRange;
+
+void main()
+{
+    ivec2 block = ivec2(gl_VertexID % gridWidth, gl_VertexID / gridWidth);
+    // a bilinear tap at the block's center averages its middle 2x2 pixels
+    vec3 color = textureLod(hdrBuffer, (vec2(block) + 0.5) / vec2(gridWidth, gridHeight), 0.0).rgb;
+    float luminance = dot(color, vec3(0.2126, 0.7152, 0.0722));
+    float t = clamp((log2(max(luminance, 0.0001)) - minLogLuminance) / logLuminanceRange, 0.0, 1.0);
+    float bin = min(floor(t * binCount), binCount - 1.0);
+    gl_Position = vec4((bin + 0.5) / binCount * 2.0 - 1.0, 0.0, 0.0, 1.0);
+}
\ No newline at end of file
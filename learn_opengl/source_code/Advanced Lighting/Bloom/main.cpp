@@ -9,8 +9,10 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "auto_exposure.h"
 
 #include <iostream>
+#include <algorithm>
 
 void processInput(void);
 void sleep(void);
@@ -24,6 +26,16 @@ const unsigned int SCR_HEIGHT = 480;
 bool bloom = true;
 bool bloomKeyPressed = false;
 float exposure = 1.0f;
+// T toggles automatic exposure, which then treats exposure (Q/E) as a compensation; B/N slow down/speed up its adaptation
+bool autoExposure = true;
+bool autoExposureKeyPressed = false;
+float adaptationSpeed = 1.5f;
+
+// bloom: the bright parts of the scene are downsampled through a chain of half size mips, then upsampled back up it.
+// Z/X lower/raise the threshold, C/V narrow/widen the upsampling tent; more mips make it wider still
+const unsigned int BLOOM_MIPS = 6;
+float bloomThreshold = 1.0f;
+float bloomRadius = 1.0f;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -61,8 +73,11 @@ int main(int argc, char *argv[])
     // -------------------------
     Shader shader("7.bloom.vs", "7.bloom.fs");
     Shader shaderLight("7.bloom.vs", "7.light_box.fs");
-    Shader shaderBlur("7.blur.vs", "7.blur.fs");
+    Shader shaderBloomDownsample("7.bloom_final.vs", "7.bloom_downsample.fs");
+    Shader shaderBloomUpsample("7.bloom_final.vs", "7.bloom_upsample.fs");
     Shader shaderBloomFinal("7.bloom_final.vs", "7.bloom_final.fs");
+    Shader shaderHistogram("7.exposure_histogram.vs", "7.exposure_histogram.fs");
+    Shader shaderAdapt("7.exposure_adapt.vs", "7.exposure_adapt.fs");
 
     // load textures
     // -------------
@@ -74,53 +89,64 @@ int main(int argc, char *argv[])
     unsigned int hdrFBO;
     glGenFramebuffers(1, &hdrFBO);
     glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-    // create 2 floating point color buffers (1 for normal rendering, other for brightness threshold values)
-    unsigned int colorBuffers[2];
-    glGenTextures(2, colorBuffers);
-    for (unsigned int i = 0; i < 2; i++)
-    {
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        // attach texture to framebuffer
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
-    }
+    // create a floating point color buffer; the bloom's first downsample thresholds it, so no separate brightness buffer
+    unsigned int colorBuffer;
+    glGenTextures(1, &colorBuffer);
+    glBindTexture(GL_TEXTURE_2D, colorBuffer);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);  // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    // attach texture to framebuffer
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorBuffer, 0);
     // create and attach depth buffer (renderbuffer)
     unsigned int rboDepth;
     glGenRenderbuffers(1, &rboDepth);
     glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
     glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
     glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-    glDrawBuffers(2, attachments);
     // finally check if framebuffer is complete
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // ping-pong-framebuffer for blurring
-    unsigned int pingpongFBO[2];
-    unsigned int pingpongColorbuffers[2];
-    glGenFramebuffers(2, pingpongFBO);
-    glGenTextures(2, pingpongColorbuffers);
-    for (unsigned int i = 0; i < 2; i++)
+    // bloom mip chain: the first level is half the screen, each next one half the previous.
+    // One framebuffer, its color attachment switched to the level each pass renders to
+    unsigned int bloomFBO;
+    unsigned int bloomMips[BLOOM_MIPS];
+    glm::ivec2 bloomMipSizes[BLOOM_MIPS];
+    glGenFramebuffers(1, &bloomFBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, bloomFBO);
+    glGenTextures(BLOOM_MIPS, bloomMips);
+    glm::ivec2 mipSize(SCR_WIDTH, SCR_HEIGHT);
+    for (unsigned int i = 0; i < BLOOM_MIPS; i++)
     {
-        glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[i]);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+        mipSize = glm::max(mipSize / 2, glm::ivec2(1));
+        bloomMipSizes[i] = mipSize;
+        glBindTexture(GL_TEXTURE_2D, bloomMips[i]);
+        // packed float without alpha: half the bandwidth of RGBA16F, and bloom has no use for the precision
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R11F_G11F_B10F, mipSize.x, mipSize.y, 0, GL_RGB, GL_FLOAT, NULL);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the blur filter would otherwise sample repeated texture values!
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE); // we clamp to the edge as the filters would otherwise sample repeated texture values!
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorbuffers[i], 0);
-        // also check if framebuffers are complete (no need for depth buffer)
-        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-            std::cout << "Framebuffer not complete!" << std::endl;
     }
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomMips[0], 0);
+    // also check if framebuffer is complete (no need for depth buffer)
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        std::cout << "Bloom Framebuffer not complete!" << std::endl;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    // the downsample and upsample passes are timed without waiting on the GPU: a query's result is read once it is ready
+    unsigned int bloomQueries[2];
+    glGenQueries(2, bloomQueries);
+    bool queryPending = false;
+    float downsampleTimeMs = 0.0f, upsampleTimeMs = 0.0f;
+    unsigned int lastReport = 0;
+
+    // automatic exposure: a luminance histogram of the scene, reduced and adapted on the GPU
+    AutoExposure exposureControl(SCR_WIDTH, SCR_HEIGHT);
 
     // lighting info
     // -------------
@@ -142,11 +168,15 @@ int main(int argc, char *argv[])
     // --------------------
     shader.use();
     shader.setInt("diffuseTexture", 0);
-    shaderBlur.use();
-    shaderBlur.setInt("image", 0);
+    shaderBloomDownsample.use();
+    shaderBloomDownsample.setInt("image", 0);
+    shaderBloomUpsample.use();
+    shaderBloomUpsample.setInt("image", 0);
     shaderBloomFinal.use();
     shaderBloomFinal.setInt("scene", 0);
     shaderBloomFinal.setInt("bloomBlur", 1);
+    shaderBloomFinal.setInt("adaptedLuminance", 2);
+    shaderBloomFinal.setFloat("bloomStrength", 1.0f / BLOOM_MIPS);
 
     // render loop
     // -----------
@@ -247,32 +277,101 @@ int main(int argc, char *argv[])
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 2. blur bright fragments with two-pass Gaussian Blur
-        // --------------------------------------------------
-        bool horizontal = true, first_iteration = true;
-        unsigned int amount = 10;
-        shaderBlur.use();
-        for (unsigned int i = 0; i < amount; i++)
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(bloomQueries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(bloomQueries[0], GL_QUERY_RESULT, &elapsed);
+                downsampleTimeMs = elapsed / 1000000.0f;
+                glGetQueryObjectui64v(bloomQueries[1], GL_QUERY_RESULT, &elapsed);
+                upsampleTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
+        }
+        bool timing = !queryPending;
+
+        // 2. bloom, first down the mip chain: the first pass thresholds the scene (with a soft knee) into the
+        //    half size level, every pass takes 13 bilinear taps from the level above
+        // -------------------------------------------------------------------------------------------------------
+        glBindFramebuffer(GL_FRAMEBUFFER, bloomFBO);
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, bloomQueries[0]);
+        shaderBloomDownsample.use();
+        shaderBloomDownsample.setInt("prefilter", 1);
+        shaderBloomDownsample.setFloat("threshold", bloomThreshold);
+        shaderBloomDownsample.setFloat("knee", bloomThreshold * 0.5f);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, colorBuffer);
+        for (unsigned int i = 0; i < BLOOM_MIPS; i++)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-            shaderBlur.setInt("horizontal", horizontal);
-            glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorbuffers[!horizontal]);  // bind texture of other framebuffer (or scene if first iteration)
+            glViewport(0, 0, bloomMipSizes[i].x, bloomMipSizes[i].y);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomMips[i], 0);
             renderQuad();
-            horizontal = !horizontal;
-            if (first_iteration)
-                first_iteration = false;
+            shaderBloomDownsample.setInt("prefilter", 0);
+            glBindTexture(GL_TEXTURE_2D, bloomMips[i]); // the next pass reads this one
+        }
+        if (timing)
+            glEndQuery(GL_TIME_ELAPSED);
+
+        // then back up: each level is tent filtered and added onto the one above, so the first level ends up
+        // holding every level's blur, from the narrowest to the widest
+        // ------------------------------------------------------------------------------------------------------
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, bloomQueries[1]);
+        shaderBloomUpsample.use();
+        shaderBloomUpsample.setFloat("filterRadius", bloomRadius);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE);
+        for (unsigned int i = BLOOM_MIPS - 1; i > 0; i--)
+        {
+            glBindTexture(GL_TEXTURE_2D, bloomMips[i]);
+            glViewport(0, 0, bloomMipSizes[i - 1].x, bloomMipSizes[i - 1].y);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, bloomMips[i - 1], 0);
+            renderQuad();
+        }
+        glDisable(GL_BLEND);
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
         }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "bloom threshold " << bloomThreshold << ", radius " << bloomRadius << ": downsample "
+                      << downsampleTimeMs << " ms, upsample " << upsampleTimeMs << " ms" << std::endl;
+            if (autoExposure)
+                std::cout << "adapted luminance " << exposureControl.averageLuminance << ", adaptation speed " << adaptationSpeed << std::endl;
+        }
+
+        // 3. measure the scene's luminance and adapt the exposure to it, entirely on the GPU
+        // ----------------------------------------------------------------------------------
+        if (autoExposure)
+        {
+            exposureControl.adaptationSpeed = adaptationSpeed;
+            exposureControl.Update(shaderHistogram, shaderAdapt, colorBuffer, deltaTime / 1000.0f);
+        }
+        else
+            exposureControl.Reset();
 
-        // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+        // 4. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderBloomFinal.use();
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
+        glBindTexture(GL_TEXTURE_2D, colorBuffer);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, pingpongColorbuffers[!horizontal]);
+        glBindTexture(GL_TEXTURE_2D, bloomMips[0]);
+        glActiveTexture(GL_TEXTURE2);
+        glBindTexture(GL_TEXTURE_2D, exposureControl.Result());
         shaderBloomFinal.setInt("bloom", bloom);
+        shaderBloomFinal.setInt("autoExposure", autoExposure);
         shaderBloomFinal.setFloat("exposure", exposure);
         renderQuad();
 
@@ -371,6 +470,21 @@ void processInput(void)
          bloomKeyPressed = false;
     }
 
+    if (keys[SDLK_t] && !autoExposureKeyPressed)
+    {
+        autoExposure = !autoExposure;
+        std::cout << "auto exposure " << (autoExposure ? "on" : "off") << std::endl;
+        autoExposureKeyPressed = true;
+    }
+    if (!keys[SDLK_t])
+    {
+         autoExposureKeyPressed = false;
+    }
+    if (keys[SDLK_b])
+        adaptationSpeed = std::max(adaptationSpeed - 0.05f, 0.1f);
+    else if (keys[SDLK_n])
+        adaptationSpeed = std::min(adaptationSpeed + 0.05f, 10.0f);
+
     if (keys[SDLK_q])
     {
         if (exposure > 0.0f)
@@ -382,6 +496,15 @@ void processInput(void)
     {
         exposure += 0.1f;
     }
+
+    if (keys[SDLK_z])
+        bloomThreshold = std::max(bloomThreshold - 0.05f, 0.0f);
+    else if (keys[SDLK_x])
+        bloomThreshold += 0.05f;
+    if (keys[SDLK_c])
+        bloomRadius = std::max(bloomRadius - 0.05f, 0.25f);
+    else if (keys[SDLK_v])
+        bloomRadius = std::min(bloomRadius + 0.05f, 4.0f);
 }
 
 void sleep(void)
@@ -3,28 +3,57 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
 
+// std140: each vec3 shares its 16 bytes with the float after it (LightData in main_deferred_lighting_pass.cpp)
 struct Light {
     vec3 Position;
-    vec3 Color;
-    
     float Linear;
+    vec3 Color;
     float Quadratic;
 };
 const int NR_LIGHTS = 32;
-uniform Light lights[NR_LIGHTS];
+layout (std140) uniform Lights
+{
+    Light lights[NR_LIGHTS];
+};
 uniform vec3 viewPos;
 
+// world space position of the surface at uv, from the depth buffer
+vec3 WorldPosition(vec2 uv)
+{
+    vec4 clipPos = vec4(vec3(uv, texture(gDepth, uv).r) * 2.0 - 1.0, 1.0);
+    vec4 worldPos = inverseViewProjection * clipPos;
+    return worldPos.xyz / worldPos.w;
+}
+
+// inverse of the g-buffer's octahedral normal encoding
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// specular intensity from the top 5 bits of the packed alpha
+float DecodeSpecular(float packed)
+{
+    return float(int(packed * 255.0 + 0.5) / 8) / 31.0;
+}
+
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
-    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
-    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    vec3 FragPos = WorldPosition(TexCoords);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = DecodeSpecular(AlbedoSpec.a);
     
     // then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
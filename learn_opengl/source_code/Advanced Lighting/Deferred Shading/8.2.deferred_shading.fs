@@ -3,52 +3,97 @@ out vec4 FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
+uniform sampler2D gDepth;
 uniform sampler2D gNormal;
 uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
 
-struct Light {
-    vec3 Position;
-    vec3 Color;
-    
-    float Linear;
-    float Quadratic;
-    float Radius;
-};
-const int NR_LIGHTS = 32;
-uniform Light lights[NR_LIGHTS];
+// lights and their per-cluster lists, filled by LightClusters (light_clusters.h)
+uniform samplerBuffer lightData;     // 3 texels per light: (Position, Radius), (Color, 0), (Linear, Quadratic, 0, 0)
+uniform usamplerBuffer clusterGrid;  // (first index, count) per cluster
+uniform usamplerBuffer lightIndices;
+uniform int lightCount;
+uniform int tileSize;
+uniform ivec3 clusterCounts;
+uniform float sliceScale;
+uniform float sliceBias;
+uniform bool useClusters;
+
+uniform mat4 view;
 uniform vec3 viewPos;
 
+// world space position of the surface at uv, from the depth buffer
+vec3 WorldPosition(vec2 uv)
+{
+    vec4 clipPos = vec4(vec3(uv, texture(gDepth, uv).r) * 2.0 - 1.0, 1.0);
+    vec4 worldPos = inverseViewProjection * clipPos;
+    return worldPos.xyz / worldPos.w;
+}
+
+// inverse of the g-buffer's octahedral normal encoding
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// specular intensity from the top 5 bits of the packed alpha
+float DecodeSpecular(float packed)
+{
+    return float(int(packed * 255.0 + 0.5) / 8) / 31.0;
+}
+
+vec3 CalcPointLight(int light, vec3 FragPos, vec3 Normal, vec3 Diffuse, float Specular, vec3 viewDir)
+{
+    vec4 positionRadius = texelFetch(lightData, light * 3);
+    vec3 color = texelFetch(lightData, light * 3 + 1).rgb;
+    vec2 attenuationTerms = texelFetch(lightData, light * 3 + 2).xy;
+    // calculate distance between light source and current fragment
+    float distance = length(positionRadius.xyz - FragPos);
+    if(distance >= positionRadius.w)
+        return vec3(0.0);
+    // diffuse
+    vec3 lightDir = normalize(positionRadius.xyz - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * color;
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+    vec3 specular = color * spec * Specular;
+    // attenuation
+    float attenuation = 1.0 / (1.0 + attenuationTerms.x * distance + attenuationTerms.y * distance * distance);
+    return (diffuse + specular) * attenuation;
+}
+
 void main()
 {             
     // retrieve data from gbuffer
-    vec3 FragPos = texture(gPosition, TexCoords).rgb;
-    vec3 Normal = texture(gNormal, TexCoords).rgb;
-    vec3 Diffuse = texture(gAlbedoSpec, TexCoords).rgb;
-    float Specular = texture(gAlbedoSpec, TexCoords).a;
+    vec3 FragPos = WorldPosition(TexCoords);
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = DecodeSpecular(AlbedoSpec.a);
     
     // then calculate lighting as usual
     vec3 lighting  = Diffuse * 0.1; // hard-coded ambient component
     vec3 viewDir  = normalize(viewPos - FragPos);
-    for(int i = 0; i < NR_LIGHTS; ++i)
+    if(useClusters)
+    {
+        // only visit the lights binned into this pixel's cluster
+        float depth = max(-(view * vec4(FragPos, 1.0)).z, 1e-4);
+        ivec3 cluster = ivec3(ivec2(gl_FragCoord.xy) / tileSize, int(floor(log(depth) * sliceScale + sliceBias)));
+        cluster = clamp(cluster, ivec3(0), clusterCounts - 1);
+        int index = (cluster.z * clusterCounts.y + cluster.y) * clusterCounts.x + cluster.x;
+        uvec2 range = texelFetch(clusterGrid, index).xy;
+        for(uint i = 0u; i < range.y; ++i)
+            lighting += CalcPointLight(int(texelFetch(lightIndices, int(range.x + i)).r), FragPos, Normal, Diffuse, Specular, viewDir);
+    }
+    else
     {
-        // calculate distance between light source and current fragment
-        float distance = length(lights[i].Position - FragPos);
-        if(distance < lights[i].Radius)
-        {
-            // diffuse
-            vec3 lightDir = normalize(lights[i].Position - FragPos);
-            vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * lights[i].Color;
-            // specular
-            vec3 halfwayDir = normalize(lightDir + viewDir);  
-            float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
-            vec3 specular = lights[i].Color * spec * Specular;
-            // attenuation
-            float attenuation = 1.0 / (1.0 + lights[i].Linear * distance + lights[i].Quadratic * distance * distance);
-            diffuse *= attenuation;
-            specular *= attenuation;
-            lighting += diffuse + specular;
-        }
-    }    
+        for(int i = 0; i < lightCount; ++i)
+            lighting += CalcPointLight(i, FragPos, Normal, Diffuse, Specular, viewDir);
+    }
     FragColor = vec4(lighting, 1.0);
 }
\ No newline at end of file
@@ -0,0 +1,65 @@
+#version 330 core
+out vec4 FragColor;
+
+flat in vec4 PositionRadius;
+flat in vec3 Color;
+flat in vec2 Attenuation;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedoSpec;
+uniform mat4 inverseViewProjection;
+
+uniform vec2 screenSize;
+uniform vec3 viewPos;
+
+// world space position of the surface at uv, from the depth buffer
+vec3 WorldPosition(vec2 uv)
+{
+    vec4 clipPos = vec4(vec3(uv, texture(gDepth, uv).r) * 2.0 - 1.0, 1.0);
+    vec4 worldPos = inverseViewProjection * clipPos;
+    return worldPos.xyz / worldPos.w;
+}
+
+// inverse of the g-buffer's octahedral normal encoding
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
+// specular intensity from the top 5 bits of the packed alpha
+float DecodeSpecular(float packed)
+{
+    return float(int(packed * 255.0 + 0.5) / 8) / 31.0;
+}
+
+void main()
+{             
+    // retrieve data from gbuffer at the pixel the volume covers
+    vec2 TexCoords = gl_FragCoord.xy / screenSize;
+    vec3 FragPos = WorldPosition(TexCoords);
+    // the depth test only rejected surfaces behind the volume, this rejects the ones in front of it
+    float distance = length(PositionRadius.xyz - FragPos);
+    if(distance >= PositionRadius.w)
+        discard;
+    vec3 Normal = DecodeNormal(texture(gNormal, TexCoords).rg);
+    vec4 AlbedoSpec = texture(gAlbedoSpec, TexCoords);
+    vec3 Diffuse = AlbedoSpec.rgb;
+    float Specular = DecodeSpecular(AlbedoSpec.a);
+
+    vec3 viewDir  = normalize(viewPos - FragPos);
+    // diffuse
+    vec3 lightDir = normalize(PositionRadius.xyz - FragPos);
+    vec3 diffuse = max(dot(Normal, lightDir), 0.0) * Diffuse * Color;
+    // specular
+    vec3 halfwayDir = normalize(lightDir + viewDir);  
+    float spec = pow(max(dot(Normal, halfwayDir), 0.0), 16.0);
+    vec3 specular = Color * spec * Specular;
+    // attenuation
+    float attenuation = 1.0 / (1.0 + Attenuation.x * distance + Attenuation.y * distance * distance);
+    FragColor = vec4((diffuse + specular) * attenuation, 1.0);
+}
\ No newline at end of file
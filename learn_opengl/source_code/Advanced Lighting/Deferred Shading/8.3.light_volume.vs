@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+// per light (instance)
+layout (location = 3) in vec4 aPositionRadius;
+layout (location = 4) in vec3 aColor;
+layout (location = 5) in vec2 aAttenuation; // linear, quadratic
+
+flat out vec4 PositionRadius;
+flat out vec3 Color;
+flat out vec2 Attenuation;
+
+uniform mat4 projection;
+uniform mat4 view;
+uniform float volumeScale; // grows the low poly sphere until it encloses the real one
+
+void main()
+{
+    PositionRadius = aPositionRadius;
+    Color = aColor;
+    Attenuation = aAttenuation;
+    vec3 worldPos = aPositionRadius.xyz + aPos * aPositionRadius.w * volumeScale;
+    gl_Position = projection * view * vec4(worldPos, 1.0);
+}
\ No newline at end of file
@@ -8,6 +8,7 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "light_clusters.h"
 #include "filesystem.h"
 
 #include <iostream>
@@ -17,6 +18,7 @@ void sleep(void);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
 void renderCube();
+void renderLightVolumes(const std::vector<ClusterLight> &lights, unsigned int count);
 
 // settings
 const unsigned int SCR_WIDTH = 640;
@@ -36,10 +38,29 @@ bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
 
+// how the lights are applied: C cycles through them
+enum LightingMode {
+    LIGHTING_CLUSTERED, // fullscreen quad, each pixel visits the lights of its cluster
+    LIGHTING_VOLUMES,   // one instanced sphere per light, blended additively
+    LIGHTING_ALL,       // fullscreen quad, each pixel visits every light
+    LIGHTING_MODE_COUNT
+};
+const char *lightingModeNames[LIGHTING_MODE_COUNT] = { "clustered", "light volumes", "all lights per pixel" };
+
+// lights: + / - doubles / halves how many are active
+const unsigned int MAX_LIGHTS = 4096;
+unsigned int lightCount = 1024;
+LightingMode lightingMode = LIGHTING_CLUSTERED;
+int lights_changed = 0;
+int mode_changed = 0;
+
 int main(int argc, char *argv[])
 {
     SDL_Init(SDL_INIT_VIDEO);
     SDL_WM_SetCaption("LearnOpenGL",NULL);
+    // the light volumes are stencil tested against the g-buffer's depth/stencil, blitted to the window
+    SDL_GL_SetAttribute(SDL_GL_DEPTH_SIZE, 24);
+    SDL_GL_SetAttribute(SDL_GL_STENCIL_SIZE, 8);
     SDL_SetVideoMode(640, 480, 32, SDL_OPENGL);//|SDL_RESIZABLE);
 
     // glad: load all OpenGL function pointers
@@ -62,6 +83,7 @@ int main(int argc, char *argv[])
     Shader shaderGeometryPass("8.1.g_buffer.vs", "8.1.g_buffer.fs");
     Shader shaderLightingPass("8.1.deferred_shading.vs", "8.2.deferred_shading.fs");
     Shader shaderLightBox("8.1.deferred_light_box.vs", "8.1.deferred_light_box.fs");
+    Shader shaderLightVolume("8.3.light_volume.vs", "8.3.light_volume.fs");
 
     // load models
     // -----------
@@ -83,37 +105,32 @@ int main(int argc, char *argv[])
     unsigned int gBuffer;
     glGenFramebuffers(1, &gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedoSpec;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
+    // no position buffer: the lighting pass rebuilds it from the depth texture and the inverse view-projection
+    unsigned int gNormal, gAlbedoSpec, gDepth;
+    // normal color buffer, octahedral encoded into 2 x 16 bit
     glGenTextures(1, &gNormal);
     glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_UNSIGNED_SHORT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // color + specular color buffer
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gNormal, 0);
+    // color + specular (5 bits) / material ID (3 bits) color buffer
     glGenTextures(1, &gAlbedoSpec);
     glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedoSpec, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedoSpec, 0);
     // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+    // create and attach depth buffer, as a texture the lighting pass can read, with stencil to mark the pixels covered by geometry
+    glGenTextures(1, &gDepth);
+    glBindTexture(GL_TEXTURE_2D, gDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH24_STENCIL8, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
     // finally check if framebuffer is complete
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
@@ -121,30 +138,53 @@ int main(int argc, char *argv[])
 
     // lighting info
     // -------------
-    const unsigned int NR_LIGHTS = 32;
-    std::vector<glm::vec3> lightPositions;
-    std::vector<glm::vec3> lightColors;
+    std::vector<ClusterLight> lights;
     srand(13);
-    for (unsigned int i = 0; i < NR_LIGHTS; i++)
+    for (unsigned int i = 0; i < MAX_LIGHTS; i++)
     {
+        ClusterLight light;
         // calculate slightly random offsets
         float xPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 3.0);
         float yPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 4.0);
         float zPos = static_cast<float>(((rand() % 100) / 100.0) * 6.0 - 3.0);
-        lightPositions.push_back(glm::vec3(xPos, yPos, zPos));
+        light.Position = glm::vec3(xPos, yPos, zPos);
         // also calculate random color
         float rColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.)
         float gColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.)
         float bColor = static_cast<float>(((rand() % 100) / 200.0f) + 0.5); // between 0.5 and 1.)
-        lightColors.push_back(glm::vec3(rColor, gColor, bColor));
+        light.Color = glm::vec3(rColor, gColor, bColor);
+        // attenuation parameters; with this many lights each one only reaches a small neighbourhood
+        const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
+        light.Linear = 4.5f;
+        light.Quadratic = 75.0f;
+        // then calculate radius of light volume/sphere
+        const float maxBrightness = std::fmaxf(std::fmaxf(light.Color.r, light.Color.g), light.Color.b);
+        light.Radius = (-light.Linear + std::sqrt(light.Linear * light.Linear - 4 * light.Quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * light.Quadratic);
+        lights.push_back(light);
     }
 
+    // clusters: 32x32 pixel tiles times 16 depth slices, the lights are binned into them every frame
+    // ------------------------------------------------------------------------------------------------
+    LightClusters clusters(SCR_WIDTH, SCR_HEIGHT);
+    unsigned int lightingQuery;
+    glGenQueries(1, &lightingQuery);
+    bool queryPending = false;
+    float lightingTimeMs = 0.0f;
+    unsigned int lastReport = SDL_GetTicks();
+
     // shader configuration
     // --------------------
     shaderLightingPass.use();
-    shaderLightingPass.setInt("gPosition", 0);
+    shaderLightingPass.setInt("gDepth", 0);
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedoSpec", 2);
+    shaderLightVolume.use();
+    shaderLightVolume.setInt("gDepth", 0);
+    shaderLightVolume.setInt("gNormal", 1);
+    shaderLightVolume.setInt("gAlbedoSpec", 2);
+    shaderLightVolume.setVec2("screenSize", glm::vec2(SCR_WIDTH, SCR_HEIGHT));
+    // renderLightVolumes() uses a 16 x 12 segment sphere, whose faces sit inside the unit sphere
+    shaderLightVolume.setFloat("volumeScale", 1.0f / (std::cos(glm::pi<float>() / 16.0f) * std::cos(glm::pi<float>() / 12.0f)));
 
     // render loop
     // -----------
@@ -168,8 +208,19 @@ int main(int argc, char *argv[])
         // 1. geometry pass: render scene's geometry/color data into gbuffer
         // -----------------------------------------------------------------
         glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+        // stencil 1 wherever there is geometry, the light volumes skip everything else
+        glEnable(GL_STENCIL_TEST);
+        glStencilFunc(GL_ALWAYS, 1, 0xFF);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        // the zoom changes the frustum, so the cluster bounds follow it
+        static float clusterZoom = 0.0f;
+        if (camera.Zoom != clusterZoom)
+        {
+            clusters.SetProjection(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            clusterZoom = camera.Zoom;
+        }
         glm::mat4 view = camera.GetViewMatrix();
         glm::mat4 model = glm::mat4(1.0f);
         shaderGeometryPass.use();
@@ -183,60 +234,116 @@ int main(int argc, char *argv[])
             shaderGeometryPass.setMat4("model", model);
             backpack.Draw(shaderGeometryPass);
         }
+        glDisable(GL_STENCIL_TEST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+        // 2. copy content of geometry's depth and stencil buffer to default framebuffer's: the light volumes are tested against them
+        // ----------------------------------------------------------------------------------------------------------------------------
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
+        // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
+        // the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the
+        // depth buffer in another shader stage (or somehow see to match the default framebuffer's internal format with the FBO's internal format).
+        glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT, GL_NEAREST);
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 2. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content.
+        // 3. lighting pass: calculate lighting by iterating over a screen filled quad pixel-by-pixel using the gbuffer's content,
+        //    or, with light volumes, only over the pixels each light's sphere covers.
         // -----------------------------------------------------------------------------------------------------------------------
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shaderLightingPass.use();
+        glClear(GL_COLOR_BUFFER_BIT);
+        // bin the lights into the view's clusters and upload the lists
+        if (lightingMode != LIGHTING_VOLUMES)
+            clusters.Build(lights, lightCount, view);
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
+        glBindTexture(GL_TEXTURE_2D, gDepth);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, gNormal);
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, gAlbedoSpec);
-        // send light relevant uniforms
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
+        clusters.Bind(shaderLightingPass, 3);
+        shaderLightingPass.setBool("useClusters", lightingMode == LIGHTING_CLUSTERED);
+        // the volumes only take the ambient term from the fullscreen pass
+        if (lightingMode == LIGHTING_VOLUMES)
+            shaderLightingPass.setInt("lightCount", 0);
+        shaderLightingPass.setMat4("view", view);
+        shaderLightingPass.setVec3("viewPos", camera.Position);
+        glm::mat4 inverseViewProjection = glm::inverse(projection * view);
+        shaderLightingPass.setMat4("inverseViewProjection", inverseViewProjection);
+        // finally render quad (and volumes), timed without waiting on the GPU: last frame's result is read once it is ready
+        if (queryPending)
         {
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Position", lightPositions[i]);
-            shaderLightingPass.setVec3("lights[" + std::to_string(i) + "].Color", lightColors[i]);
-            // update attenuation parameters and calculate radius
-            const float constant = 1.0f; // note that we don't send this to the shader, we assume it is always 1.0 (in our case)
-            const float linear = 0.7f;
-            const float quadratic = 1.8f;
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Linear", linear);
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Quadratic", quadratic);
-            // then calculate radius of light volume/sphere
-            const float maxBrightness = std::fmaxf(std::fmaxf(lightColors[i].r, lightColors[i].g), lightColors[i].b);
-            float radius = (-linear + std::sqrt(linear * linear - 4 * quadratic * (constant - (256.0f / 5.0f) * maxBrightness))) / (2.0f * quadratic);
-            shaderLightingPass.setFloat("lights[" + std::to_string(i) + "].Radius", radius);
+            GLint available = 0;
+            glGetQueryObjectiv(lightingQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(lightingQuery, GL_QUERY_RESULT, &elapsed);
+                lightingTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
         }
-        shaderLightingPass.setVec3("viewPos", camera.Position);
-        // finally render quad
+        if (!queryPending)
+            glBeginQuery(GL_TIME_ELAPSED, lightingQuery);
+        glDisable(GL_DEPTH_TEST);
         renderQuad();
+        glEnable(GL_DEPTH_TEST);
+        if (lightingMode == LIGHTING_VOLUMES)
+        {
+            // back faces pass the depth test only where the scene surface lies in front of them, which also holds
+            // with the camera inside a volume; the shader rejects surfaces in front of the volume. Additive, no
+            // depth writes, and only on pixels the geometry pass marked in the stencil.
+            shaderLightVolume.use();
+            shaderLightVolume.setMat4("projection", projection);
+            shaderLightVolume.setMat4("view", view);
+            shaderLightVolume.setVec3("viewPos", camera.Position);
+            shaderLightVolume.setMat4("inverseViewProjection", inverseViewProjection);
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_ONE, GL_ONE);
+            glDepthMask(GL_FALSE);
+            glDepthFunc(GL_GEQUAL);
+            glEnable(GL_CULL_FACE);
+            glCullFace(GL_FRONT);
+            glEnable(GL_STENCIL_TEST);
+            glStencilFunc(GL_EQUAL, 1, 0xFF);
+            glStencilMask(0x00);
+            renderLightVolumes(lights, lightCount);
+            glStencilMask(0xFF);
+            glDisable(GL_STENCIL_TEST);
+            glCullFace(GL_BACK);
+            glDisable(GL_CULL_FACE);
+            glDepthFunc(GL_LESS);
+            glDepthMask(GL_TRUE);
+            glDisable(GL_BLEND);
+        }
+        if (!queryPending)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+        glActiveTexture(GL_TEXTURE0);
 
-        // 2.5. copy content of geometry's depth buffer to default framebuffer's depth buffer
-        // ----------------------------------------------------------------------------------
-        glBindFramebuffer(GL_READ_FRAMEBUFFER, gBuffer);
-        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0); // write to default framebuffer
-        // blit to default framebuffer. Note that this may or may not work as the internal formats of both the FBO and default framebuffer have to match.
-        // the internal formats are implementation defined. This works on all of my systems, but if it doesn't on yours you'll likely have to write to the
-        // depth buffer in another shader stage (or somehow see to match the default framebuffer's internal format with the FBO's internal format).
-        glBlitFramebuffer(0, 0, SCR_WIDTH, SCR_HEIGHT, 0, 0, SCR_WIDTH, SCR_HEIGHT, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            std::cout << lightCount << " lights, " << lightingModeNames[lightingMode] << " | lighting pass: " << lightingTimeMs << " ms";
+            if (lightingMode == LIGHTING_CLUSTERED)
+                std::cout << " | binning: " << clusters.stats.binTimeUs << " us, " << clusters.stats.lights << " visible, "
+                          << clusters.stats.indices << " indices, max " << clusters.stats.maxPerCluster << " per cluster";
+            std::cout << std::endl;
+            lastReport = SDL_GetTicks();
+        }
 
-        // 3. render lights on top of scene
+        // 4. render lights on top of scene
         // --------------------------------
         shaderLightBox.use();
         shaderLightBox.setMat4("projection", projection);
         shaderLightBox.setMat4("view", view);
-        for (unsigned int i = 0; i < lightPositions.size(); i++)
+        for (unsigned int i = 0; i < lightCount; i++)
         {
             model = glm::mat4(1.0f);
-            model = glm::translate(model, lightPositions[i]);
-            model = glm::scale(model, glm::vec3(0.125f));
+            model = glm::translate(model, lights[i].Position);
+            model = glm::scale(model, glm::vec3(0.03125f));
             shaderLightBox.setMat4("model", model);
-            shaderLightBox.setVec3("lightColor", lightColors[i]);
+            shaderLightBox.setVec3("lightColor", lights[i].Color);
             renderCube();
         }
 
@@ -322,6 +429,27 @@ void processInput(void)
         camera.ProcessMouseMovement(-10, 0);
     else if(keys[SDLK_RIGHT])
         camera.ProcessMouseMovement(10, 0);
+
+    if ((keys[SDLK_EQUALS] || keys[SDLK_KP_PLUS]) && !lights_changed)
+    {
+        lightCount = std::min(lightCount * 2, MAX_LIGHTS);
+        lights_changed = 1;
+    }
+    else if ((keys[SDLK_MINUS] || keys[SDLK_KP_MINUS]) && !lights_changed)
+    {
+        lightCount = std::max(lightCount / 2, 32u);
+        lights_changed = 1;
+    }
+    else if (!keys[SDLK_EQUALS] && !keys[SDLK_KP_PLUS] && !keys[SDLK_MINUS] && !keys[SDLK_KP_MINUS])
+        lights_changed = 0;
+
+    if (keys[SDLK_c] && !mode_changed)
+    {
+        lightingMode = static_cast<LightingMode>((lightingMode + 1) % LIGHTING_MODE_COUNT);
+        mode_changed = 1;
+    }
+    else if (!keys[SDLK_c])
+        mode_changed = 0;
 }
 
 void sleep(void)
@@ -492,3 +620,87 @@ void renderQuad()
     glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
     glBindVertexArray(0);
 }
+
+
+// renderLightVolumes() draws one low-poly unit sphere per light, instanced and scaled by the light's radius
+// ---------------------------------------------------------------------------------------------------------
+unsigned int sphereVAO = 0;
+unsigned int sphereIndexCount = 0;
+void renderLightVolumes(const std::vector<ClusterLight> &lights, unsigned int count)
+{
+    if (sphereVAO == 0)
+    {
+        const unsigned int X_SEGMENTS = 16;
+        const unsigned int Y_SEGMENTS = 12;
+        const float PI = 3.14159265359f;
+        std::vector<float> positions;
+        std::vector<unsigned int> indices;
+        for (unsigned int y = 0; y <= Y_SEGMENTS; ++y)
+        {
+            for (unsigned int x = 0; x <= X_SEGMENTS; ++x)
+            {
+                float theta = (float)y / Y_SEGMENTS * PI;
+                float phi = (float)x / X_SEGMENTS * 2.0f * PI;
+                positions.push_back(std::cos(phi) * std::sin(theta));
+                positions.push_back(std::cos(theta));
+                positions.push_back(std::sin(phi) * std::sin(theta));
+            }
+        }
+        // counter-clockwise seen from outside, so culling front faces keeps the far side
+        for (unsigned int y = 0; y < Y_SEGMENTS; ++y)
+        {
+            for (unsigned int x = 0; x < X_SEGMENTS; ++x)
+            {
+                unsigned int i0 = y * (X_SEGMENTS + 1) + x;
+                unsigned int i2 = i0 + X_SEGMENTS + 1;
+                indices.push_back(i0);
+                indices.push_back(i0 + 1);
+                indices.push_back(i2);
+                indices.push_back(i0 + 1);
+                indices.push_back(i2 + 1);
+                indices.push_back(i2);
+            }
+        }
+        sphereIndexCount = static_cast<unsigned int>(indices.size());
+
+        // the lights never move: their instance data is uploaded once, a draw just uses the first count of them
+        std::vector<float> instances;
+        for (unsigned int i = 0; i < lights.size(); i++)
+        {
+            const ClusterLight &light = lights[i];
+            float data[] = {
+                light.Position.x, light.Position.y, light.Position.z, light.Radius,
+                light.Color.x, light.Color.y, light.Color.z,
+                light.Linear, light.Quadratic
+            };
+            instances.insert(instances.end(), data, data + 9);
+        }
+
+        unsigned int vbo, ebo, instanceVBO;
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &vbo);
+        glGenBuffers(1, &ebo);
+        glGenBuffers(1, &instanceVBO);
+        glBindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), &positions[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+        glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(float), &instances[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)0);
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(4 * sizeof(float)));
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 2, GL_FLOAT, GL_FALSE, 9 * sizeof(float), (void*)(7 * sizeof(float)));
+        glVertexAttribDivisor(3, 1);
+        glVertexAttribDivisor(4, 1);
+        glVertexAttribDivisor(5, 1);
+    }
+    glBindVertexArray(sphereVAO);
+    glDrawElementsInstanced(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, 0, count);
+    glBindVertexArray(0);
+}
\ No newline at end of file
@@ -0,0 +1,39 @@
+#version 330 core
+out float AdaptedLogLuminance;
+
+uniform sampler2D histogram; // binCount x 1 block counts
+uniform sampler2D previous;  // last frame's adapted log2 luminance
+uniform int binCount;
+uniform float minLogLuminance;
+uniform float logLuminanceRange;
+uniform float lowPercent;  // the darkest and brightest parts of the picture are left out of the average,
+uniform float highPercent; // so a few lamps or a black corner don't swing the exposure
+uniform float blend;       // how far to move towards this frame's average
+uniform bool reset;
+
+void main()
+{
+    float total = 0.0;
+    for (int i = 0; i < binCount; ++i)
+        total += texelFetch(histogram, ivec2(i, 0), 0).r;
+
+    // average log2 luminance of the blocks between the low and high percentiles
+    float low = total * lowPercent;
+    float high = total * highPercent;
+    float below = 0.0;
+    float sum = 0.0;
+    float count = 0.0;
+    for (int i = 0; i < binCount; ++i)
+    {
+        float blocks = texelFetch(histogram, ivec2(i, 0), 0).r;
+        float inside = max(min(below + blocks, high) - max(below, low), 0.0); // the part of this bin in the range
+        sum += inside * (minLogLuminance + (float(i) + 0.5) / float(binCount) * logLuminanceRange);
+        count += inside;
+        below += blocks;
+    }
+    float target = count > 0.0 ? sum / count : minLogLuminance;
+
+    float adapted = texelFetch(previous, ivec2(0, 0), 0).r;
+    // adapting in log2 space brightens and darkens at the same perceived rate
+    AdaptedLogLuminance = reset ? target : mix(adapted, target, blend);
+}
\ No newline at end of file
@@ -4,8 +4,12 @@ out vec4 FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D hdrBuffer;
+uniform sampler2D adaptedLuminance; // 1x1, log2 of the scene's adapted average luminance
 uniform bool hdr;
-uniform float exposure;
+uniform bool autoExposure;
+uniform float exposure; // with autoExposure on, a compensation on top of it
+
+const float keyValue = 0.3; // what the adapted average luminance is scaled to before tone mapping
 
 void main()
 {             
@@ -16,7 +20,10 @@ void main()
         // reinhard
         // vec3 result = hdrColor / (hdrColor + vec3(1.0));
         // exposure
-        vec3 result = vec3(1.0) - exp(-hdrColor * exposure);
+        float exposureValue = exposure;
+        if(autoExposure)
+            exposureValue *= keyValue / exp2(texelFetch(adaptedLuminance, ivec2(0, 0), 0).r);
+        vec3 result = vec3(1.0) - exp(-hdrColor * exposureValue);
         // also gamma correct while we're at it       
         result = pow(result, vec3(1.0 / gamma));
         FragColor = vec4(result, 1.0);
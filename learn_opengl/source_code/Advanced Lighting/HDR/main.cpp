@@ -9,8 +9,10 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "auto_exposure.h"
 
 #include <iostream>
+#include <algorithm>
 
 void processInput(void);
 void sleep(void);
@@ -24,6 +26,10 @@ const unsigned int SCR_HEIGHT = 480;
 bool hdr = true;
 bool hdrKeyPressed = false;
 float exposure = 1.0f;
+// T toggles automatic exposure, which then treats exposure (Q/E) as a compensation; B/N slow down/speed up its adaptation
+bool autoExposure = true;
+bool autoExposureKeyPressed = false;
+float adaptationSpeed = 1.5f;
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 5.0f));
@@ -61,6 +67,8 @@ int main(int argc, char *argv[])
     // -------------------------
     Shader shader("6.lighting.vs", "6.lighting.fs");
     Shader hdrShader("6.hdr.vs", "6.hdr.fs");
+    Shader histogramShader("6.exposure_histogram.vs", "6.exposure_histogram.fs");
+    Shader adaptShader("6.exposure_adapt.vs", "6.exposure_adapt.fs");
 
     // load textures
     // -------------
@@ -90,6 +98,10 @@ int main(int argc, char *argv[])
         std::cout << "Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
+    // automatic exposure: a luminance histogram of the HDR buffer, reduced and adapted on the GPU
+    AutoExposure exposureControl(SCR_WIDTH, SCR_HEIGHT);
+    unsigned int lastReport = 0;
+
     // lighting info
     // -------------
     // positions
@@ -111,6 +123,7 @@ int main(int argc, char *argv[])
     shader.setInt("diffuseTexture", 0);
     hdrShader.use();
     hdrShader.setInt("hdrBuffer", 0);
+    hdrShader.setInt("adaptedLuminance", 1);
 
     // render loop
     // -----------
@@ -158,13 +171,32 @@ int main(int argc, char *argv[])
             renderCube();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-        // 2. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
+        // 2. measure the scene's luminance and adapt the exposure to it, entirely on the GPU
+        // ----------------------------------------------------------------------------------
+        if (autoExposure)
+        {
+            exposureControl.adaptationSpeed = adaptationSpeed;
+            exposureControl.Update(histogramShader, adaptShader, colorBuffer, deltaTime / 1000.0f);
+        }
+        else
+            exposureControl.Reset();
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            if (autoExposure)
+                std::cout << "adapted luminance " << exposureControl.averageLuminance << ", adaptation speed " << adaptationSpeed << std::endl;
+        }
+
+        // 3. now render floating point color buffer to 2D quad and tonemap HDR colors to default framebuffer's (clamped) color range
         // --------------------------------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         hdrShader.use();
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, colorBuffer);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, exposureControl.Result());
         hdrShader.setInt("hdr", hdr);
+        hdrShader.setInt("autoExposure", autoExposure);
         hdrShader.setFloat("exposure", exposure);
         renderQuad();
 
@@ -263,6 +295,21 @@ void processInput(void)
         hdrKeyPressed = false;
     }
 
+    if (keys[SDLK_t] && !autoExposureKeyPressed)
+    {
+        autoExposure = !autoExposure;
+        std::cout << "auto exposure " << (autoExposure ? "on" : "off") << std::endl;
+        autoExposureKeyPressed = true;
+    }
+    if (!keys[SDLK_t])
+    {
+         autoExposureKeyPressed = false;
+    }
+    if (keys[SDLK_b])
+        adaptationSpeed = std::max(adaptationSpeed - 0.05f, 0.1f);
+    else if (keys[SDLK_n])
+        adaptationSpeed = std::min(adaptationSpeed + 0.05f, 10.0f);
+
     if (keys[SDLK_q])
     {
         if (exposure > 0.0f)
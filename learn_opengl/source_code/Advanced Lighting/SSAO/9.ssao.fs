@@ -3,38 +3,60 @@ out float FragColor;
 
 in vec2 TexCoords;
 
-uniform sampler2D gPosition;
-uniform sampler2D gNormal;
+uniform sampler2D viewDepth; // linear view depth at the AO resolution
+uniform sampler2D gNormal;   // octahedral normals at the AO resolution
 uniform sampler2D texNoise;
 
 uniform vec3 samples[64];
+uniform int kernelSize;   // how many of them this frame uses
+uniform int kernelStride; // with temporal accumulation each frame takes every kernelStride-th sample,
+uniform int kernelOffset; // starting at kernelOffset, so a few frames together cover the whole kernel
+uniform float kernelRotation; // per frame angle the kernel is turned by around the normal
 
 // parameters (you'd probably want to use them as uniforms to more easily tweak the effect)
-int kernelSize = 64;
 float radius = 0.5;
 float bias = 0.025;
 
-// tile noise texture over screen based on screen dimensions divided by noise size
-const vec2 noiseScale = vec2(800.0/4.0, 600.0/4.0); 
+// tile noise texture over the AO buffer based on its dimensions divided by noise size
+uniform vec2 noiseScale;
 
 uniform mat4 projection;
 
+// view space position of the surface at uv: the view ray through uv, scaled to the stored depth
+vec3 ViewPosition(vec2 uv)
+{
+    float depth = texture(viewDepth, uv).r;
+    return vec3((uv * 2.0 - 1.0) * vec2(1.0 / projection[0][0], 1.0 / projection[1][1]) * depth, -depth);
+}
+
+// inverse of the g-buffer's octahedral normal encoding
+vec3 DecodeNormal(vec2 f)
+{
+    f = f * 2.0 - 1.0;
+    vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+    float t = clamp(-n.z, 0.0, 1.0);
+    n.xy += vec2(n.x >= 0.0 ? -t : t, n.y >= 0.0 ? -t : t);
+    return normalize(n);
+}
+
 void main()
 {
     // get input for SSAO algorithm
-    vec3 fragPos = texture(gPosition, TexCoords).xyz;
-    vec3 normal = normalize(texture(gNormal, TexCoords).rgb);
+    vec3 fragPos = ViewPosition(TexCoords);
+    vec3 normal = DecodeNormal(texture(gNormal, TexCoords).rg);
     vec3 randomVec = normalize(texture(texNoise, TexCoords * noiseScale).xyz);
     // create TBN change-of-basis matrix: from tangent-space to view-space
     vec3 tangent = normalize(randomVec - normal * dot(randomVec, normal));
     vec3 bitangent = cross(normal, tangent);
+    tangent = tangent * cos(kernelRotation) + bitangent * sin(kernelRotation);
+    bitangent = cross(normal, tangent);
     mat3 TBN = mat3(tangent, bitangent, normal);
     // iterate over the sample kernel and calculate occlusion factor
     float occlusion = 0.0;
     for(int i = 0; i < kernelSize; ++i)
     {
         // get sample position
-        vec3 samplePos = TBN * samples[i]; // from tangent to view-space
+        vec3 samplePos = TBN * samples[i * kernelStride + kernelOffset]; // from tangent to view-space
         samplePos = fragPos + samplePos * radius; 
         
         // project sample position (to sample texture) (to get position on screen/texture)
@@ -44,7 +66,7 @@ void main()
         offset.xyz = offset.xyz * 0.5 + 0.5; // transform to range 0.0 - 1.0
         
         // get sample depth
-        float sampleDepth = texture(gPosition, offset.xy).z; // get depth value of kernel sample
+        float sampleDepth = -texture(viewDepth, offset.xy).r; // get depth value of kernel sample
         
         // range check & accumulate
         float rangeCheck = smoothstep(0.0, 1.0, radius / abs(fragPos.z - sampleDepth));
@@ -4,18 +4,26 @@ out float FragColor;
 in vec2 TexCoords;
 
 uniform sampler2D ssaoInput;
+uniform sampler2D viewDepth; // linear depth at the same resolution
+uniform vec2 direction;      // (1, 0) for the horizontal pass, (0, 1) for the vertical one
+
+const int RADIUS = 4;
+const float SHARPNESS = 16.0; // how quickly samples across a depth edge stop counting
 
 void main() 
 {
     vec2 texelSize = 1.0 / vec2(textureSize(ssaoInput, 0));
+    float centerDepth = texture(viewDepth, TexCoords).r;
     float result = 0.0;
-    for (int x = -2; x < 2; ++x) 
+    float totalWeight = 0.0;
+    for (int i = -RADIUS; i <= RADIUS; ++i) 
     {
-        for (int y = -2; y < 2; ++y) 
-        {
-            vec2 offset = vec2(float(x), float(y)) * texelSize;
-            result += texture(ssaoInput, TexCoords + offset).r;
-        }
+        vec2 offset = direction * float(i) * texelSize;
+        float sampleDepth = texture(viewDepth, TexCoords + offset).r;
+        // gaussian falloff, times a weight that drops with the relative depth difference
+        float weight = exp(-float(i * i) / (2.0 * RADIUS)) * exp(-abs(sampleDepth - centerDepth) / centerDepth * SHARPNESS);
+        result += texture(ssaoInput, TexCoords + offset).r * weight;
+        totalWeight += weight;
     }
-    FragColor = result / (4.0 * 4.0);
-}  
\ No newline at end of file
+    FragColor = result / totalWeight;
+}
\ No newline at end of file
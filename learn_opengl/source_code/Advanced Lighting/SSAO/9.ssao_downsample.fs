@@ -0,0 +1,20 @@
+#version 330 core
+layout (location = 0) out float ViewDepth;
+layout (location = 1) out vec2 Normal;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+uniform int scale; // full resolution pixels per AO pixel, along each axis
+
+uniform mat4 projection;
+
+void main()
+{
+    // one full resolution texel per AO pixel, so its depth and normal always belong to the same surface
+    ivec2 texel = ivec2(gl_FragCoord.xy) * scale + scale / 2;
+    // store the linear view depth: the SSAO and blur passes then compare depths without unprojecting
+    float ndcDepth = texelFetch(gDepth, texel, 0).r * 2.0 - 1.0;
+    ViewDepth = projection[3][2] / (ndcDepth + projection[2][2]);
+    // the normal stays octahedral encoded
+    Normal = texelFetch(gNormal, texel, 0).rg;
+}
\ No newline at end of file
@@ -1,18 +1,32 @@
 #version 330 core
-layout (location = 0) out vec3 gPosition;
-layout (location = 1) out vec3 gNormal;
-layout (location = 2) out vec3 gAlbedo;
+layout (location = 0) out vec2 gNormal;
+layout (location = 1) out vec4 gAlbedo;
 
 in vec2 TexCoords;
-in vec3 FragPos;
 in vec3 Normal;
 
+uniform int materialID; // 0 - 7, for the lighting pass to tell surfaces apart
+
+// octahedral encoding: the unit normal is folded onto a square and stored in [0, 1]
+vec2 OctWrap(vec2 v)
+{
+    return (1.0 - abs(v.yx)) * vec2(v.x >= 0.0 ? 1.0 : -1.0, v.y >= 0.0 ? 1.0 : -1.0);
+}
+
+vec2 EncodeNormal(vec3 n)
+{
+    n /= abs(n.x) + abs(n.y) + abs(n.z);
+    n.xy = n.z >= 0.0 ? n.xy : OctWrap(n.xy);
+    return n.xy * 0.5 + 0.5;
+}
+
 void main()
 {    
-    // store the fragment position vector in the first gbuffer texture
-    gPosition = FragPos;
-    // also store the per-fragment normals into the gbuffer
-    gNormal = normalize(Normal);
+    // no position: the SSAO and lighting passes rebuild it from the depth buffer
+    // store the per-fragment view space normals into the gbuffer
+    gNormal = EncodeNormal(normalize(Normal));
     // and the diffuse per-fragment color
     gAlbedo.rgb = vec3(0.95);
+    // full specular intensity in the top 5 bits of the alpha component, material ID in the bottom 3
+    gAlbedo.a = float(31 * 8 + materialID) / 255.0;
 }
\ No newline at end of file
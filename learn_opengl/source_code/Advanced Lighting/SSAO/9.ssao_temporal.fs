@@ -0,0 +1,66 @@
+#version 330 core
+out vec4 History; // r: accumulated AO, g: its linear view depth, b: frames accumulated
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput;   // this frame's AO
+uniform sampler2D viewDepth;   // this frame's linear view depth
+uniform sampler2D history;     // last frame's output
+
+uniform mat4 projection;
+uniform mat4 previousProjection;
+uniform mat4 currentToPreviousView; // previous view * inverse(current view)
+uniform int historyValid;
+
+const float MIN_BLEND = 0.1;        // weight of the new frame once the history has converged
+const float MAX_FRAMES = 1.0 / MIN_BLEND - 1.0;
+const float DEPTH_TOLERANCE = 0.02; // relative depth difference above which a history texel belongs to another surface
+
+void main()
+{
+    float depth = texture(viewDepth, TexCoords).r;
+    float ao = texture(ssaoInput, TexCoords).r;
+    vec3 viewPos = vec3((TexCoords * 2.0 - 1.0) * vec2(1.0 / projection[0][0], 1.0 / projection[1][1]) * depth, -depth);
+
+    // where this surface was on screen last frame, and how far from the camera it was
+    vec3 previousViewPos = (currentToPreviousView * vec4(viewPos, 1.0)).xyz;
+    vec4 previousClip = previousProjection * vec4(previousViewPos, 1.0);
+    vec2 previousUV = previousClip.xy / previousClip.w * 0.5 + 0.5;
+    float expectedDepth = -previousViewPos.z;
+
+    // bilinear fetch of the history, keeping only the taps that saw the same surface: the others were
+    // disoccluded this frame and would smear old occlusion across the edge
+    float historyAO = 0.0;
+    float historyFrames = 0.0;
+    float totalWeight = 0.0;
+    if (historyValid != 0 && all(greaterThanEqual(previousUV, vec2(0.0))) && all(lessThanEqual(previousUV, vec2(1.0))))
+    {
+        vec2 size = vec2(textureSize(history, 0));
+        vec2 pos = previousUV * size - 0.5;
+        ivec2 base = ivec2(floor(pos));
+        vec2 f = fract(pos);
+        for (int y = 0; y < 2; ++y)
+        {
+            for (int x = 0; x < 2; ++x)
+            {
+                ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), ivec2(size) - 1);
+                vec3 tap = texelFetch(history, texel, 0).rgb;
+                float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+                float weight = abs(tap.g - expectedDepth) < DEPTH_TOLERANCE * expectedDepth ? bilinear : 0.0;
+                historyAO += tap.r * weight;
+                historyFrames += tap.b * weight;
+                totalWeight += weight;
+            }
+        }
+    }
+
+    // a running average over the first frames after a disocclusion, then an exponential one
+    float frames = 0.0;
+    if (totalWeight > 0.001)
+    {
+        historyAO /= totalWeight;
+        frames = min(historyFrames / totalWeight, MAX_FRAMES);
+        ao = mix(historyAO, ao, 1.0 / (frames + 1.0));
+    }
+    History = vec4(ao, depth, frames + 1.0, 1.0);
+}
\ No newline at end of file
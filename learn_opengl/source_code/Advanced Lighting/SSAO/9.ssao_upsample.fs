@@ -0,0 +1,38 @@
+#version 330 core
+out float FragColor;
+
+in vec2 TexCoords;
+
+uniform sampler2D ssaoInput; // blurred AO at the AO resolution
+uniform sampler2D viewDepth; // its linear depths
+uniform sampler2D gDepth;    // the full resolution depth buffer
+
+uniform mat4 projection;
+
+void main()
+{
+    float ndcDepth = texture(gDepth, TexCoords).r * 2.0 - 1.0;
+    float depth = projection[3][2] / (ndcDepth + projection[2][2]);
+
+    // joint bilateral: the 4 bilinear taps, each weighted down by how far its depth is from this pixel's,
+    // so occlusion doesn't bleed across depth edges as a halo
+    vec2 aoSize = vec2(textureSize(ssaoInput, 0));
+    vec2 pos = TexCoords * aoSize - 0.5;
+    ivec2 base = ivec2(floor(pos));
+    vec2 f = fract(pos);
+    float result = 0.0;
+    float totalWeight = 0.0;
+    for (int y = 0; y < 2; ++y)
+    {
+        for (int x = 0; x < 2; ++x)
+        {
+            ivec2 texel = clamp(base + ivec2(x, y), ivec2(0), ivec2(aoSize) - 1);
+            float bilinear = (x == 0 ? 1.0 - f.x : f.x) * (y == 0 ? 1.0 - f.y : f.y);
+            float depthDifference = abs(texelFetch(viewDepth, texel, 0).r - depth) / depth;
+            float weight = bilinear / (0.001 + depthDifference);
+            result += texelFetch(ssaoInput, texel, 0).r * weight;
+            totalWeight += weight;
+        }
+    }
+    FragColor = result / totalWeight;
+}
\ No newline at end of file
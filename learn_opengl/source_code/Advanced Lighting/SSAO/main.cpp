@@ -11,12 +11,15 @@
 #include "filesystem.h"
 
 #include <iostream>
+#include <random>
 
 void processInput(void);
 void sleep(void);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderQuad();
 void renderCube();
+std::vector<glm::vec3> generateKernel(unsigned int kernelSize);
+unsigned int createRenderTexture(unsigned int fbo, GLenum attachment);
 
 // settings
 const unsigned int SCR_WIDTH = 640;
@@ -37,6 +40,29 @@ float ourLerp(float a, float b, float f)
     return a + f * (b - a);
 }
 
+// SSAO quality presets: Q cycles through them. Below full resolution the AO is computed from a downsampled
+// depth/normal buffer, blurred with a depth-aware bilateral filter and upsampled with joint bilateral weights.
+struct SSAOPreset {
+    const char *name;
+    unsigned int scale;      // full resolution pixels per AO pixel, along each axis
+    unsigned int kernelSize; // samples per AO pixel
+};
+const SSAOPreset ssaoPresets[] = {
+    { "full resolution, 64 samples", 1, 64 },
+    { "half resolution, 64 samples", 2, 64 },
+    { "quarter resolution, 32 samples", 4, 32 }
+};
+const int SSAO_PRESET_COUNT = sizeof(ssaoPresets) / sizeof(ssaoPresets[0]);
+int ssaoPreset = 1;
+int preset_changed = 0;
+
+// temporal accumulation (T toggles it): each frame takes every TEMPORAL_KERNEL_STRIDE-th kernel sample, turned
+// by a different angle, and blends the result into last frame's AO reprojected to this frame
+const unsigned int TEMPORAL_KERNEL_STRIDE = 4;
+const float GOLDEN_ANGLE = 2.39996323f;
+bool temporalSSAO = true;
+int temporal_changed = 0;
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -65,6 +91,9 @@ int main(int argc, char *argv[])
     Shader shaderLightingPass("9.ssao.vs", "9.ssao_lighting.fs");
     Shader shaderSSAO("9.ssao.vs", "9.ssao.fs");
     Shader shaderSSAOBlur("9.ssao.vs", "9.ssao_blur.fs");
+    Shader shaderDownsample("9.ssao.vs", "9.ssao_downsample.fs");
+    Shader shaderUpsample("9.ssao.vs", "9.ssao_upsample.fs");
+    Shader shaderTemporal("9.ssao.vs", "9.ssao_temporal.fs");
 
     // load models
     // -----------
@@ -75,88 +104,82 @@ int main(int argc, char *argv[])
     unsigned int gBuffer;
     glGenFramebuffers(1, &gBuffer);
     glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gPosition, gNormal, gAlbedo;
-    // position color buffer
-    glGenTextures(1, &gPosition);
-    glBindTexture(GL_TEXTURE_2D, gPosition);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gPosition, 0);
-    // normal color buffer
+    // no position buffer: the SSAO and lighting passes rebuild it from the depth texture and the inverse projection
+    unsigned int gNormal, gAlbedo, gDepth;
+    // normal color buffer, octahedral encoded into 2 x 16 bit
     glGenTextures(1, &gNormal);
     glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, SCR_WIDTH, SCR_HEIGHT, 0, GL_RG, GL_UNSIGNED_SHORT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // color + specular color buffer
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gNormal, 0);
+    // color + specular (5 bits) / material ID (3 bits) color buffer
     glGenTextures(1, &gAlbedo);
     glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gAlbedo, 0);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gAlbedo, 0);
     // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
-    unsigned int attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(3, attachments);
-    // create and attach depth buffer (renderbuffer)
-    unsigned int rboDepth;
-    glGenRenderbuffers(1, &rboDepth);
-    glBindRenderbuffer(GL_RENDERBUFFER, rboDepth);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, SCR_WIDTH, SCR_HEIGHT);
-    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, rboDepth);
+    unsigned int attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, attachments);
+    // create and attach depth buffer, as a texture the SSAO pass samples around each pixel
+    glGenTextures(1, &gDepth);
+    glBindTexture(GL_TEXTURE_2D, gDepth);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SCR_WIDTH, SCR_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
     // finally check if framebuffer is complete
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
         std::cout << "Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    // also create framebuffer to hold SSAO processing stage
-    // -----------------------------------------------------
-    unsigned int ssaoFBO, ssaoBlurFBO;
-    glGenFramebuffers(1, &ssaoFBO);  glGenFramebuffers(1, &ssaoBlurFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-    unsigned int ssaoColorBuffer, ssaoColorBufferBlur;
-    // SSAO color buffer
-    glGenTextures(1, &ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-    // and blur stage
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-    glGenTextures(1, &ssaoColorBufferBlur);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
+    // also create framebuffers to hold the SSAO processing stages
+    // -----------------------------------------------------------
+    // the textures below full resolution are (re)allocated whenever the quality preset changes
+    unsigned int downsampleFBO, ssaoFBO, ssaoBlurFBO, upsampleFBO;
+    glGenFramebuffers(1, &downsampleFBO); glGenFramebuffers(1, &ssaoFBO);
+    glGenFramebuffers(1, &ssaoBlurFBO);   glGenFramebuffers(1, &upsampleFBO);
+    // linear view depth + normal at the AO resolution
+    unsigned int aoDepth = createRenderTexture(downsampleFBO, GL_COLOR_ATTACHMENT0);
+    unsigned int aoNormal = createRenderTexture(downsampleFBO, GL_COLOR_ATTACHMENT1);
+    unsigned int downsampleAttachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+    glDrawBuffers(2, downsampleAttachments);
+    // SSAO color buffer, and the blur's intermediate: the horizontal pass writes there, the vertical one back
+    unsigned int ssaoColorBuffer = createRenderTexture(ssaoFBO, GL_COLOR_ATTACHMENT0);
+    unsigned int ssaoColorBufferBlur = createRenderTexture(ssaoBlurFBO, GL_COLOR_ATTACHMENT0);
+    // two AO histories for the temporal accumulation, each frame reads one and writes the other
+    unsigned int historyFBO[2], historyTexture[2];
+    glGenFramebuffers(2, historyFBO);
+    for (unsigned int i = 0; i < 2; i++)
+        historyTexture[i] = createRenderTexture(historyFBO[i], GL_COLOR_ATTACHMENT0);
+    // and the AO back at full resolution
+    unsigned int ssaoUpsampled = createRenderTexture(upsampleFBO, GL_COLOR_ATTACHMENT0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, SCR_WIDTH, SCR_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Blur Framebuffer not complete!" << std::endl;
+        std::cout << "SSAO Upsample Framebuffer not complete!" << std::endl;
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    int appliedPreset = -1;
+    unsigned int aoWidth = SCR_WIDTH, aoHeight = SCR_HEIGHT;
+    // what the history needs to reproject itself
+    int historyIndex = 0;
+    bool historyValid = false;
+    glm::mat4 previousView = glm::mat4(1.0f);
+    glm::mat4 previousProjection = glm::mat4(1.0f);
+    unsigned int frameIndex = 0;
+
+    // the AO passes are timed without waiting on the GPU: last frame's result is read once it is ready
+    unsigned int ssaoQuery;
+    glGenQueries(1, &ssaoQuery);
+    bool queryPending = false;
+    float ssaoTimeMs = 0.0f;
+    unsigned int lastReport = 0;
 
-    // generate sample kernel
-    // ----------------------
     std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0); // generates random floats between 0.0 and 1.0
     std::default_random_engine generator;
-    std::vector<glm::vec3> ssaoKernel;
-    for (unsigned int i = 0; i < 64; ++i)
-    {
-        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
-        sample = glm::normalize(sample);
-        sample *= randomFloats(generator);
-        float scale = float(i) / 64.0f;
-
-        // scale samples s.t. they're more aligned to center of kernel
-        scale = ourLerp(0.1f, 1.0f, scale * scale);
-        sample *= scale;
-        ssaoKernel.push_back(sample);
-    }
 
     // generate noise texture
     // ----------------------
@@ -182,16 +205,28 @@ int main(int argc, char *argv[])
     // shader configuration
     // --------------------
     shaderLightingPass.use();
-    shaderLightingPass.setInt("gPosition", 0);
+    shaderLightingPass.setInt("gDepth", 0);
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("gAlbedo", 2);
     shaderLightingPass.setInt("ssao", 3);
+    shaderDownsample.use();
+    shaderDownsample.setInt("gDepth", 0);
+    shaderDownsample.setInt("gNormal", 1);
     shaderSSAO.use();
-    shaderSSAO.setInt("gPosition", 0);
+    shaderSSAO.setInt("viewDepth", 0);
     shaderSSAO.setInt("gNormal", 1);
     shaderSSAO.setInt("texNoise", 2);
     shaderSSAOBlur.use();
     shaderSSAOBlur.setInt("ssaoInput", 0);
+    shaderSSAOBlur.setInt("viewDepth", 1);
+    shaderUpsample.use();
+    shaderUpsample.setInt("ssaoInput", 0);
+    shaderUpsample.setInt("viewDepth", 1);
+    shaderUpsample.setInt("gDepth", 2);
+    shaderTemporal.use();
+    shaderTemporal.setInt("ssaoInput", 0);
+    shaderTemporal.setInt("viewDepth", 1);
+    shaderTemporal.setInt("history", 2);
 
     // render loop
     // -----------
@@ -207,6 +242,49 @@ int main(int argc, char *argv[])
         // -----
         processInput();
 
+        // size the AO targets and the sample kernel for the quality preset
+        // ------------------------------------------------------------------
+        if (appliedPreset != ssaoPreset)
+        {
+            const SSAOPreset &preset = ssaoPresets[ssaoPreset];
+            aoWidth = SCR_WIDTH / preset.scale;
+            aoHeight = SCR_HEIGHT / preset.scale;
+            glBindTexture(GL_TEXTURE_2D, aoDepth);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, aoWidth, aoHeight, 0, GL_RED, GL_FLOAT, NULL);
+            glBindTexture(GL_TEXTURE_2D, aoNormal);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16, aoWidth, aoHeight, 0, GL_RG, GL_UNSIGNED_SHORT, NULL);
+            glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, aoWidth, aoHeight, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+            glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, aoWidth, aoHeight, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+            // AO, linear depth and frame count: 16 bit float keeps the slow exponential blend from banding
+            for (unsigned int i = 0; i < 2; i++)
+            {
+                glBindTexture(GL_TEXTURE_2D, historyTexture[i]);
+                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, aoWidth, aoHeight, 0, GL_RGBA, GL_FLOAT, NULL);
+            }
+            historyValid = false;
+            unsigned int fbos[5] = { downsampleFBO, ssaoFBO, ssaoBlurFBO, historyFBO[0], historyFBO[1] };
+            for (unsigned int i = 0; i < 5; i++)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, fbos[i]);
+                if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                    std::cout << "SSAO Framebuffer not complete!" << std::endl;
+            }
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+            // the kernel only changes with the preset, so it is sent here instead of every frame
+            std::vector<glm::vec3> ssaoKernel = generateKernel(preset.kernelSize);
+            shaderSSAO.use();
+            for (unsigned int i = 0; i < preset.kernelSize; ++i)
+                shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+            shaderSSAO.setVec2("noiseScale", glm::vec2(aoWidth / 4.0f, aoHeight / 4.0f));
+            shaderDownsample.use();
+            shaderDownsample.setInt("scale", preset.scale);
+            appliedPreset = ssaoPreset;
+            std::cout << "SSAO: " << preset.name << " (" << aoWidth << "x" << aoHeight << ")" << std::endl;
+        }
+
         // render
         // ------
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
@@ -240,37 +318,145 @@ int main(int argc, char *argv[])
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 
-        // 2. generate SSAO texture
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(ssaoQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(ssaoQuery, GL_QUERY_RESULT, &elapsed);
+                ssaoTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
+        }
+        if (!queryPending)
+            glBeginQuery(GL_TIME_ELAPSED, ssaoQuery);
+        glViewport(0, 0, aoWidth, aoHeight);
+
+        // 2. downsample depth (linearized) and normals to the AO resolution
+        // -----------------------------------------------------------------
+        glBindFramebuffer(GL_FRAMEBUFFER, downsampleFBO);
+            shaderDownsample.use();
+            shaderDownsample.setMat4("projection", projection);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, gDepth);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, gNormal);
+            renderQuad();
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+
+        // 3. generate SSAO texture
         // ------------------------
         glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
             glClear(GL_COLOR_BUFFER_BIT);
             shaderSSAO.use();
-            // Send kernel + rotation
-            for (unsigned int i = 0; i < 64; ++i)
-                shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
             shaderSSAO.setMat4("projection", projection);
+            if (temporalSSAO)
+            {
+                shaderSSAO.setInt("kernelSize", ssaoPresets[ssaoPreset].kernelSize / TEMPORAL_KERNEL_STRIDE);
+                shaderSSAO.setInt("kernelStride", TEMPORAL_KERNEL_STRIDE);
+                shaderSSAO.setInt("kernelOffset", frameIndex % TEMPORAL_KERNEL_STRIDE);
+                shaderSSAO.setFloat("kernelRotation", (frameIndex % 1024) * GOLDEN_ANGLE);
+            }
+            else
+            {
+                shaderSSAO.setInt("kernelSize", ssaoPresets[ssaoPreset].kernelSize);
+                shaderSSAO.setInt("kernelStride", 1);
+                shaderSSAO.setInt("kernelOffset", 0);
+                shaderSSAO.setFloat("kernelRotation", 0.0f);
+            }
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, gPosition);
+            glBindTexture(GL_TEXTURE_2D, aoDepth);
             glActiveTexture(GL_TEXTURE1);
-            glBindTexture(GL_TEXTURE_2D, gNormal);
+            glBindTexture(GL_TEXTURE_2D, aoNormal);
             glActiveTexture(GL_TEXTURE2);
             glBindTexture(GL_TEXTURE_2D, noiseTexture);
             renderQuad();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
 
-        // 3. blur SSAO texture to remove noise
-        // ------------------------------------
+        // 4. temporal accumulation: blend this frame's AO into the history reprojected with last frame's camera,
+        //    dropping the history wherever its depth shows a different surface was there
+        // ---------------------------------------------------------------------------------------------------------
+        unsigned int ssaoBlurInput = ssaoColorBuffer;
+        if (temporalSSAO)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, historyFBO[historyIndex]);
+                shaderTemporal.use();
+                shaderTemporal.setMat4("projection", projection);
+                shaderTemporal.setMat4("previousProjection", previousProjection);
+                shaderTemporal.setMat4("currentToPreviousView", previousView * glm::inverse(view));
+                shaderTemporal.setInt("historyValid", historyValid);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, aoDepth);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, historyTexture[1 - historyIndex]);
+                renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            ssaoBlurInput = historyTexture[historyIndex];
+            historyIndex = 1 - historyIndex;
+            historyValid = true;
+        }
+        else
+            historyValid = false;
+        previousView = view;
+        previousProjection = projection;
+        frameIndex++;
+
+
+        // 5. blur SSAO texture to remove noise, separably, without blurring across depth edges
+        // -------------------------------------------------------------------------------------
+        shaderSSAOBlur.use();
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, aoDepth);
         glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderSSAOBlur.use();
+            shaderSSAOBlur.setVec2("direction", glm::vec2(1.0f, 0.0f));
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+            glBindTexture(GL_TEXTURE_2D, ssaoBlurInput);
+            renderQuad();
+        glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+            shaderSSAOBlur.setVec2("direction", glm::vec2(0.0f, 1.0f));
+            glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
             renderQuad();
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
 
 
-        // 4. lighting pass: traditional deferred Blinn-Phong lighting with added screen-space ambient occlusion
+        // 6. upsample the AO to full resolution, weighting the low resolution texels by how well their depth matches
+        // ------------------------------------------------------------------------------------------------------------
+        unsigned int ssaoResult = ssaoColorBuffer;
+        if (ssaoPresets[ssaoPreset].scale > 1)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, upsampleFBO);
+                shaderUpsample.use();
+                shaderUpsample.setMat4("projection", projection);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, aoDepth);
+                glActiveTexture(GL_TEXTURE2);
+                glBindTexture(GL_TEXTURE_2D, gDepth);
+                renderQuad();
+            glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            ssaoResult = ssaoUpsampled;
+        }
+        if (!queryPending)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "SSAO " << ssaoPresets[ssaoPreset].name << (temporalSSAO ? ", temporal" : "") << ": " << ssaoTimeMs << " ms" << std::endl;
+        }
+
+
+        // 7. lighting pass: traditional deferred Blinn-Phong lighting with added screen-space ambient occlusion
         // -----------------------------------------------------------------------------------------------------
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         shaderLightingPass.use();
@@ -283,14 +469,15 @@ int main(int argc, char *argv[])
         const float quadratic = 0.032f;
         shaderLightingPass.setFloat("light.Linear", linear);
         shaderLightingPass.setFloat("light.Quadratic", quadratic);
+        shaderLightingPass.setMat4("inverseProjection", glm::inverse(projection));
         glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gPosition);
+        glBindTexture(GL_TEXTURE_2D, gDepth);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_2D, gNormal);
         glActiveTexture(GL_TEXTURE2);
         glBindTexture(GL_TEXTURE_2D, gAlbedo);
         glActiveTexture(GL_TEXTURE3); // add extra SSAO texture to lighting pass
-        glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
+        glBindTexture(GL_TEXTURE_2D, ssaoResult);
         renderQuad();
 
         SDL_GL_SwapBuffers();
@@ -358,6 +545,23 @@ void processInput(void)
     if(keys[SDLK_ESCAPE])
         main_loop = 0;
 
+    if (keys[SDLK_q] && !preset_changed)
+    {
+        ssaoPreset = (ssaoPreset + 1) % SSAO_PRESET_COUNT;
+        preset_changed = 1;
+    }
+    else if (!keys[SDLK_q])
+        preset_changed = 0;
+
+    if (keys[SDLK_t] && !temporal_changed)
+    {
+        temporalSSAO = !temporalSSAO;
+        std::cout << "SSAO temporal accumulation " << (temporalSSAO ? "on" : "off") << std::endl;
+        temporal_changed = 1;
+    }
+    else if (!keys[SDLK_t])
+        temporal_changed = 0;
+
     if(keys[SDLK_w])
         camera.ProcessKeyboard(FORWARD, deltaTime);
     else if(keys[SDLK_a])
@@ -392,6 +596,45 @@ void sleep(void)
     }
 }
 
+// generates kernelSize sample positions in the tangent space hemisphere, denser near its center
+// ---------------------------------------------------------------------------------------------
+std::vector<glm::vec3> generateKernel(unsigned int kernelSize)
+{
+    std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0); // generates random floats between 0.0 and 1.0
+    std::default_random_engine generator;
+    std::vector<glm::vec3> ssaoKernel;
+    for (unsigned int i = 0; i < kernelSize; ++i)
+    {
+        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
+        sample = glm::normalize(sample);
+        sample *= randomFloats(generator);
+        float scale = float(i) / float(kernelSize);
+
+        // scale samples s.t. they're more aligned to center of kernel
+        scale = ourLerp(0.1f, 1.0f, scale * scale);
+        sample *= scale;
+        ssaoKernel.push_back(sample);
+    }
+    return ssaoKernel;
+}
+
+// creates a nearest-filtered, edge-clamped texture and attaches it to fbo, which stays bound;
+// its storage is allocated by the caller
+// ------------------------------------------------------------------------------------------
+unsigned int createRenderTexture(unsigned int fbo, GLenum attachment)
+{
+    unsigned int texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, texture, 0);
+    return texture;
+}
+
 // utility function for loading a 2D texture from file
 // ---------------------------------------------------
 unsigned int loadTexture(char const * path, bool gammaCorrection)
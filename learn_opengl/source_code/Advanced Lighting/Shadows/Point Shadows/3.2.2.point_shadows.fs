@@ -16,6 +16,12 @@ uniform vec3 viewPos;
 uniform float far_plane;
 uniform bool shadows;
 
+// exponential variance shadow maps: one filtered fetch of warped depth moments instead of the 20 taps
+uniform bool evsm;
+uniform samplerCube momentMap; // mipmapped
+uniform vec2 evsmExponents;     // positive, negative
+uniform float lightBleedingReduction;
+
 
 // array of offset direction for sampling
 vec3 gridSamplingDisk[20] = vec3[]
@@ -27,6 +33,31 @@ vec3 gridSamplingDisk[20] = vec3[]
    vec3(0, 1,  1), vec3( 0, -1,  1), vec3( 0, -1, -1), vec3( 0, 1, -1)
 );
 
+// Chebyshev's upper bound on the fraction of the filtered region at least as far as depth, with the lowest
+// lightBleedingReduction of it cut off
+float Chebyshev(vec2 moments, float depth, float minVariance)
+{
+    if (depth <= moments.x)
+        return 1.0;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - lightBleedingReduction) / (1.0 - lightBleedingReduction), 0.0, 1.0);
+}
+
+// how lit a fragment at depth (distance / far_plane) is, from both warps of the moments; the smaller bound bleeds less
+float EVSMVisibility(vec4 moments, float depth)
+{
+    depth = 2.0 * depth - 1.0;
+    float positive = exp(evsmExponents.x * depth);
+    float negative = -exp(-evsmExponents.y * depth);
+    // the warps stretch depth by their slope, so does the variance floor
+    vec2 depthScale = 0.0001 * evsmExponents * vec2(positive, -negative);
+    float positiveLit = Chebyshev(moments.xy, positive, depthScale.x * depthScale.x);
+    float negativeLit = Chebyshev(moments.zw, negative, depthScale.y * depthScale.y);
+    return min(positiveLit, negativeLit);
+}
+
 float ShadowCalculation(vec3 fragPos)
 {
     // get vector between fragment position and light position
@@ -59,8 +90,14 @@ float ShadowCalculation(vec3 fragPos)
         // }
     // }
     // shadow /= (samples * samples * samples);
-    float shadow = 0.0;
     float bias = 0.15;
+    if (evsm)
+    {
+        // one trilinear, anisotropic fetch across seamless cube map faces
+        vec4 moments = texture(momentMap, fragToLight);
+        return 1.0 - EVSMVisibility(moments, (currentDepth - bias) / far_plane);
+    }
+    float shadow = 0.0;
     int samples = 20;
     float viewDistance = length(viewPos - fragPos);
     float diskRadius = (1.0 + (viewDistance / far_plane)) / 25.0;
@@ -0,0 +1,99 @@
+#version 330 core
+out vec4 FragColor;
+
+in VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+} fs_in;
+
+// std140: AtlasLight and ShadowView in main_shadow_atlas.cpp
+struct Light {
+    vec4 Position;  // w: radius
+    vec4 Color;     // w: 0 for a point light, 1 for a spot light
+    vec4 Direction; // spot light, w: cosine of the outer cone angle
+    vec4 Shadow;    // x: first shadow view, y: spot light's cosine of the inner cone angle
+};
+struct ShadowView {
+    mat4 LightSpace;
+    vec4 Rect;      // tile in the atlas, in texture coordinates; empty while the view has none
+};
+const int NR_LIGHTS = 32;
+const int NR_SHADOW_VIEWS = 152; // 24 point lights x 6 faces + 8 spot lights
+layout (std140) uniform Lights
+{
+    Light lights[NR_LIGHTS];
+};
+layout (std140) uniform ShadowViews
+{
+    ShadowView views[NR_SHADOW_VIEWS];
+};
+
+uniform sampler2D diffuseTexture;
+uniform sampler2DShadow shadowAtlas;
+uniform vec3 viewPos;
+uniform bool shadows;
+
+// 1.0 lit, 0.0 in shadow; the hardware comparison filters 2x2 texels
+float ShadowCalculation(Light light, vec3 normal, vec3 lightDir)
+{
+    vec3 fromLight = fs_in.FragPos - light.Position.xyz;
+    int view = int(light.Shadow.x);
+    if (light.Color.w == 0.0)
+    {
+        // point light: the cube face the fragment is seen through, in the order +X, -X, +Y, -Y, +Z, -Z
+        vec3 axis = abs(fromLight);
+        if (axis.x >= axis.y && axis.x >= axis.z)
+            view += fromLight.x > 0.0 ? 0 : 1;
+        else if (axis.y >= axis.z)
+            view += fromLight.y > 0.0 ? 2 : 3;
+        else
+            view += fromLight.z > 0.0 ? 4 : 5;
+    }
+    vec4 rect = views[view].Rect;
+    if (rect.z == 0.0)
+        return 1.0; // the atlas had no room for it this frame
+    vec4 clip = views[view].LightSpace * vec4(fs_in.FragPos, 1.0);
+    vec2 tileCoords = clip.xy / clip.w * 0.5 + 0.5;
+    // stay half a texel inside the tile, so the filter doesn't reach into the next one
+    float tileTexels = rect.z * float(textureSize(shadowAtlas, 0).x);
+    tileCoords = clamp(tileCoords, 0.5 / tileTexels, 1.0 - 0.5 / tileTexels);
+    // a texel covers more of the surface the farther away and the more slanted it is
+    float lightDistance = length(fromLight);
+    float texelSize = 2.0 * lightDistance / tileTexels;
+    float bias = texelSize * (1.0 + 2.0 * (1.0 - max(dot(normal, lightDir), 0.0)));
+    return texture(shadowAtlas, vec3(rect.xy + tileCoords * rect.zw, (lightDistance - bias) / light.Position.w));
+}
+
+void main()
+{
+    vec3 normal = normalize(fs_in.Normal);
+    // the floor and the pillars are stretched cubes: map the texture in world space instead
+    vec2 texCoords = abs(normal.y) > 0.5 ? fs_in.FragPos.xz : (abs(normal.x) > 0.5 ? fs_in.FragPos.zy : fs_in.FragPos.xy);
+    vec3 color = texture(diffuseTexture, texCoords * 0.5).rgb;
+    vec3 viewDir = normalize(viewPos - fs_in.FragPos);
+    vec3 lighting = 0.05 * color; // ambient
+    for (int i = 0; i < NR_LIGHTS; ++i)
+    {
+        vec3 toLight = lights[i].Position.xyz - fs_in.FragPos;
+        float lightDistance = length(toLight);
+        float radius = lights[i].Position.w;
+        if (lightDistance >= radius)
+            continue;
+        vec3 lightDir = toLight / lightDistance;
+        // falls to zero at the radius, so a light whose sphere is out of view lights nothing in view
+        float window = clamp(1.0 - pow(lightDistance / radius, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (1.0 + 0.25 * lightDistance * lightDistance);
+        if (lights[i].Color.w == 1.0)
+            attenuation *= smoothstep(lights[i].Direction.w, lights[i].Shadow.y, dot(-lightDir, lights[i].Direction.xyz));
+        if (attenuation <= 0.0)
+            continue;
+        // diffuse
+        float diff = max(dot(normal, lightDir), 0.0);
+        // specular
+        vec3 halfwayDir = normalize(lightDir + viewDir);
+        float spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
+        float shadow = shadows ? ShadowCalculation(lights[i], normal, lightDir) : 1.0;
+        lighting += shadow * attenuation * lights[i].Color.rgb * (diff * color + 0.3 * spec);
+    }
+    FragColor = vec4(lighting, 1.0);
+}
\ No newline at end of file
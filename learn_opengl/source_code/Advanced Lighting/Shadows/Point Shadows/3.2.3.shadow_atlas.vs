@@ -0,0 +1,19 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+layout (location = 3) in mat4 aInstanceMatrix;
+
+out VS_OUT {
+    vec3 FragPos;
+    vec3 Normal;
+} vs_out;
+
+uniform mat4 projection;
+uniform mat4 view;
+
+void main()
+{
+    vs_out.FragPos = vec3(aInstanceMatrix * vec4(aPos, 1.0));
+    vs_out.Normal = transpose(inverse(mat3(aInstanceMatrix))) * aNormal;
+    gl_Position = projection * view * vec4(vs_out.FragPos, 1.0);
+}
\ No newline at end of file
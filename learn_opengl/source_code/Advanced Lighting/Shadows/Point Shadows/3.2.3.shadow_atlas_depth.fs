@@ -0,0 +1,11 @@
+#version 330 core
+in vec3 FragPos;
+
+uniform vec3 lightPos;
+uniform float far_plane; // the light's radius
+
+void main()
+{
+    // distance to the light, mapped to [0;1] like the depth cubemap's, for spot lights and cube faces alike
+    gl_FragDepth = length(FragPos - lightPos) / far_plane;
+}
\ No newline at end of file
@@ -0,0 +1,13 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 3) in mat4 aInstanceMatrix;
+
+uniform mat4 lightSpaceMatrix; // the shadow view of the tile being rendered
+
+out vec3 FragPos;
+
+void main()
+{
+    FragPos = vec3(aInstanceMatrix * vec4(aPos, 1.0));
+    gl_Position = lightSpaceMatrix * vec4(FragPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,91 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform samplerCube depthMap; // nearest filtering, so a fetch at a texel's center reads that texel
+uniform int layer;            // the cube map face, in GL_TEXTURE_CUBE_MAP_POSITIVE_X order
+uniform int downsample;       // depth texels per moment texel, along each axis
+uniform int blurRadius;       // moment texels on each side
+uniform vec2 exponents;       // positive, negative
+uniform bool vertical;        // false: warp and blur along x, true: blur that along y
+uniform sampler2D image;      // the vertical pass: the face's moments blurred along x
+
+// both exponentially warped depths and their squares
+vec4 WarpDepth(float depth)
+{
+    depth = 2.0 * depth - 1.0;
+    float positive = exp(exponents.x * depth);
+    float negative = -exp(-exponents.y * depth);
+    return vec4(positive, positive * positive, negative, negative * negative);
+}
+
+// the direction through the face's point at uv, in [-1, 1]; past the face's edges it runs on into the next one
+vec3 FaceDirection(vec2 uv)
+{
+    if (layer == 0) return vec3( 1.0, -uv.y, -uv.x);
+    if (layer == 1) return vec3(-1.0, -uv.y,  uv.x);
+    if (layer == 2) return vec3( uv.x,  1.0,  uv.y);
+    if (layer == 3) return vec3( uv.x, -1.0, -uv.y);
+    if (layer == 4) return vec3( uv.x, -uv.y,  1.0);
+    return vec3(-uv.x, -uv.y, -1.0);
+}
+
+// the moments of one moment texel: the average of its downsample x downsample depth texels
+vec4 Moments(ivec2 texel)
+{
+    float depthSize = float(textureSize(depthMap, 0).x);
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < downsample; ++y)
+    {
+        for (int x = 0; x < downsample; ++x)
+        {
+            vec2 uv = (vec2(texel * downsample + ivec2(x, y)) + 0.5) / depthSize * 2.0 - 1.0;
+            sum += WarpDepth(texture(depthMap, FaceDirection(uv)).r);
+        }
+    }
+    return sum / float(downsample * downsample);
+}
+
+float Weight(int offset)
+{
+    float sigma = max(float(blurRadius), 1.0) * 0.5;
+    return exp(-float(offset * offset) / (2.0 * sigma * sigma));
+}
+
+// the moments around texel blurred along x, reading over the face's edges into the neighbouring faces
+vec4 BlurX(ivec2 texel)
+{
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int x = -blurRadius; x <= blurRadius; ++x)
+    {
+        sum += Weight(x) * Moments(ivec2(texel.x + x, texel.y));
+        weightSum += Weight(x);
+    }
+    return sum / weightSum;
+}
+
+// warps the face's depth and blurs it horizontally, then, in a second pass, vertically. Rows past the face's top
+// and bottom edges aren't in image, so they are blurred along x here, from the neighbouring faces' depth; the
+// Gaussian then runs on into those faces along both axes and the faces' edges don't show
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    if (!vertical)
+    {
+        FragColor = BlurX(texel);
+        return;
+    }
+    int lastRow = textureSize(image, 0).y - 1;
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int y = -blurRadius; y <= blurRadius; ++y)
+    {
+        ivec2 tap = ivec2(texel.x, texel.y + y);
+        if (tap.y >= 0 && tap.y <= lastRow)
+            sum += Weight(y) * texelFetch(image, tap, 0);
+        else
+            sum += Weight(y) * BlurX(tap);
+        weightSum += Weight(y);
+    }
+    FragColor = sum / weightSum;
+}
\ No newline at end of file
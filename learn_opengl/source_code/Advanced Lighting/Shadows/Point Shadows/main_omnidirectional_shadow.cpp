@@ -9,6 +9,7 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "shadow_cache.h"
 
 #include <iostream>
 
@@ -16,6 +17,8 @@ void processInput(void);
 void sleep(void);
 unsigned int loadTexture(const char *path);
 void renderScene(const Shader &shader);
+void renderStaticScene(const Shader &shader);
+void renderDynamicScene(const Shader &shader);
 void renderCube();
 
 // settings
@@ -25,6 +28,17 @@ bool shadows = true;
 bool shadowsKeyPressed = false;
 float timer = 0.01;
 
+// shadow caching: the room and all cubes but one are static casters, rendered into a cached cube map only when the
+// light moves; the spinning cube is the dynamic one, rendered every frame over the faces it reaches. L stops the
+// light, M stops the cube, and with both still the shadow pass does nothing
+const glm::vec3 spinningCubePosition(-1.5f, 2.0f, -3.0f);
+const float spinningCubeScale = 0.75f;
+float spinningCubeAngle = 60.0f;
+bool moveLight = true;
+bool moveLightKeyPressed = false;
+bool spinCube = true;
+bool spinCubeKeyPressed = false;
+
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
@@ -52,6 +66,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
 
     // configure global opengl state
     // -----------------------------
@@ -77,7 +92,7 @@ int main(int argc, char *argv[])
     glGenTextures(1, &depthCubemap);
     glBindTexture(GL_TEXTURE_CUBE_MAP, depthCubemap);
     for (unsigned int i = 0; i < 6; ++i)
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_DEPTH_COMPONENT24, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -89,7 +104,16 @@ int main(int argc, char *argv[])
     glDrawBuffer(GL_NONE);
     glReadBuffer(GL_NONE);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // the static casters' depth, copied into depthCubemap face by face
+    ShadowCache shadowCache(GL_TEXTURE_CUBE_MAP, depthCubemap, depthMapFBO, SHADOW_WIDTH, 6);
+    unsigned int previousCubeFaces = 0;
 
+    // the shadow pass is timed without waiting on the GPU: the query's result is read once it is ready
+    unsigned int shadowQuery;
+    glGenQueries(1, &shadowQuery);
+    bool queryPending = false;
+    float shadowTimeMs = 0.0f;
+    unsigned int lastReport = 0;
 
     // shader configuration
     // --------------------
@@ -116,7 +140,13 @@ int main(int argc, char *argv[])
         processInput();
 
         // move light position over time
-        lightPos.z = static_cast<float>(sin((timer+=0.1) * 0.5) * 3.0);
+        if (moveLight)
+        {
+            lightPos.z = static_cast<float>(sin((timer+=0.1) * 0.5) * 3.0);
+            shadowCache.Invalidate(); // every face sees the static casters from somewhere else
+        }
+        if (spinCube)
+            spinningCubeAngle += deltaTime * 0.05f;
 
         // render
         // ------
@@ -126,7 +156,7 @@ int main(int argc, char *argv[])
         // 0. create depth cubemap transformation matrices
         // -----------------------------------------------
         float near_plane = 1.0f;
-        float far_plane  = 25.0f;
+        float far_plane = 25.0f;
         glm::mat4 shadowProj = glm::perspective(glm::radians(90.0f), (float)SHADOW_WIDTH / (float)SHADOW_HEIGHT, near_plane, far_plane);
         std::vector<glm::mat4> shadowTransforms;
         shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
@@ -136,18 +166,61 @@ int main(int argc, char *argv[])
         shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
         shadowTransforms.push_back(shadowProj * glm::lookAt(lightPos, lightPos + glm::vec3( 0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f)));
 
-        // 1. render scene to depth cubemap
-        // --------------------------------
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            simpleDepthShader.use();
-            for (unsigned int i = 0; i < 6; ++i)
-                simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
-            simpleDepthShader.setFloat("far_plane", far_plane);
-            simpleDepthShader.setVec3("lightPos", lightPos);
-            renderScene(simpleDepthShader);
+        // the faces the spinning cube's bounding sphere reaches; while it spins those change, and so do the
+        // ones it just left
+        unsigned int cubeFaces = ShadowCache::LayersTouching(&shadowTransforms[0], 6, spinningCubePosition, spinningCubeScale * 1.7320508f);
+        unsigned int movedFaces = spinCube ? cubeFaces | previousCubeFaces : 0;
+        previousCubeFaces = cubeFaces;
+
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(shadowQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(shadowQuery, GL_QUERY_RESULT, &elapsed);
+                shadowTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
+        }
+        bool timing = !queryPending;
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, shadowQuery);
+
+        // 1. render the static casters into the stale faces of the cached cubemap, then copy the faces that changed
+        //    into the depth cubemap and render the dynamic casters over them. The geometry shader skips the other faces
+        // -------------------------------------------------------------------------------------------------------------
+        simpleDepthShader.use();
+        for (unsigned int i = 0; i < 6; ++i)
+            simpleDepthShader.setMat4("shadowMatrices[" + std::to_string(i) + "]", shadowTransforms[i]);
+        simpleDepthShader.setFloat("far_plane", far_plane);
+        simpleDepthShader.setVec3("lightPos", lightPos);
+        unsigned int faces = shadowCache.BeginStatic();
+        if (faces)
+        {
+            simpleDepthShader.setInt("layerMask", faces);
+            renderStaticScene(simpleDepthShader);
+        }
+        faces = shadowCache.BeginDynamic(movedFaces);
+        if (faces)
+        {
+            simpleDepthShader.setInt("layerMask", faces);
+            renderDynamicScene(simpleDepthShader);
+        }
         glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "shadow pass " << shadowTimeMs << " ms: static faces " << shadowCache.staticLayersDrawn << ", copied "
+                      << shadowCache.layersCopied << ", dynamic " << shadowCache.dynamicLayersDrawn << std::endl;
+        }
 
         // 2. render scene as normal
         // -------------------------
@@ -261,6 +334,26 @@ void processInput(void)
     {
         shadowsKeyPressed = false;
     }
+
+    if (keys[SDLK_l] && !moveLightKeyPressed)
+    {
+        moveLight = !moveLight;
+        moveLightKeyPressed = true;
+    }
+    if (!keys[SDLK_l])
+    {
+        moveLightKeyPressed = false;
+    }
+
+    if (keys[SDLK_m] && !spinCubeKeyPressed)
+    {
+        spinCube = !spinCube;
+        spinCubeKeyPressed = true;
+    }
+    if (!keys[SDLK_m])
+    {
+        spinCubeKeyPressed = false;
+    }
 }
 
 void sleep(void)
@@ -320,6 +413,14 @@ unsigned int loadTexture(char const * path)
 // renders the 3D scene
 // --------------------
 void renderScene(const Shader &shader)
+{
+    renderStaticScene(shader);
+    renderDynamicScene(shader);
+}
+
+// the casters that never move: their shadows are cached
+// -------------------------------------------------------
+void renderStaticScene(const Shader &shader)
 {
     // room cube
     glm::mat4 model = glm::mat4(1.0f);
@@ -351,10 +452,16 @@ void renderScene(const Shader &shader)
     model = glm::scale(model, glm::vec3(0.5f));
     shader.setMat4("model", model);
     renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.5f, 2.0f, -3.0));
-    model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-    model = glm::scale(model, glm::vec3(0.75f));
+}
+
+// the spinning cube, rendered into the shadow map every frame it or the light moves
+// ---------------------------------------------------------------------------------
+void renderDynamicScene(const Shader &shader)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, spinningCubePosition);
+    model = glm::rotate(model, glm::radians(spinningCubeAngle), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
+    model = glm::scale(model, glm::vec3(spinningCubeScale));
     shader.setMat4("model", model);
     renderCube();
 }
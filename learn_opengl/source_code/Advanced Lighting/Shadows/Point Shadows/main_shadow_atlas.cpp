@@ -0,0 +1,637 @@
+#include <SDL/SDL.h>
+#include "glad.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include "shader.h"
+#include "camera.h"
+#include "model.h"
+#include "filesystem.h"
+#include "uniform_buffer.h"
+#include "shadow_atlas.h"
+
+#include <iostream>
+#include <algorithm>
+
+void processInput(void);
+void sleep(void);
+unsigned int loadTexture(const char *path);
+bool sphereInFrustum(const glm::mat4 &viewProjection, const glm::vec3 &center, float radius);
+void createScene(const std::vector<glm::mat4> &instanceMatrices);
+void renderScene();
+
+// settings
+const unsigned int SCR_WIDTH = 640;
+const unsigned int SCR_HEIGHT = 480;
+bool shadows = true;
+bool shadowsKeyPressed = false;
+
+// lights: NR_POINT_LIGHTS point lights with six shadow views each, then NR_SPOT_LIGHTS spot lights with one (the
+// counts must match 3.2.3.shadow_atlas.fs). Every view gets its tile in one SHADOW_ATLAS_SIZE shadow atlas, 16 MB,
+// where a 1024x1024 map per view would take 608 MB. M stops the lights that move
+const unsigned int NR_POINT_LIGHTS = 24;
+const unsigned int NR_SPOT_LIGHTS = 8;
+const unsigned int NR_LIGHTS = NR_POINT_LIGHTS + NR_SPOT_LIGHTS;
+const unsigned int NR_SHADOW_VIEWS = NR_POINT_LIGHTS * 6 + NR_SPOT_LIGHTS;
+const int SHADOW_ATLAS_SIZE = 2048;
+const int SHADOW_MIN_TILE = 64;
+const int SHADOW_MAX_TILE = 512;
+const float SPOT_INNER_ANGLE = glm::radians(25.0f);
+const float SPOT_OUTER_ANGLE = glm::radians(30.0f);
+bool moveLights = true;
+bool moveLightsKeyPressed = false;
+
+// camera
+Camera camera(glm::vec3(0.0f, 8.0f, 20.0f), glm::vec3(0.0f, 1.0f, 0.0f), -90.0f, -25.0f);
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+// timing
+float deltaTime = 0.0f;	// time between current frame and last frame
+float lastFrame = 0.0f;
+
+// one element of the std140 Lights block in 3.2.3.shadow_atlas.fs
+struct AtlasLight {
+    glm::vec4 Position;  // w: radius
+    glm::vec4 Color;     // w: 0 for a point light, 1 for a spot light
+    glm::vec4 Direction; // spot light, w: cosine of the outer cone angle
+    glm::vec4 Shadow;    // x: first shadow view, y: spot light's cosine of the inner cone angle
+};
+
+// one element of the std140 ShadowViews block: a spot light, or a face of a point light
+struct ShadowView {
+    glm::mat4 LightSpace;
+    glm::vec4 Rect; // tile in the atlas, in texture coordinates; all zero while the view has none
+};
+
+// a light as the sample animates it
+struct SceneLight {
+    glm::vec3 anchor;     // point lights circle it, spot lights hang from it
+    glm::vec3 position;
+    glm::vec3 direction;  // spot lights
+    glm::vec3 color;
+    float radius;
+    float phase;
+    bool spot;
+    bool moving;
+    unsigned int version; // bumped whenever the light moves, so its tiles get rendered again
+};
+
+// a tile to render this frame
+struct StaleTile {
+    ShadowTile tile;
+    glm::mat4 lightSpace;
+    unsigned int light;
+};
+
+// the first of the light's views in the ShadowViews block
+unsigned int firstShadowView(unsigned int light)
+{
+    return light < NR_POINT_LIGHTS ? light * 6 : NR_POINT_LIGHTS * 6 + (light - NR_POINT_LIGHTS);
+}
+
+// a spot light's frustum around its cone, or one face of a point light's cube, in the order +X, -X, +Y, -Y, +Z, -Z
+glm::mat4 shadowViewMatrix(const SceneLight &light, unsigned int face)
+{
+    if (light.spot)
+    {
+        glm::vec3 up = std::abs(light.direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+        return glm::perspective(2.0f * SPOT_OUTER_ANGLE, 1.0f, 0.1f, light.radius) * glm::lookAt(light.position, light.position + light.direction, up);
+    }
+    static const glm::vec3 directions[6] = { glm::vec3( 1.0f,  0.0f,  0.0f), glm::vec3(-1.0f,  0.0f,  0.0f), glm::vec3( 0.0f,  1.0f,  0.0f),
+                                             glm::vec3( 0.0f, -1.0f,  0.0f), glm::vec3( 0.0f,  0.0f,  1.0f), glm::vec3( 0.0f,  0.0f, -1.0f) };
+    static const glm::vec3 ups[6] = { glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f,  0.0f,  1.0f),
+                                      glm::vec3(0.0f,  0.0f, -1.0f), glm::vec3(0.0f, -1.0f,  0.0f), glm::vec3(0.0f, -1.0f,  0.0f) };
+    return glm::perspective(glm::radians(90.0f), 1.0f, 0.05f, light.radius) * glm::lookAt(light.position, light.position + directions[face], ups[face]);
+}
+
+bool main_loop = true;
+SDL_Event event;
+Uint8* keys;
+
+int main(int argc, char *argv[])
+{
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_WM_SetCaption("LearnOpenGL",NULL);
+    SDL_SetVideoMode(640, 480, 32, SDL_OPENGL);//|SDL_RESIZABLE);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+
+    // configure global opengl state
+    // -----------------------------
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_CULL_FACE);
+
+    // build and compile shaders
+    // -------------------------
+    Shader shader("3.2.3.shadow_atlas.vs", "3.2.3.shadow_atlas.fs");
+    Shader depthShader("3.2.3.shadow_atlas_depth.vs", "3.2.3.shadow_atlas_depth.fs");
+
+    // load textures
+    // -------------
+    unsigned int woodTexture = loadTexture(FileSystem::getPath("wood.png").c_str());
+
+    // the scene: a floor and a grid of pillars, all instances of one cube, drawn in a single call per pass
+    // ------------------------------------------------------------------------------------------------------
+    std::vector<glm::mat4> instanceMatrices;
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0f, -0.25f, 0.0f));
+    model = glm::scale(model, glm::vec3(20.0f, 0.25f, 20.0f));
+    instanceMatrices.push_back(model);
+    for (int x = 0; x < 6; x++)
+    {
+        for (int z = 0; z < 6; z++)
+        {
+            float height = 1.0f + ((x * 7 + z * 3) % 5) * 0.5f;
+            model = glm::mat4(1.0f);
+            model = glm::translate(model, glm::vec3(-12.5f + x * 5.0f, height, -12.5f + z * 5.0f));
+            model = glm::scale(model, glm::vec3(0.5f, height, 0.5f));
+            instanceMatrices.push_back(model);
+        }
+    }
+    createScene(instanceMatrices);
+
+    // lighting info: point lights low between the pillars, spot lights high above them; one in four moves
+    // -----------------------------------------------------------------------------------------------------
+    std::vector<SceneLight> sceneLights(NR_LIGHTS);
+    srand(13);
+    for (unsigned int i = 0; i < NR_LIGHTS; i++)
+    {
+        SceneLight &light = sceneLights[i];
+        light.spot = i >= NR_POINT_LIGHTS;
+        light.moving = i % 4 == 0;
+        light.phase = (rand() % 628) / 100.0f;
+        light.color = glm::vec3(((rand() % 100) / 200.0f) + 0.5f, ((rand() % 100) / 200.0f) + 0.5f, ((rand() % 100) / 200.0f) + 0.5f);
+        float x = ((rand() % 5) - 2) * 5.0f + ((rand() % 100) / 100.0f - 0.5f);
+        float z = ((rand() % 5) - 2) * 5.0f + ((rand() % 100) / 100.0f - 0.5f);
+        if (light.spot)
+        {
+            light.anchor = glm::vec3(x, 7.0f, z);
+            light.radius = 14.0f;
+            light.color *= 3.0f;
+        }
+        else
+        {
+            light.anchor = glm::vec3(x, 1.0f + (rand() % 100) / 100.0f, z);
+            light.radius = 6.0f;
+        }
+        light.position = light.anchor;
+        light.direction = glm::normalize(glm::vec3(0.5f * std::sin(light.phase), -1.0f, 0.5f * std::cos(light.phase)));
+        light.version = 0;
+    }
+
+    // the shadow atlas, and the light and shadow view blocks the lighting shader reads
+    // ----------------------------------------------------------------------------------
+    ShadowAtlas atlas(SHADOW_ATLAS_SIZE, SHADOW_MIN_TILE, SHADOW_MAX_TILE);
+    UniformArrayBuffer<AtlasLight> lights(NR_LIGHTS);
+    UniformArrayBuffer<ShadowView> shadowViews(NR_SHADOW_VIEWS);
+    UniformArrayBuffer<AtlasLight>::BindBlock(shader.ID, "Lights", 0);
+    UniformArrayBuffer<ShadowView>::BindBlock(shader.ID, "ShadowViews", 1);
+    std::vector<StaleTile> staleTiles;
+    std::vector<float> coverage(NR_LIGHTS);
+    std::vector<unsigned int> lightOrder(NR_LIGHTS);
+    float lightTime = 0.0f;
+
+    // the shadow pass is timed without waiting on the GPU: the query's result is read once it is ready
+    unsigned int shadowQuery;
+    glGenQueries(1, &shadowQuery);
+    bool queryPending = false;
+    float shadowTimeMs = 0.0f;
+    unsigned int lastReport = 0;
+
+    // shader configuration
+    // --------------------
+    shader.use();
+    shader.setInt("diffuseTexture", 0);
+    shader.setInt("shadowAtlas", 1);
+
+    // render loop
+    // -----------
+    while (main_loop)
+    {
+        // per-frame time logic
+        // --------------------
+        float currentFrame = static_cast<float>(SDL_GetTicks());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        // input
+        // -----
+        processInput();
+
+        // move the moving lights: point lights circle their anchor, spot lights sweep their cone around
+        if (moveLights)
+        {
+            lightTime += deltaTime * 0.001f;
+            for (unsigned int i = 0; i < NR_LIGHTS; i++)
+            {
+                SceneLight &light = sceneLights[i];
+                if (!light.moving)
+                    continue;
+                float angle = lightTime + light.phase;
+                if (light.spot)
+                    light.direction = glm::normalize(glm::vec3(0.5f * std::sin(angle), -1.0f, 0.5f * std::cos(angle)));
+                else
+                    light.position = light.anchor + glm::vec3(std::sin(angle), 0.0f, std::cos(angle));
+                light.version++;
+            }
+        }
+        for (unsigned int i = 0; i < NR_LIGHTS; i++)
+        {
+            const SceneLight &light = sceneLights[i];
+            AtlasLight data;
+            data.Position = glm::vec4(light.position, light.radius);
+            data.Color = glm::vec4(light.color, light.spot ? 1.0f : 0.0f);
+            data.Direction = glm::vec4(light.direction, std::cos(SPOT_OUTER_ANGLE));
+            data.Shadow = glm::vec4(static_cast<float>(firstShadowView(i)), std::cos(SPOT_INNER_ANGLE), 0.0f, 0.0f);
+            lights.Set(i, data);
+        }
+
+        // render
+        // ------
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+
+        // 0. how much of the screen each light may cover: its sphere's height on screen, 1 from inside it, 0 when the
+        //    sphere is out of view. The largest ask for their tiles first, so when the atlas fills up it is the
+        //    smallest on screen that get smaller tiles, or none
+        // ---------------------------------------------------------------------------------------------------------------
+        float tanHalfFov = std::tan(glm::radians(camera.Zoom) * 0.5f);
+        for (unsigned int i = 0; i < NR_LIGHTS; i++)
+        {
+            const SceneLight &light = sceneLights[i];
+            float distance = glm::length(light.position - camera.Position);
+            if (!sphereInFrustum(projection * view, light.position, light.radius))
+                coverage[i] = 0.0f;
+            else if (distance <= light.radius)
+                coverage[i] = 1.0f;
+            else
+                coverage[i] = std::min(1.0f, light.radius / (std::sqrt(distance * distance - light.radius * light.radius) * tanHalfFov));
+            lightOrder[i] = i;
+        }
+        std::sort(lightOrder.begin(), lightOrder.end(), [&coverage](unsigned int a, unsigned int b) { return coverage[a] > coverage[b]; });
+
+        // 1. a tile for every view of every light in view; those just placed or whose light moved are rendered,
+        //    the rest are still valid from an earlier frame
+        // -------------------------------------------------------------------------------------------------------
+        atlas.BeginFrame();
+        staleTiles.clear();
+        for (unsigned int n = 0; n < NR_LIGHTS; n++)
+        {
+            unsigned int i = lightOrder[n];
+            const SceneLight &light = sceneLights[i];
+            int resolution = static_cast<int>(coverage[i] * SHADOW_MAX_TILE);
+            for (unsigned int face = 0; face < (light.spot ? 1u : 6u); face++)
+            {
+                ShadowView shadowView;
+                shadowView.LightSpace = shadowViewMatrix(light, face);
+                shadowView.Rect = glm::vec4(0.0f);
+                ShadowTile tile;
+                // a light out of view keeps whatever tiles it has for when it comes back, but lights nothing in view
+                if (coverage[i] > 0.0f && atlas.Request(firstShadowView(i) + face, resolution, light.version, tile))
+                {
+                    shadowView.Rect = tile.Rect(SHADOW_ATLAS_SIZE);
+                    if (tile.stale)
+                    {
+                        StaleTile stale = { tile, shadowView.LightSpace, i };
+                        staleTiles.push_back(stale);
+                    }
+                }
+                shadowViews.Set(firstShadowView(i) + face, shadowView);
+            }
+        }
+
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(shadowQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(shadowQuery, GL_QUERY_RESULT, &elapsed);
+                shadowTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
+        }
+        bool timing = !queryPending;
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, shadowQuery);
+        if (!staleTiles.empty())
+        {
+            atlas.BeginRender();
+            depthShader.use();
+            for (unsigned int t = 0; t < staleTiles.size(); t++)
+            {
+                const SceneLight &light = sceneLights[staleTiles[t].light];
+                atlas.BeginTile(staleTiles[t].tile);
+                depthShader.setMat4("lightSpaceMatrix", staleTiles[t].lightSpace);
+                depthShader.setVec3("lightPos", light.position);
+                depthShader.setFloat("far_plane", light.radius);
+                renderScene();
+            }
+            atlas.EndRender(SCR_WIDTH, SCR_HEIGHT);
+        }
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "shadow atlas: " << atlas.stats.tiles << " tiles (" << static_cast<int>(atlas.stats.occupancy * 100.0f) << "% full), "
+                      << atlas.stats.rendered << " rendered in " << shadowTimeMs << " ms, " << atlas.stats.evictions << " evictions" << std::endl;
+        }
+
+        // 2. render scene as normal, every light reading its shadows from the atlas
+        // ---------------------------------------------------------------------------
+        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        shader.use();
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+        shader.setVec3("viewPos", camera.Position);
+        shader.setInt("shadows", shadows); // enable/disable shadows by pressing 'SPACE'
+        lights.Update();
+        shadowViews.Update();
+        lights.Bind(0);
+        shadowViews.Bind(1);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, woodTexture);
+        glActiveTexture(GL_TEXTURE1);
+        glBindTexture(GL_TEXTURE_2D, atlas.ID);
+        renderScene();
+
+        SDL_GL_SwapBuffers();
+        sleep();
+    }
+
+    SDL_Quit();
+    return 0;
+}
+
+// process all input: query whether relevant keys are pressed/released this frame and react accordingly
+// ---------------------------------------------------------------------------------------------------------
+void processInput(void)
+{
+    if(SDL_PollEvent(&event) == 1)
+    {
+        switch(event.type)
+        {
+            case SDL_QUIT:
+                main_loop = false;
+                break;
+            /*case SDL_VIDEORESIZE:
+                SDL_SetVideoMode(event.resize.w, event.resize.h, 32, SDL_OPENGL|SDL_RESIZABLE);
+                glViewport(0, 0, event.resize.w, event.resize.h);
+                break;*/
+            case SDL_MOUSEMOTION:
+            {
+                float xpos = static_cast<float>(event.motion.x);
+                float ypos = static_cast<float>(event.motion.y);
+
+                if (firstMouse)
+                {
+                    lastX = xpos;
+                    lastY = ypos;
+                    firstMouse = false;
+                }
+
+                float xoffset = xpos - lastX;
+                float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+
+                lastX = xpos;
+                lastY = ypos;
+
+                camera.ProcessMouseMovement(xoffset, yoffset);
+                break;
+            }
+            case SDL_MOUSEBUTTONDOWN:
+            {
+                if (event.button.button == SDL_BUTTON_WHEELUP)
+                {
+                    camera.ProcessMouseScroll(static_cast<float>(2.0f));
+                }
+                else if (event.button.button == SDL_BUTTON_WHEELDOWN)
+                {
+                    camera.ProcessMouseScroll(static_cast<float>(-2.0f));
+                }
+                break;
+            }
+
+        }
+    }
+
+    keys = SDL_GetKeyState(NULL);
+
+    if(keys[SDLK_ESCAPE])
+        main_loop = 0;
+
+    if(keys[SDLK_w])
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if(keys[SDLK_a])
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if(keys[SDLK_s])
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    else if(keys[SDLK_d])
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if(keys[SDLK_UP])
+        camera.ProcessMouseMovement(0, 10);
+    else if(keys[SDLK_DOWN])
+        camera.ProcessMouseMovement(0, -10);
+    if(keys[SDLK_LEFT])
+        camera.ProcessMouseMovement(-10, 0);
+    else if(keys[SDLK_RIGHT])
+        camera.ProcessMouseMovement(10, 0);
+
+    if (keys[SDLK_SPACE] && !shadowsKeyPressed)
+    {
+        shadows = !shadows;
+        shadowsKeyPressed = true;
+    }
+    if (!keys[SDLK_SPACE])
+    {
+        shadowsKeyPressed = false;
+    }
+
+    if (keys[SDLK_m] && !moveLightsKeyPressed)
+    {
+        moveLights = !moveLights;
+        moveLightsKeyPressed = true;
+    }
+    if (!keys[SDLK_m])
+    {
+        moveLightsKeyPressed = false;
+    }
+}
+
+void sleep(void)
+{
+    static int old_time = 0,  actual_time = 0;
+    actual_time = SDL_GetTicks();
+    if (actual_time - old_time < 16) // if less than 16 ms has passed
+    {
+        SDL_Delay(16 - (actual_time - old_time));
+        old_time = SDL_GetTicks();
+    }
+    else
+    {
+        old_time = actual_time;
+    }
+}
+
+// utility function for loading a 2D texture from file
+// ---------------------------------------------------
+unsigned int loadTexture(char const * path)
+{
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+
+    int width, height, nrComponents;
+    unsigned char *data = stbi_load(path, &width, &height, &nrComponents, 0);
+    if (data)
+    {
+        GLenum format;
+        if (nrComponents == 1)
+            format = GL_RED;
+        else if (nrComponents == 3)
+            format = GL_RGB;
+        else if (nrComponents == 4)
+            format = GL_RGBA;
+
+        glBindTexture(GL_TEXTURE_2D, textureID);
+        glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
+        glGenerateMipmap(GL_TEXTURE_2D);
+
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT); // for this tutorial: use GL_CLAMP_TO_EDGE to prevent semi-transparent borders. Due to interpolation it takes texels from next repeat
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, format == GL_RGBA ? GL_CLAMP_TO_EDGE : GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+        stbi_image_free(data);
+    }
+    else
+    {
+        std::cout << "Texture failed to load at path: " << path << std::endl;
+        stbi_image_free(data);
+    }
+
+    return textureID;
+}
+
+// whether a sphere may reach into the frustum of viewProjection (the near plane isn't tested)
+// -------------------------------------------------------------------------------------------
+bool sphereInFrustum(const glm::mat4 &viewProjection, const glm::vec3 &center, float radius)
+{
+    glm::vec4 row[4];
+    for (int r = 0; r < 4; r++)
+        row[r] = glm::vec4(viewProjection[0][r], viewProjection[1][r], viewProjection[2][r], viewProjection[3][r]);
+    // left, right, bottom, top and far planes, pointing inwards
+    glm::vec4 planes[5] = { row[3] + row[0], row[3] - row[0], row[3] + row[1], row[3] - row[1], row[3] - row[2] };
+    for (int p = 0; p < 5; p++)
+        if (glm::dot(glm::vec3(planes[p]), center) + planes[p].w < -radius * glm::length(glm::vec3(planes[p])))
+            return false;
+    return true;
+}
+
+// createScene() sets up a 1x1 3D cube in NDC, with a model matrix per instance
+// ---------------------------------------------------------------------------
+unsigned int cubeVAO = 0;
+unsigned int cubeVBO = 0;
+unsigned int instanceVBO = 0;
+unsigned int instanceCount = 0;
+void createScene(const std::vector<glm::mat4> &instanceMatrices)
+{
+    float vertices[] = {
+        // back face
+        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+         1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+         1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right
+         1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+        -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+        -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
+        // front face
+        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+         1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
+         1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+         1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+        -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
+        -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+        // left face
+        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+        -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
+        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+        -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+        -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+        -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+        // right face
+         1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+         1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+         1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right
+         1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+         1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+         1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left
+        // bottom face
+        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+         1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
+         1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+         1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+        -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+        -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+        // top face
+        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+         1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+         1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right
+         1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+        -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+        -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left
+    };
+    glGenVertexArrays(1, &cubeVAO);
+    glGenBuffers(1, &cubeVBO);
+    // fill buffer
+    glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+    // link vertex attributes
+    glBindVertexArray(cubeVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)(6 * sizeof(float)));
+    // set attribute pointers for the instance matrix (4 times vec4), one per instance
+    instanceCount = static_cast<unsigned int>(instanceMatrices.size());
+    glGenBuffers(1, &instanceVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    glBufferData(GL_ARRAY_BUFFER, instanceCount * sizeof(glm::mat4), &instanceMatrices[0], GL_STATIC_DRAW);
+    for (unsigned int i = 0; i < 4; i++)
+    {
+        glEnableVertexAttribArray(3 + i);
+        glVertexAttribPointer(3 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(i * sizeof(glm::vec4)));
+        glVertexAttribDivisor(3 + i, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
+
+// renders the 3D scene: every instance at once
+// --------------------------------------------
+void renderScene()
+{
+    glBindVertexArray(cubeVAO);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 36, instanceCount);
+    glBindVertexArray(0);
+}
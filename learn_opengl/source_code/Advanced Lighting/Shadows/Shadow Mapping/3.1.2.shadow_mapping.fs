@@ -5,23 +5,43 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-    vec4 FragPosLightSpace;
 } fs_in;
 
 uniform sampler2D diffuseTexture;
-uniform sampler2D shadowMap;
+uniform sampler2DArray shadowMap; // one layer per cascade
 
+uniform mat4 lightSpaceMatrices[4];
+uniform float cascadePlaneDistances[4]; // view space distance each cascade ends at
+uniform int cascadeCount;
+uniform bool showCascades;
+
+uniform mat4 view;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+// the first cascade that reaches past this fragment's view depth, cascadeCount beyond the shadow distance
+int SelectCascade()
+{
+    float depth = -(view * vec4(fs_in.FragPos, 1.0)).z;
+    for (int i = 0; i < cascadeCount; ++i)
+    {
+        if (depth < cascadePlaneDistances[i])
+            return i;
+    }
+    return cascadeCount;
+}
+
+float ShadowCalculation(int cascade)
 {
+    if (cascade >= cascadeCount)
+        return 0.0;
+    vec4 fragPosLightSpace = lightSpaceMatrices[cascade] * vec4(fs_in.FragPos, 1.0);
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1] range
     projCoords = projCoords * 0.5 + 0.5;
     // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    float closestDepth = texture(shadowMap, vec3(projCoords.xy, cascade)).r; 
     // get depth of current fragment from light's perspective
     float currentDepth = projCoords.z;
     // check whether current frag pos is in shadow
@@ -49,8 +69,15 @@ void main()
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
     // calculate shadow
-    float shadow = ShadowCalculation(fs_in.FragPosLightSpace);                      
+    int cascade = SelectCascade();
+    float shadow = ShadowCalculation(cascade);                      
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
+    // tint each cascade to show where they split
+    if (showCascades && cascade < cascadeCount)
+    {
+        const vec3 cascadeColors[4] = vec3[](vec3(1.0, 0.4, 0.4), vec3(0.4, 1.0, 0.4), vec3(0.4, 0.4, 1.0), vec3(1.0, 1.0, 0.4));
+        lighting *= cascadeColors[cascade];
+    }
     
     FragColor = vec4(lighting, 1.0);
 }
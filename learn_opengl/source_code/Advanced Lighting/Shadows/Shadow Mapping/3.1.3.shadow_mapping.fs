@@ -5,43 +5,110 @@ in VS_OUT {
     vec3 FragPos;
     vec3 Normal;
     vec2 TexCoords;
-    vec4 FragPosLightSpace;
 } fs_in;
 
 uniform sampler2D diffuseTexture;
-uniform sampler2D shadowMap;
+uniform sampler2DArray shadowMap; // one layer per cascade
 
+uniform mat4 lightSpaceMatrices[4];
+uniform float cascadePlaneDistances[4]; // view space distance each cascade ends at
+uniform int cascadeCount;
+uniform bool showCascades;
+
+// exponential variance shadow maps: one filtered fetch of warped depth moments instead of the PCF loop
+uniform bool evsm;
+uniform sampler2DArray momentMap; // mipmapped, one layer per cascade
+uniform vec2 evsmExponents;        // positive, negative
+uniform float lightBleedingReduction;
+
+uniform mat4 view;
 uniform vec3 lightPos;
 uniform vec3 viewPos;
 
-float ShadowCalculation(vec4 fragPosLightSpace)
+// the first cascade that reaches past this fragment's view depth, cascadeCount beyond the shadow distance
+int SelectCascade()
 {
+    float depth = -(view * vec4(fs_in.FragPos, 1.0)).z;
+    for (int i = 0; i < cascadeCount; ++i)
+    {
+        if (depth < cascadePlaneDistances[i])
+            return i;
+    }
+    return cascadeCount;
+}
+
+// Chebyshev's upper bound on the fraction of the filtered region at least as far as depth, with the lowest
+// lightBleedingReduction of it cut off
+float Chebyshev(vec2 moments, float depth, float minVariance)
+{
+    if (depth <= moments.x)
+        return 1.0;
+    float variance = max(moments.y - moments.x * moments.x, minVariance);
+    float d = depth - moments.x;
+    float pMax = variance / (variance + d * d);
+    return clamp((pMax - lightBleedingReduction) / (1.0 - lightBleedingReduction), 0.0, 1.0);
+}
+
+// how lit a fragment at depth is, from both warps of the moments; the smaller bound bleeds less
+float EVSMVisibility(vec4 moments, float depth)
+{
+    depth = 2.0 * depth - 1.0;
+    float positive = exp(evsmExponents.x * depth);
+    float negative = -exp(-evsmExponents.y * depth);
+    // the warps stretch depth by their slope, so does the variance floor
+    vec2 depthScale = 0.0001 * evsmExponents * vec2(positive, -negative);
+    float positiveLit = Chebyshev(moments.xy, positive, depthScale.x * depthScale.x);
+    float negativeLit = Chebyshev(moments.zw, negative, depthScale.y * depthScale.y);
+    return min(positiveLit, negativeLit);
+}
+
+// dPdx, dPdy: the fragment position's screen space derivatives, taken before any branch
+float ShadowCalculation(int cascade, vec3 dPdx, vec3 dPdy)
+{
+    if (cascade >= cascadeCount)
+        return 0.0;
+    vec4 fragPosLightSpace = lightSpaceMatrices[cascade] * vec4(fs_in.FragPos, 1.0);
     // perform perspective divide
     vec3 projCoords = fragPosLightSpace.xyz / fragPosLightSpace.w;
     // transform to [0,1] range
     projCoords = projCoords * 0.5 + 0.5;
     // get closest depth value from light's perspective (using [0,1] range fragPosLight as coords)
-    float closestDepth = texture(shadowMap, projCoords.xy).r; 
+    float closestDepth = texture(shadowMap, vec3(projCoords.xy, cascade)).r; 
     // get depth of current fragment from light's perspective
     float currentDepth = projCoords.z;
     // calculate bias (based on depth map resolution and slope)
     vec3 normal = normalize(fs_in.Normal);
     vec3 lightDir = normalize(lightPos - fs_in.FragPos);
-    float bias = max(0.05 * (1.0 - dot(normal, lightDir)), 0.005);
+    // a cascade covers as much depth as width, so one texel of width is also one texel worth of depth
+    float texelDepth = 1.0 / float(textureSize(shadowMap, 0).x);
+    float bias = max(4.0 * (1.0 - dot(normal, lightDir)), 1.0) * texelDepth;
     // check whether current frag pos is in shadow
     // float shadow = currentDepth - bias > closestDepth  ? 1.0 : 0.0;
-    // PCF
     float shadow = 0.0;
-    vec2 texelSize = 1.0 / textureSize(shadowMap, 0);
-    for(int x = -1; x <= 1; ++x)
+    if (evsm)
     {
-        for(int y = -1; y <= 1; ++y)
+        // one trilinear, anisotropic fetch; the gradients come from the position, as the cascade can change
+        // between neighbouring pixels and implicit ones would jump there
+        mat3 toShadowMap = mat3(lightSpaceMatrices[cascade]) * 0.5;
+        vec2 dx = (toShadowMap * dPdx).xy;
+        vec2 dy = (toShadowMap * dPdy).xy;
+        vec4 moments = textureGrad(momentMap, vec3(projCoords.xy, cascade), dx, dy);
+        shadow = 1.0 - EVSMVisibility(moments, currentDepth - bias);
+    }
+    else
+    {
+        // PCF
+        vec2 texelSize = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+        for(int x = -1; x <= 1; ++x)
         {
-            float pcfDepth = texture(shadowMap, projCoords.xy + vec2(x, y) * texelSize).r; 
-            shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
-        }    
+            for(int y = -1; y <= 1; ++y)
+            {
+                float pcfDepth = texture(shadowMap, vec3(projCoords.xy + vec2(x, y) * texelSize, cascade)).r; 
+                shadow += currentDepth - bias > pcfDepth  ? 1.0 : 0.0;        
+            }    
+        }
+        shadow /= 9.0;
     }
-    shadow /= 9.0;
     
     // keep the shadow at 0.0 when outside the far_plane region of the light's frustum.
     if(projCoords.z > 1.0)
@@ -69,8 +136,15 @@ void main()
     spec = pow(max(dot(normal, halfwayDir), 0.0), 64.0);
     vec3 specular = spec * lightColor;    
     // calculate shadow
-    float shadow = ShadowCalculation(fs_in.FragPosLightSpace);                      
+    int cascade = SelectCascade();
+    float shadow = ShadowCalculation(cascade, dFdx(fs_in.FragPos), dFdy(fs_in.FragPos));                      
     vec3 lighting = (ambient + (1.0 - shadow) * (diffuse + specular)) * color;    
+    // tint each cascade to show where they split
+    if (showCascades && cascade < cascadeCount)
+    {
+        const vec3 cascadeColors[4] = vec3[](vec3(1.0, 0.4, 0.4), vec3(0.4, 1.0, 0.4), vec3(0.4, 0.4, 1.0), vec3(1.0, 1.0, 0.4));
+        lighting *= cascadeColors[cascade];
+    }
     
     FragColor = vec4(lighting, 1.0);
 }
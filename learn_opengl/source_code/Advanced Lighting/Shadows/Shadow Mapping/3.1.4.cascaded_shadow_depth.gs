@@ -0,0 +1,32 @@
+#version 330 core
+layout (triangles) in;
+layout (triangle_strip, max_vertices = 12) out;
+
+uniform mat4 lightSpaceMatrices[4];
+uniform int cascadeCount;
+uniform int layerMask; // a bit per cascade to render into, the rest keep their depth
+
+void main()
+{
+    for (int cascade = 0; cascade < cascadeCount; ++cascade)
+    {
+        if ((layerMask & (1 << cascade)) == 0)
+            continue;
+        vec4 position[3];
+        for (int i = 0; i < 3; ++i)
+            position[i] = lightSpaceMatrices[cascade] * gl_in[i].gl_Position;
+        // skip the cascades the triangle misses. Only beyond the far plane counts along z: in front of the
+        // near plane it still casts a shadow, flattened onto it by depth clamping
+        vec3 lo = min(min(position[0].xyz, position[1].xyz), position[2].xyz);
+        vec3 hi = max(max(position[0].xyz, position[1].xyz), position[2].xyz);
+        if (any(lessThan(hi.xy, vec2(-1.0))) || any(greaterThan(lo.xy, vec2(1.0))) || lo.z > 1.0)
+            continue;
+        gl_Layer = cascade; // built-in variable that specifies to which layer we render.
+        for (int i = 0; i < 3; ++i)
+        {
+            gl_Position = position[i];
+            EmitVertex();
+        }
+        EndPrimitive();
+    }
+}
\ No newline at end of file
@@ -0,0 +1,10 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 model;
+
+void main()
+{
+    // world space: the geometry shader projects it once per cascade
+    gl_Position = model * vec4(aPos, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,22 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D image; // horizontally blurred moments
+uniform int blurRadius;
+
+// the vertical half of the Gaussian; moments average linearly, so the separable blur is exact
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int lastRow = textureSize(image, 0).y - 1;
+    float sigma = max(float(blurRadius), 1.0) * 0.5;
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int y = -blurRadius; y <= blurRadius; ++y)
+    {
+        float weight = exp(-float(y * y) / (2.0 * sigma * sigma));
+        sum += weight * texelFetch(image, ivec2(texel.x, clamp(texel.y + y, 0, lastRow)), 0);
+        weightSum += weight;
+    }
+    FragColor = sum / weightSum;
+}
\ No newline at end of file
@@ -0,0 +1,50 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2DArray depthMap;
+uniform int layer;
+uniform int downsample; // depth texels per moment texel, along each axis
+uniform int blurRadius; // moment texels on each side
+uniform vec2 exponents; // positive, negative
+
+// both exponentially warped depths and their squares
+vec4 WarpDepth(float depth)
+{
+    depth = 2.0 * depth - 1.0;
+    float positive = exp(exponents.x * depth);
+    float negative = -exp(-exponents.y * depth);
+    return vec4(positive, positive * positive, negative, negative * negative);
+}
+
+// the moments of one moment texel: the average of its downsample x downsample depth texels
+vec4 Moments(ivec2 texel)
+{
+    ivec2 lastTexel = textureSize(depthMap, 0).xy - 1;
+    vec4 sum = vec4(0.0);
+    for (int y = 0; y < downsample; ++y)
+    {
+        for (int x = 0; x < downsample; ++x)
+        {
+            ivec2 depthTexel = min(texel * downsample + ivec2(x, y), lastTexel);
+            sum += WarpDepth(texelFetch(depthMap, ivec3(depthTexel, layer), 0).r);
+        }
+    }
+    return sum / float(downsample * downsample);
+}
+
+// warps the layer's depth and blurs it horizontally; 3.1.5.evsm_blur.fs does the vertical half
+void main()
+{
+    ivec2 texel = ivec2(gl_FragCoord.xy);
+    int lastColumn = textureSize(depthMap, 0).x / downsample - 1;
+    float sigma = max(float(blurRadius), 1.0) * 0.5;
+    vec4 sum = vec4(0.0);
+    float weightSum = 0.0;
+    for (int x = -blurRadius; x <= blurRadius; ++x)
+    {
+        float weight = exp(-float(x * x) / (2.0 * sigma * sigma));
+        sum += weight * Moments(ivec2(clamp(texel.x + x, 0, lastColumn), texel.y));
+        weightSum += weight;
+    }
+    FragColor = sum / weightSum;
+}
\ No newline at end of file
@@ -9,6 +9,8 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "cascaded_shadow_map.h"
+#include "shadow_cache.h"
 
 #include <iostream>
 
@@ -16,6 +18,8 @@ void processInput(void);
 void sleep(void);
 unsigned int loadTexture(const char *path);
 void renderScene(const Shader &shader);
+void renderStaticScene(const Shader &shader);
+void renderDynamicScene(const Shader &shader);
 void renderCube();
 void renderQuad();
 
@@ -36,6 +40,23 @@ float lastFrame = 0.0f;
 // meshes
 unsigned int planeVAO;
 
+// shadows: SHADOW_CASCADES maps of SHADOW_SIZE take as much memory as one 1024x1024 map, but cover the view up to
+// SHADOW_DISTANCE; C tints each cascade
+const unsigned int SHADOW_SIZE = 512;
+const unsigned int SHADOW_CASCADES = 4;
+const float SHADOW_DISTANCE = 50.0f;
+bool showCascades = false;
+bool showCascadesKeyPressed = false;
+
+// shadow caching: the floor and all cubes but one are static casters, rendered into a cached copy of a cascade only
+// when the cascade moves with the camera; the spinning cube is the dynamic one, rendered every frame over the
+// cascades it reaches. M stops it, and with the camera and the cube still the shadow pass does nothing
+const glm::vec3 spinningCubePosition(-1.0f, 0.0f, 2.0f);
+const float spinningCubeScale = 0.25f;
+float spinningCubeAngle = 60.0f;
+bool spinCube = true;
+bool spinCubeKeyPressed = false;
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -53,6 +74,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
 
     // configure global opengl state
     // -----------------------------
@@ -61,8 +83,7 @@ int main(int argc, char *argv[])
     // build and compile shaders
     // -------------------------
     Shader shader("3.1.2.shadow_mapping.vs", "3.1.2.shadow_mapping.fs");
-    Shader simpleDepthShader("3.1.1.shadow_mapping_depth.vs", "3.1.1.shadow_mapping_depth.fs");
-    Shader debugDepthQuad("3.1.1.debug_quad.vs", "3.1.1.debug_quad_depth.fs");
+    Shader cascadeDepthShader("3.1.4.cascaded_shadow_depth.vs", "3.1.1.shadow_mapping_depth.fs", "3.1.4.cascaded_shadow_depth.gs");
 
     // set up vertex data (and buffer(s)) and configure vertex attributes
     // ------------------------------------------------------------------
@@ -95,26 +116,19 @@ int main(int argc, char *argv[])
     // -------------
     unsigned int woodTexture = loadTexture(FileSystem::getPath("wood.png").c_str());
 
-    // configure depth map FBO
-    // -----------------------
-    const unsigned int SHADOW_WIDTH = 1024, SHADOW_HEIGHT = 1024;
-    unsigned int depthMapFBO;
-    glGenFramebuffers(1, &depthMapFBO);
-    // create depth texture
-    unsigned int depthMap;
-    glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    // attach depth texture as FBO's depth buffer
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
-    glDrawBuffer(GL_NONE);
-    glReadBuffer(GL_NONE);
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    // configure the cascaded shadow map: every cascade a layer of one depth texture array
+    // -------------------------------------------------------------------------------------
+    CascadedShadowMap shadowMap(SHADOW_SIZE, SHADOW_CASCADES);
+    // the static casters' depth, copied into the shadow map cascade by cascade
+    ShadowCache shadowCache(GL_TEXTURE_2D_ARRAY, shadowMap.ID, shadowMap.FBO, SHADOW_SIZE, SHADOW_CASCADES);
+    unsigned int previousCubeCascades = 0;
+
+    // the shadow pass is timed without waiting on the GPU: the query's result is read once it is ready
+    unsigned int shadowQuery;
+    glGenQueries(1, &shadowQuery);
+    bool queryPending = false;
+    float shadowTimeMs = 0.0f;
+    unsigned int lastReport = 0;
 
 
     // shader configuration
@@ -122,8 +136,6 @@ int main(int argc, char *argv[])
     shader.use();
     shader.setInt("diffuseTexture", 0);
     shader.setInt("shadowMap", 1);
-    debugDepthQuad.use();
-    debugDepthQuad.setInt("depthMap", 0);
 
     // lighting info
     // -------------
@@ -142,62 +154,89 @@ int main(int argc, char *argv[])
         // input
         // -----
         processInput();
+        if (spinCube)
+            spinningCubeAngle += deltaTime * 0.05f;
 
         // render
         // ------
         glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // 1. render depth of scene to texture (from light's perspective)
-        // --------------------------------------------------------------
-        glm::mat4 lightProjection, lightView;
-        glm::mat4 lightSpaceMatrix;
-        float near_plane = 1.0f, far_plane = 7.5f;
-        lightProjection = glm::ortho(-10.0f, 10.0f, -10.0f, 10.0f, near_plane, far_plane);
-        lightView = glm::lookAt(lightPos, glm::vec3(0.0f), glm::vec3(0.0, 1.0, 0.0));
-        lightSpaceMatrix = lightProjection * lightView;
-        // render scene from light's point of view
-        simpleDepthShader.use();
-        simpleDepthShader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
-
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
-            glClear(GL_DEPTH_BUFFER_BIT);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, woodTexture);
-            renderScene(simpleDepthShader);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        // reset viewport
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        // 1. render depth of scene into every cascade at once (from light's perspective): the static casters only
+        //    into the cached cascades that moved, then the dynamic casters over copies of the cascades that changed.
+        //    The geometry shader skips the other cascades
+        // -------------------------------------------------------------------------------------------------------------
+        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        glm::mat4 view = camera.GetViewMatrix();
+        // a directional light, shining from lightPos towards the origin
+        shadowCache.Invalidate(shadowMap.Update(view, glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, SHADOW_DISTANCE, glm::normalize(lightPos)));
+        unsigned int cubeCascades = ShadowCache::LayersTouching(shadowMap.lightSpaceMatrices, SHADOW_CASCADES, spinningCubePosition, spinningCubeScale * 1.7320508f);
+        unsigned int movedCascades = spinCube ? cubeCascades | previousCubeCascades : 0;
+        previousCubeCascades = cubeCascades;
+
+        if (queryPending)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(shadowQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available)
+            {
+                GLuint64 elapsed = 0;
+                glGetQueryObjectui64v(shadowQuery, GL_QUERY_RESULT, &elapsed);
+                shadowTimeMs = elapsed / 1000000.0f;
+                queryPending = false;
+            }
+        }
+        bool timing = !queryPending;
+        if (timing)
+            glBeginQuery(GL_TIME_ELAPSED, shadowQuery);
+
+        cascadeDepthShader.use();
+        shadowMap.SetUniforms(cascadeDepthShader);
+        glEnable(GL_DEPTH_CLAMP);
+        unsigned int cascades = shadowCache.BeginStatic();
+        if (cascades)
+        {
+            cascadeDepthShader.setInt("layerMask", cascades);
+            renderStaticScene(cascadeDepthShader);
+        }
+        cascades = shadowCache.BeginDynamic(movedCascades);
+        if (cascades)
+        {
+            cascadeDepthShader.setInt("layerMask", cascades);
+            renderDynamicScene(cascadeDepthShader);
+        }
+        shadowMap.EndRender(SCR_WIDTH, SCR_HEIGHT);
+        if (timing)
+        {
+            glEndQuery(GL_TIME_ELAPSED);
+            queryPending = true;
+        }
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "shadow pass " << shadowTimeMs << " ms: static cascades " << shadowCache.staticLayersDrawn << ", copied "
+                      << shadowCache.layersCopied << ", dynamic " << shadowCache.dynamicLayersDrawn << std::endl;
+        }
+
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // 2. render scene as normal using the generated depth/shadow map
         // --------------------------------------------------------------
         shader.use();
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        glm::mat4 view = camera.GetViewMatrix();
         shader.setMat4("projection", projection);
         shader.setMat4("view", view);
         // set light uniforms
         shader.setVec3("viewPos", camera.Position);
         shader.setVec3("lightPos", lightPos);
-        shader.setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        shadowMap.SetUniforms(shader);
+        shader.setInt("showCascades", showCascades);
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, woodTexture);
         glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, shadowMap.ID);
         renderScene(shader);
 
-        // render Depth map to quad for visual debugging
-        // ---------------------------------------------
-        debugDepthQuad.use();
-        debugDepthQuad.setFloat("near_plane", near_plane);
-        debugDepthQuad.setFloat("far_plane", far_plane);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
-        //renderQuad();
-
         SDL_GL_SwapBuffers();
         sleep();
     }
@@ -277,6 +316,26 @@ void processInput(void)
     else if(keys[SDLK_d])
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
+    if (keys[SDLK_c] && !showCascadesKeyPressed)
+    {
+        showCascades = !showCascades;
+        showCascadesKeyPressed = true;
+    }
+    if (!keys[SDLK_c])
+    {
+         showCascadesKeyPressed = false;
+    }
+
+    if (keys[SDLK_m] && !spinCubeKeyPressed)
+    {
+        spinCube = !spinCube;
+        spinCubeKeyPressed = true;
+    }
+    if (!keys[SDLK_m])
+    {
+        spinCubeKeyPressed = false;
+    }
+
     if(keys[SDLK_UP])
         camera.ProcessMouseMovement(0, 10);
     else if(keys[SDLK_DOWN])
@@ -344,6 +403,14 @@ unsigned int loadTexture(char const * path)
 // renders the 3D scene
 // --------------------
 void renderScene(const Shader &shader)
+{
+    renderStaticScene(shader);
+    renderDynamicScene(shader);
+}
+
+// the casters that never move: their shadows are cached
+// -------------------------------------------------------
+void renderStaticScene(const Shader &shader)
 {
     // floor
     glm::mat4 model = glm::mat4(1.0f);
@@ -361,10 +428,16 @@ void renderScene(const Shader &shader)
     model = glm::scale(model, glm::vec3(0.5f));
     shader.setMat4("model", model);
     renderCube();
-    model = glm::mat4(1.0f);
-    model = glm::translate(model, glm::vec3(-1.0f, 0.0f, 2.0));
-    model = glm::rotate(model, glm::radians(60.0f), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
-    model = glm::scale(model, glm::vec3(0.25));
+}
+
+// the spinning cube, rendered into the shadow map every frame it or its cascades move
+// -----------------------------------------------------------------------------------
+void renderDynamicScene(const Shader &shader)
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, spinningCubePosition);
+    model = glm::rotate(model, glm::radians(spinningCubeAngle), glm::normalize(glm::vec3(1.0, 0.0, 1.0)));
+    model = glm::scale(model, glm::vec3(spinningCubeScale));
     shader.setMat4("model", model);
     renderCube();
 }
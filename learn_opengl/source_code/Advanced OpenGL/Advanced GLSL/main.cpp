@@ -9,6 +9,8 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "gl_extensions.h"
+#include "stream_buffer.h"
 
 #include <iostream>
 
@@ -49,6 +51,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
 
 
     // configure global opengl state
@@ -130,20 +133,17 @@ int main(int argc, char *argv[])
     glUniformBlockBinding(shaderGreen.ID, uniformBlockIndexGreen, 0);
     glUniformBlockBinding(shaderBlue.ID, uniformBlockIndexBlue, 0);
     glUniformBlockBinding(shaderYellow.ID, uniformBlockIndexYellow, 0);
-    // Now actually create the buffer
-    unsigned int uboMatrices;
-    glGenBuffers(1, &uboMatrices);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), NULL, GL_STATIC_DRAW);
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
-    // define the range of the buffer that links to a uniform binding point
-    glBindBufferRange(GL_UNIFORM_BUFFER, 0, uboMatrices, 0, 2 * sizeof(glm::mat4));
-
-    // store the projection matrix (we only do this once now) (note: we're not using zoom anymore by changing the FoV)
+    // Now the buffer: instead of a dedicated UBO updated with glBufferSubData (which makes the driver
+    // synchronize with the GPU still reading last frame's matrices), the block is streamed every frame
+    // through a ring of fenced regions
+    StreamBuffer stream(64 * 1024);
+    GLint uboAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &uboAlignment);
+    std::cout << "stream buffer: " << (stream.Persistent() ? "persistent mapping" : "unsynchronized mapping + orphaning") << std::endl;
+
+    // note: we're not using zoom anymore by changing the FoV
     glm::mat4 projection = glm::perspective(45.0f, (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-    glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(glm::mat4), glm::value_ptr(projection));
-    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    unsigned int lastReport = 0;
 
     // render loop
     // -----------
@@ -165,10 +165,11 @@ int main(int argc, char *argv[])
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // set the view and projection matrix in the uniform block - we only have to do this once per loop iteration.
-        glm::mat4 view = camera.GetViewMatrix();
-        glBindBuffer(GL_UNIFORM_BUFFER, uboMatrices);
-        glBufferSubData(GL_UNIFORM_BUFFER, sizeof(glm::mat4), sizeof(glm::mat4), glm::value_ptr(view));
-        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        stream.BeginFrame();
+        glm::mat4 matrices[2] = { projection, camera.GetViewMatrix() };
+        StreamAllocation block = stream.Upload(matrices, sizeof(matrices), uboAlignment);
+        // define the range of the buffer that links to the uniform binding point
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, stream.ID, block.offset, block.size);
 
         // draw 4 cubes
         // RED
@@ -197,6 +198,15 @@ int main(int argc, char *argv[])
         shaderBlue.setMat4("model", model);
         glDrawArrays(GL_TRIANGLES, 0, 36);
 
+        stream.EndFrame();
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "streamed " << stream.stats.bytesLastFrame << " bytes | fence stalls: " << stream.stats.stalls
+                      << " (" << stream.stats.stallTimeMs << " ms) | orphans: " << stream.stats.orphans
+                      << " | failed allocations: " << stream.stats.failedAllocations << std::endl;
+        }
+
         SDL_GL_SwapBuffers();
         sleep();
     }
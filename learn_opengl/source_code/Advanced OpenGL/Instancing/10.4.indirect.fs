@@ -0,0 +1,13 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 TexCoords;
+flat in int MaterialIndex;
+
+uniform sampler2D texture_diffuse1;
+uniform vec3 materialTint[4];
+
+void main()
+{
+    FragColor = texture(texture_diffuse1, TexCoords) * vec4(materialTint[MaterialIndex], 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoords;
+layout (location = 7) in uint aDrawId;
+
+out vec2 TexCoords;
+flat out int MaterialIndex;
+
+uniform mat4 projection;
+uniform mat4 view;
+// 5 texels per draw: model matrix columns, then (material, 0, 0, 0)
+uniform samplerBuffer drawData;
+
+void main()
+{
+    int base = int(aDrawId) * 5;
+    mat4 model = mat4(texelFetch(drawData, base),
+                      texelFetch(drawData, base + 1),
+                      texelFetch(drawData, base + 2),
+                      texelFetch(drawData, base + 3));
+    MaterialIndex = int(texelFetch(drawData, base + 4).x);
+    TexCoords = aTexCoords;
+    gl_Position = projection * view * model * vec4(aPos, 1.0f); 
+}
\ No newline at end of file
@@ -29,6 +29,10 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
+// redundant GL state elimination, toggled with T
+int tracking_changed = 0;
+unsigned int lastReport = 0;
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -51,6 +55,8 @@ int main(int argc, char *argv[])
     // configure global opengl state
     // -----------------------------
     glEnable(GL_DEPTH_TEST);
+    // every bind in this sample goes through Shader::use / Mesh::Draw, so the state cache can skip redundant ones
+    glState().SetEnabled(true);
 
     // build and compile shaders
     // -------------------------
@@ -134,6 +140,14 @@ int main(int argc, char *argv[])
             rock.Draw(shader);
         }
 
+        glState().EndFrame();
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << (glState().Enabled() ? "[tracking] " : "[pass-through] ");
+            glState().PrintStats(std::cout);
+        }
+
         SDL_GL_SwapBuffers();
         sleep();
     }
@@ -217,6 +231,14 @@ void processInput(void)
     else if(keys[SDLK_RIGHT])
         camera.ProcessMouseMovement(10, 0);
 
+    if (keys[SDLK_t] && !tracking_changed)
+    {
+        glState().SetEnabled(!glState().Enabled());
+        tracking_changed = 1;
+    }
+    else if (!keys[SDLK_t])
+        tracking_changed = 0;
+
 }
 
 void sleep(void)
@@ -0,0 +1,258 @@
+#include <SDL/SDL.h>
+#include "glad.h"
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+#include "glm/gtc/type_ptr.hpp"
+
+#include "shader.h"
+#include "camera.h"
+#include "model.h"
+#include "gl_extensions.h"
+#include "static_batch.h"
+#include "filesystem.h"
+
+#include <iostream>
+
+void processInput(void);
+void sleep(void);
+
+// settings
+const unsigned int SCR_WIDTH = 640;
+const unsigned int SCR_HEIGHT = 480;
+
+// camera
+Camera camera(glm::vec3(0.0f, 0.0f, 55.0f));
+float lastX = SCR_WIDTH / 2.0f;
+float lastY = SCR_HEIGHT / 2.0f;
+bool firstMouse = true;
+
+// timing
+float deltaTime = 0.0f;	// time between current frame and last frame
+float lastFrame = 0.0f;
+
+bool main_loop = true;
+SDL_Event event;
+Uint8* keys;
+
+int main(int argc, char *argv[])
+{
+    SDL_Init(SDL_INIT_VIDEO);
+    SDL_WM_SetCaption("LearnOpenGL",NULL);
+    SDL_SetVideoMode(640, 480, 32, SDL_OPENGL);//|SDL_RESIZABLE);
+
+    // glad: load all OpenGL function pointers
+    // ---------------------------------------
+    if (!gladLoadGLLoader((GLADloadproc)SDL_GL_GetProcAddress))
+    {
+        std::cout << "Failed to initialize GLAD" << std::endl;
+        return -1;
+    }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
+    std::cout << "multi draw indirect: " << (glExt().multiDrawIndirect ? "yes" : "no, falling back to a draw loop") << std::endl;
+
+
+    // configure global opengl state
+    // -----------------------------
+    glEnable(GL_DEPTH_TEST);
+
+    // build and compile shaders
+    // -------------------------
+    Shader shader("10.4.indirect.vs", "10.4.indirect.fs");
+    shader.use();
+    shader.setInt("texture_diffuse1", 0);
+    shader.setVec3("materialTint[0]", glm::vec3(1.0f));
+    shader.setVec3("materialTint[1]", glm::vec3(1.0f, 0.8f, 0.7f));
+    shader.setVec3("materialTint[2]", glm::vec3(0.7f, 0.8f, 1.0f));
+    shader.setVec3("materialTint[3]", glm::vec3(0.8f, 1.0f, 0.8f));
+
+    // load models
+    // -----------
+    Model rock(FileSystem::getPath("rock/rock.obj"));
+    Model planet(FileSystem::getPath("planet/planet.obj"));
+
+    // generate a large list of semi-random model transformation matrices
+    // ------------------------------------------------------------------
+    unsigned int amount = 10000;
+    glm::mat4* modelMatrices;
+    modelMatrices = new glm::mat4[amount];
+    srand(static_cast<unsigned int>(SDL_GetTicks())); // initialize random seed
+    float radius = 50.0;
+    float offset = 2.5f;
+    for (unsigned int i = 0; i < amount; i++)
+    {
+        glm::mat4 model = glm::mat4(1.0f);
+        // 1. translation: displace along circle with 'radius' in range [-offset, offset]
+        float angle = (float)i / (float)amount * 360.0f;
+        float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float x = sin(angle) * radius + displacement;
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float y = displacement * 0.4f; // keep height of asteroid field smaller compared to width of x and z
+        displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
+        float z = cos(angle) * radius + displacement;
+        model = glm::translate(model, glm::vec3(x, y, z));
+
+        // 2. scale: Scale between 0.05 and 0.25f
+        float scale = static_cast<float>((rand() % 20) / 100.0 + 0.05);
+        model = glm::scale(model, glm::vec3(scale));
+
+        // 3. rotation: add random rotation around a (semi)randomly picked rotation axis vector
+        float rotAngle = static_cast<float>((rand() % 360));
+        model = glm::rotate(model, rotAngle, glm::vec3(0.4f, 0.6f, 0.8f));
+
+        // 4. now add to list of matrices
+        modelMatrices[i] = model;
+    }
+
+    // pack the static scene: one batch per texture set, each drawn with a single call
+    // ----------------------------------------------------------------------------------
+    StaticBatch rockBatch, planetBatch;
+    glm::mat4 planetModel = glm::mat4(1.0f);
+    planetModel = glm::translate(planetModel, glm::vec3(0.0f, -3.0f, 0.0f));
+    planetModel = glm::scale(planetModel, glm::vec3(4.0f, 4.0f, 4.0f));
+    for (unsigned int m = 0; m < planet.meshes.size(); m++)
+        planetBatch.Add(planet.meshes[m], planetModel);
+    for (unsigned int i = 0; i < amount; i++)
+        for (unsigned int m = 0; m < rock.meshes.size(); m++)
+            rockBatch.Add(rock.meshes[m], modelMatrices[i], i % 4);
+    planetBatch.Build();
+    rockBatch.Build();
+    unsigned int lastReport = 0;
+
+    // render loop
+    // -----------
+    while (main_loop)
+    {
+        // per-frame time logic
+        // --------------------
+        float currentFrame = static_cast<float>(SDL_GetTicks());
+        deltaTime = currentFrame - lastFrame;
+        lastFrame = currentFrame;
+
+        // input
+        // -----
+        processInput();
+
+        // render
+        // ------
+        glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+        // configure transformation matrices
+        glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 1000.0f);
+        glm::mat4 view = camera.GetViewMatrix();;
+        shader.use();
+        shader.setMat4("projection", projection);
+        shader.setMat4("view", view);
+
+        // draw planet and meteorites
+        planetBatch.Draw(shader);
+        rockBatch.Draw(shader);
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            lastReport = SDL_GetTicks();
+            std::cout << "meshes: " << planetBatch.DrawCount() + rockBatch.DrawCount()
+                      << " | draw calls: " << planetBatch.submitCalls + rockBatch.submitCalls << std::endl;
+        }
+
+        SDL_GL_SwapBuffers();
+        sleep();
+    }
+
+    SDL_Quit();
+    return 0;
+}
+
+// process all input: query whether relevant keys are pressed/released this frame and react accordingly
+// ---------------------------------------------------------------------------------------------------------
+void processInput(void)
+{
+    if(SDL_PollEvent(&event) == 1)
+    {
+        switch(event.type)
+        {
+            case SDL_QUIT:
+                main_loop = false;
+                break;
+            /*case SDL_VIDEORESIZE:
+                SDL_SetVideoMode(event.resize.w, event.resize.h, 32, SDL_OPENGL|SDL_RESIZABLE);
+                glViewport(0, 0, event.resize.w, event.resize.h);
+                break;*/
+            case SDL_MOUSEMOTION:
+            {
+                float xpos = static_cast<float>(event.motion.x);
+                float ypos = static_cast<float>(event.motion.y);
+
+                if (firstMouse)
+                {
+                    lastX = xpos;
+                    lastY = ypos;
+                    firstMouse = false;
+                }
+
+                float xoffset = xpos - lastX;
+                float yoffset = lastY - ypos; // reversed since y-coordinates go from bottom to top
+
+                lastX = xpos;
+                lastY = ypos;
+
+                camera.ProcessMouseMovement(xoffset, yoffset);
+                break;
+            }
+            case SDL_MOUSEBUTTONDOWN:
+            {
+                if (event.button.button == SDL_BUTTON_WHEELUP)
+                {
+                    camera.ProcessMouseScroll(static_cast<float>(2.0f));
+                }
+                else if (event.button.button == SDL_BUTTON_WHEELDOWN)
+                {
+                    camera.ProcessMouseScroll(static_cast<float>(-2.0f));
+                }
+                break;
+            }
+
+        }
+    }
+
+    keys = SDL_GetKeyState(NULL);
+
+    if(keys[SDLK_ESCAPE])
+        main_loop = 0;
+
+    if(keys[SDLK_w])
+        camera.ProcessKeyboard(FORWARD, deltaTime);
+    else if(keys[SDLK_a])
+        camera.ProcessKeyboard(BACKWARD, deltaTime);
+    if(keys[SDLK_s])
+        camera.ProcessKeyboard(LEFT, deltaTime);
+    else if(keys[SDLK_d])
+        camera.ProcessKeyboard(RIGHT, deltaTime);
+
+    if(keys[SDLK_UP])
+        camera.ProcessMouseMovement(0, 10);
+    else if(keys[SDLK_DOWN])
+        camera.ProcessMouseMovement(0, -10);
+    if(keys[SDLK_LEFT])
+        camera.ProcessMouseMovement(-10, 0);
+    else if(keys[SDLK_RIGHT])
+        camera.ProcessMouseMovement(10, 0);
+
+}
+
+void sleep(void)
+{
+    static int old_time = 0,  actual_time = 0;
+    actual_time = SDL_GetTicks();
+    if (actual_time - old_time < 16) // if less than 16 ms has passed
+    {
+        SDL_Delay(16 - (actual_time - old_time));
+        old_time = SDL_GetTicks();
+    }
+    else
+    {
+        old_time = actual_time;
+    }
+}
+
@@ -10,6 +10,8 @@
 #include "animator.h"
 #include "model_animation.h"
 #include "filesystem.h"
+#include "gl_extensions.h"
+#include "stream_buffer.h"
 
 #include <iostream>
 
@@ -17,6 +19,7 @@ void processInput(void);
 void sleep(void);
 void load_all_animations(std::vector<Animation> *animations, const std::string& animationPath, Model* model);
 void change_animation(void);
+void upload_bone_palette(StreamBuffer &stream, Model &model, Animator &animator);
 
 // settings
 const unsigned int SCR_WIDTH = 640;
@@ -33,8 +36,10 @@ float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 int anim_number = 0;
 int anim_changed = 0;
+int skinning_changed = 0;
 std::vector<Animation> animations;
 Animator *animator_ptr;
+Model *model_ptr;
 
 // lighting
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
@@ -56,6 +61,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
 
 	// tell stb_image.h to flip loaded texture's on the y-axis (before loading model).
 	stbi_set_flip_vertically_on_load(true);
@@ -67,6 +73,13 @@ int main(int argc, char *argv[])
 	// build and compile shaders
 	// -------------------------
 	Shader ourShader("anim_model.vs", "anim_model.fs");
+	Shader dqShader("anim_model_dq.vs", "anim_model.fs");
+	// both palette layouts are read from uniform binding point 0
+	glUniformBlockBinding(ourShader.ID, glGetUniformBlockIndex(ourShader.ID, "BonePalette"), 0);
+	glUniformBlockBinding(dqShader.ID, glGetUniformBlockIndex(dqShader.ID, "BonePaletteDQ"), 0);
+
+	// per-frame bone palettes are streamed instead of re-uploaded through glUniform* calls
+	StreamBuffer stream(64 * 1024);
 
 
 	// load models
@@ -79,6 +92,7 @@ int main(int argc, char *argv[])
 	Animator animator(&danceAnimation);
 	//animator.m_CurrentAnimation=&animations[1];
 	animator_ptr = &animator;
+	model_ptr = &ourModel;
 
 	// draw in wireframe
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -104,26 +118,29 @@ int main(int argc, char *argv[])
 		glClearColor(0.05f, 0.05f, 0.05f, 1.0f);
 		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+		// the model decides which palette layout (and so which vertex shader) it is skinned with
+		Shader &skinShader = ourModel.skinningMode == SKINNING_DUAL_QUATERNION ? dqShader : ourShader;
+
 		// don't forget to enable shader before setting uniforms
-		ourShader.use();
+		skinShader.use();
 
 		// view/projection transformations
 		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
 		glm::mat4 view = camera.GetViewMatrix();
-		ourShader.setMat4("projection", projection);
-		ourShader.setMat4("view", view);
+		skinShader.setMat4("projection", projection);
+		skinShader.setMat4("view", view);
 
-        auto transforms = animator.GetFinalBoneMatrices();
-		for (int i = 0; i < transforms.size(); ++i)
-			ourShader.setMat4("finalBonesMatrices[" + std::to_string(i) + "]", transforms[i]);
+		stream.BeginFrame();
+		upload_bone_palette(stream, ourModel, animator);
 
 
 		// render the loaded model
 		glm::mat4 model = glm::mat4(1.0f);
 		model = glm::translate(model, glm::vec3(0.0f, -0.4f, 0.0f)); // translate it down so it's at the center of the scene
 		model = glm::scale(model, glm::vec3(.5f, .5f, .5f));	// it's a bit too big for our scene, so scale it down
-		ourShader.setMat4("model", model);
-		ourModel.Draw(ourShader);
+		skinShader.setMat4("model", model);
+		ourModel.Draw(skinShader);
+		stream.EndFrame();
 
         SDL_GL_SwapBuffers();
         sleep();
@@ -223,6 +240,15 @@ void processInput(void)
     }
     else if(!keys[SDLK_q] && !keys[SDLK_e])
         anim_changed = 0;
+
+    // toggle between linear blend and dual quaternion skinning
+    if (keys[SDLK_m] && !skinning_changed)
+    {
+        model_ptr->skinningMode = model_ptr->skinningMode == SKINNING_LINEAR ? SKINNING_DUAL_QUATERNION : SKINNING_LINEAR;
+        skinning_changed = 1;
+    }
+    else if(!keys[SDLK_m])
+        skinning_changed = 0;
 }
 
 void sleep(void)
@@ -260,3 +286,24 @@ void change_animation(void)
     animator_ptr->set_animation(&animations[anim_number]);
 }
 
+// stream the whole bone palette, as matrices or as dual quaternions (half the size), and bind it to point 0
+void upload_bone_palette(StreamBuffer &stream, Model &model, Animator &animator)
+{
+    static GLint alignment = 0;
+    if (alignment == 0)
+        glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+
+    StreamAllocation palette;
+    if (model.skinningMode == SKINNING_DUAL_QUATERNION)
+    {
+        const std::vector<DualQuat>& dualQuats = animator.GetFinalBoneDualQuats();
+        palette = stream.Upload(&dualQuats[0], dualQuats.size() * sizeof(DualQuat), alignment);
+    }
+    else
+    {
+        std::vector<glm::mat4> transforms = animator.GetFinalBoneMatrices();
+        palette = stream.Upload(&transforms[0], transforms.size() * sizeof(glm::mat4), alignment);
+    }
+    if (palette.ptr)
+        glBindBufferRange(GL_UNIFORM_BUFFER, 0, stream.ID, palette.offset, palette.size);
+}
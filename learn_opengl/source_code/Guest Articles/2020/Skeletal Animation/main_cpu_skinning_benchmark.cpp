@@ -0,0 +1,121 @@
+// headless benchmark for cpu_skinning.h: needs no window, no GL context and no GPU
+
+#include "glm/glm.hpp"
+#include "glm/gtc/matrix_transform.hpp"
+
+#include "cpu_skinning.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+void build_test_mesh(std::vector<Vertex>& vertices, int vertexCount, int boneCount);
+void build_test_palette(std::vector<glm::mat4>& palette, int boneCount, float time);
+float max_reference_error(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette, const std::vector<glm::vec3>& positions);
+double run(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette, int threads, int iterations);
+
+// settings
+const int VERTEX_COUNT = 1000000;
+const int BONE_COUNT = 100;
+const int ITERATIONS = 20;
+
+int main(int argc, char *argv[])
+{
+    std::vector<Vertex> vertices;
+    std::vector<glm::mat4> palette;
+    build_test_mesh(vertices, VERTEX_COUNT, BONE_COUNT);
+    build_test_palette(palette, BONE_COUNT, 0.5f);
+
+    // validate against a straightforward glm implementation of anim_model.vs
+    // -------------------------------------------------------------------------
+    std::vector<glm::vec3> positions, normals;
+    SkinnedBounds bounds = CpuSkinning::Skin(vertices, palette, positions, normals);
+    std::cout << "max error vs reference: " << max_reference_error(vertices, palette, positions) << std::endl;
+    std::cout << "bounds: (" << bounds.min.x << ", " << bounds.min.y << ", " << bounds.min.z << ") - ("
+              << bounds.max.x << ", " << bounds.max.y << ", " << bounds.max.z << ")" << std::endl;
+
+    // throughput
+    // ----------
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    double single = run(vertices, palette, 1, ITERATIONS);
+    std::cout << "1 thread:  " << single << " Mverts/s" << std::endl;
+    if (cores > 1)
+    {
+        double multi = run(vertices, palette, cores, ITERATIONS);
+        std::cout << cores << " threads: " << multi << " Mverts/s (" << multi / cores << " Mverts/s per core)" << std::endl;
+    }
+    return 0;
+}
+
+// returns millions of vertices skinned per second
+// -----------------------------------------------
+double run(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette, int threads, int iterations)
+{
+    std::vector<glm::vec3> positions, normals;
+    CpuSkinning::Skin(vertices, palette, positions, normals, threads); // warm up, allocates the outputs
+
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++)
+        CpuSkinning::Skin(vertices, palette, positions, normals, threads);
+    std::chrono::duration<double> elapsed = std::chrono::high_resolution_clock::now() - start;
+
+    return (double)vertices.size() * iterations / elapsed.count() / 1e6;
+}
+
+// random vertices with 1 to 4 bone influences, weights summing to one
+// ----------------------------------------------------------------------
+void build_test_mesh(std::vector<Vertex>& vertices, int vertexCount, int boneCount)
+{
+    srand(1);
+    vertices.resize(vertexCount);
+    for (int v = 0; v < vertexCount; v++)
+    {
+        Vertex& vertex = vertices[v];
+        vertex.Position = glm::vec3(rand() % 2000 - 1000, rand() % 2000 - 1000, rand() % 2000 - 1000) * 0.001f;
+        vertex.Normal = glm::normalize(glm::vec3(rand() % 200 - 100, rand() % 200 - 100, rand() % 200 - 100) + glm::vec3(0.01f));
+        vertex.TexCoords = glm::vec2(0.0f);
+        vertex.Tangent = glm::vec3(0.0f);
+        vertex.Bitangent = glm::vec3(0.0f);
+
+        int influences = 1 + rand() % MAX_BONE_INFLUENCE;
+        float total = 0.0f;
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            vertex.m_BoneIDs[i] = i < influences ? rand() % boneCount : -1;
+            vertex.m_Weights[i] = i < influences ? 0.1f + (rand() % 100) * 0.01f : 0.0f;
+            total += vertex.m_Weights[i];
+        }
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+            vertex.m_Weights[i] /= total;
+    }
+}
+
+void build_test_palette(std::vector<glm::mat4>& palette, int boneCount, float time)
+{
+    palette.resize(boneCount);
+    for (int b = 0; b < boneCount; b++)
+    {
+        glm::mat4 bone = glm::translate(glm::mat4(1.0f), glm::vec3(0.0f, 0.05f * b, 0.0f));
+        bone = glm::rotate(bone, time * (1.0f + 0.1f * b), glm::normalize(glm::vec3(1.0f, 0.5f * b, 0.25f)));
+        palette[b] = bone;
+    }
+}
+
+float max_reference_error(const std::vector<Vertex>& vertices, const std::vector<glm::mat4>& palette, const std::vector<glm::vec3>& positions)
+{
+    float maxError = 0.0f;
+    for (unsigned int v = 0; v < vertices.size(); v++)
+    {
+        glm::vec4 total(0.0f);
+        for (int i = 0; i < MAX_BONE_INFLUENCE; i++)
+        {
+            if (vertices[v].m_BoneIDs[i] == -1)
+                continue;
+            total += palette[vertices[v].m_BoneIDs[i]] * glm::vec4(vertices[v].Position, 1.0f) * vertices[v].m_Weights[i];
+        }
+        maxError = std::max(maxError, glm::length(glm::vec3(total) - positions[v]));
+    }
+    return maxError;
+}
@@ -6,30 +6,19 @@
 #include "glm/gtc/type_ptr.hpp"
 
 #include <iostream>
-#include <map>
+#include <sstream>
 #include <string>
 
-#include <ft2build.h>
-#include FT_FREETYPE_H
-
 #include "shader.h"
+#include "gl_extensions.h"
+#include "stream_buffer.h"
+#include "text_renderer.h"
 
 #include "filesystem.h"
 
 void processInput(void);
 void sleep(void);
-void RenderText(Shader &shader, std::string text, float x, float y, float scale, glm::vec3 color);
-
-/// Holds all state information relevant to a character as loaded using FreeType
-struct Character {
-    unsigned int TextureID; // ID handle of the glyph texture
-    glm::ivec2   Size;      // Size of glyph
-    glm::ivec2   Bearing;   // Offset from baseline to left/top of glyph
-    unsigned int Advance;   // Horizontal offset to advance to next glyph
-};
-
-std::map<GLchar, Character> Characters;
-unsigned int VAO, VBO;
+void AddDebugOverlay(TextRenderer &text);
 
 // settings
 const unsigned int SCR_WIDTH = 640;
@@ -39,6 +28,10 @@ bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
 
+// debug overlay: fills the screen with text, still drawn with one call
+bool show_overlay = false;
+int overlay_changed = 0;
+
 int main(int argc, char *argv[])
 {
     SDL_Init(SDL_INIT_VIDEO);
@@ -52,6 +45,7 @@ int main(int argc, char *argv[])
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    glLoadExtensions((GLADloadproc)SDL_GL_GetProcAddress);
 
     // OpenGL state
     // ------------
@@ -65,16 +59,7 @@ int main(int argc, char *argv[])
     glm::mat4 projection = glm::ortho(0.0f, static_cast<float>(SCR_WIDTH), 0.0f, static_cast<float>(SCR_HEIGHT));
     shader.use();
     glUniformMatrix4fv(glGetUniformLocation(shader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
-
-    // FreeType
-    // --------
-    FT_Library ft;
-    // All functions return a value different than 0 whenever an error occurred
-    if (FT_Init_FreeType(&ft))
-    {
-        std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
-        return -1;
-    }
+    shader.setInt("text", 0);
 
 	// find path to font
     std::string font_name = FileSystem::getPath("resources/fonts/Antonio-Bold.ttf");
@@ -84,78 +69,36 @@ int main(int argc, char *argv[])
         return -1;
     }
 
-	// load font as face
-    FT_Face face;
-    if (FT_New_Face(ft, font_name.c_str(), 0, &face)) {
-        std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+    // FreeType: glyphs are turned into distance fields on worker threads the first time they are drawn
+    // -------------------------------------------------------------------------------------------------
+    TextRenderer text;
+    if (!text.Load(font_name))
         return -1;
-    }
-    else {
-        // set size to load glyphs as
-        FT_Set_Pixel_Sizes(face, 0, 48);
 
-        // disable byte-alignment restriction
-        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
-
-        // load first 128 characters of ASCII set
-        for (unsigned char c = 0; c < 128; c++)
-        {
-            // Load character glyph
-            if (FT_Load_Char(face, c, FT_LOAD_RENDER))
-            {
-                std::cout << "ERROR::FREETYTPE: Failed to load Glyph" << std::endl;
-                continue;
-            }
-            // generate texture
-            unsigned int texture;
-            glGenTextures(1, &texture);
-            glBindTexture(GL_TEXTURE_2D, texture);
-            glTexImage2D(
-                GL_TEXTURE_2D,
-                0,
-                GL_RED,
-                face->glyph->bitmap.width,
-                face->glyph->bitmap.rows,
-                0,
-                GL_RED,
-                GL_UNSIGNED_BYTE,
-                face->glyph->bitmap.buffer
-            );
-            // set texture options
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-            // now store character for later use
-            Character character = {
-                texture,
-                glm::ivec2(face->glyph->bitmap.width, face->glyph->bitmap.rows),
-                glm::ivec2(face->glyph->bitmap_left, face->glyph->bitmap_top),
-                static_cast<unsigned int>(face->glyph->advance.x)
-            };
-            Characters.insert(std::pair<char, Character>(c, character));
-        }
-        glBindTexture(GL_TEXTURE_2D, 0);
+    // the whole frame's text is streamed through one ring buffer region
+    // -----------------------------------------------------------------
+    StreamBuffer stream(1024 * 1024);
+
+    // static text is laid out once and redrawn from its cached quads; the overlay changes every frame
+    // and takes the immediate path
+    // ------------------------------------------------------------------------------------------------
+    TextLayout title, copyright, paragraph;
+    title.Set("This is sample text", 25.0f, 25.0f, 48.0f, glm::vec3(0.5, 0.8f, 0.2f));
+    copyright.Set("(C) LearnOpenGL.com", 540.0f, 570.0f, 24.0f, glm::vec3(0.3, 0.7f, 0.9f));
+    paragraph.Set("Retained layouts keep their kerned, wrapped quads between frames and are only laid out again "
+                  "when their text, size or position changes.", 25.0f, 420.0f, 20.0f, glm::vec3(0.9f), 400.0f);
+    // the same distance fields serve every size
+    TextLayout sizes[4];
+    float x = 25.0f, size = 12.0f;
+    for (int i = 0; i < 4; i++, size *= 2.0f)
+    {
+        sizes[i].Set("Gr\xC3\xB6\xC3\x9F" "e", x, 100.0f, size, glm::vec3(0.9f, 0.6f, 0.3f));
+        x += size * 2.5f;
     }
-    // destroy FreeType once we're finished
-    FT_Done_Face(face);
-    FT_Done_FreeType(ft);
-
-
-    // configure VAO/VBO for texture quads
-    // -----------------------------------
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
 
     // render loop
     // -----------
+    unsigned int lastReport = SDL_GetTicks();
     while (main_loop)
     {
         // input
@@ -167,8 +110,25 @@ int main(int argc, char *argv[])
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        RenderText(shader, "This is sample text", 25.0f, 25.0f, 1.0f, glm::vec3(0.5, 0.8f, 0.2f));
-        RenderText(shader, "(C) LearnOpenGL.com", 540.0f, 570.0f, 0.5f, glm::vec3(0.3, 0.7f, 0.9f));
+        stream.BeginFrame();
+        text.AddText(title);
+        text.AddText(copyright);
+        text.AddText(paragraph);
+        for (int i = 0; i < 4; i++)
+            text.AddText(sizes[i]);
+        if (show_overlay)
+            AddDebugOverlay(text);
+        text.Flush(shader, stream);
+        stream.EndFrame();
+
+        if (SDL_GetTicks() - lastReport > 1000)
+        {
+            std::cout << "text draw calls: " << text.drawCalls << " streamed: " << stream.stats.bytesLastFrame << " bytes"
+                      << " | glyphs resident: " << text.stats.resident << " pending: " << text.stats.pending
+                      << " generated: " << text.stats.generated << " evicted: " << text.stats.evictions
+                      << " | layouts built: " << text.stats.layouts << std::endl;
+            lastReport = SDL_GetTicks();
+        }
 
         SDL_GL_SwapBuffers();
         sleep();
@@ -200,6 +160,15 @@ void processInput(void)
 
     if(keys[SDLK_ESCAPE])
         main_loop = 0;
+
+    // O toggles the full-screen debug overlay
+    if (keys[SDLK_o] && !overlay_changed)
+    {
+        show_overlay = !show_overlay;
+        overlay_changed = 1;
+    }
+    else if (!keys[SDLK_o])
+        overlay_changed = 0;
 }
 
 void sleep(void)
@@ -217,50 +186,18 @@ void sleep(void)
     }
 }
 
-// render line of text
-// -------------------
-void RenderText(Shader &shader, std::string text, float x, float y, float scale, glm::vec3 color)
+// fill the screen with lines of small text, the kind of load a stats overlay puts on the renderer
+// -------------------------------------------------------------------------------------------------
+void AddDebugOverlay(TextRenderer &text)
 {
-    // activate corresponding render state
-    shader.use();
-    glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
-    glActiveTexture(GL_TEXTURE0);
-    glBindVertexArray(VAO);
-
-    // iterate through all characters
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++)
+    const float size = 12.0f;
+    const float lineHeight = size;
+    int line = 0;
+    for (float y = SCR_HEIGHT - lineHeight; y > 0.0f; y -= lineHeight, line++)
     {
-        Character ch = Characters[*c];
-
-        float xpos = x + ch.Bearing.x * scale;
-        float ypos = y - (ch.Size.y - ch.Bearing.y) * scale;
-
-        float w = ch.Size.x * scale;
-        float h = ch.Size.y * scale;
-        // update VBO for each character
-        float vertices[6][4] = {
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos,     ypos,       0.0f, 1.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-
-            { xpos,     ypos + h,   0.0f, 0.0f },
-            { xpos + w, ypos,       1.0f, 1.0f },
-            { xpos + w, ypos + h,   1.0f, 0.0f }
-        };
-        // render glyph texture over quad
-        glBindTexture(GL_TEXTURE_2D, ch.TextureID);
-        // update content of VBO memory
-        glBindBuffer(GL_ARRAY_BUFFER, VBO);
-        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices); // be sure to use glBufferSubData and not glBufferData
-
-        glBindBuffer(GL_ARRAY_BUFFER, 0);
-        // render quad
-        glDrawArrays(GL_TRIANGLES, 0, 6);
-        // now advance cursors for next glyph (note that advance is number of 1/64 pixels)
-        x += (ch.Advance >> 6) * scale; // bitshift by 6 to get value in pixels (2^6 = 64 (divide amount of 1/64th pixels by 64 to get amount of pixels))
+        std::ostringstream row;
+        row << "line " << line << "  ticks " << SDL_GetTicks() << "  the quick brown fox jumps over the lazy dog 0123456789";
+        float shade = 0.5f + 0.5f * (line % 4) / 3.0f;
+        text.AddText(row.str(), 5.0f, y, size, glm::vec3(shade, 1.0f, 1.0f - shade * 0.5f));
     }
-    glBindVertexArray(0);
-    glBindTexture(GL_TEXTURE_2D, 0);
 }
-
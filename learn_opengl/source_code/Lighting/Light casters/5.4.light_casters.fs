@@ -7,19 +7,23 @@ struct Material {
     float shininess;
 }; 
 
+// std140: each vec3 shares its 16 bytes with the float after it (LightData in the main_*.cpp samples)
 struct Light {
-    vec3 position;  
+    vec3 position;
+    float constant;
     vec3 direction;
-    float cutOff;
-    float outerCutOff;
-  
+    float linear;
     vec3 ambient;
+    float quadratic;
     vec3 diffuse;
+    float cutOff;
     vec3 specular;
-	
-    float constant;
-    float linear;
-    float quadratic;
+    float outerCutOff;
+};
+
+layout (std140) uniform Lights
+{
+    Light light;
 };
 
 in vec3 FragPos;  
@@ -28,7 +32,6 @@ in vec2 TexCoords;
   
 uniform vec3 viewPos;
 uniform Material material;
-uniform Light light;
 
 void main()
 {
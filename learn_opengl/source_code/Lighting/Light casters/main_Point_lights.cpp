@@ -10,6 +10,7 @@
 
 #include "shader_m.h"
 #include "camera.h"
+#include "uniform_buffer.h"
 #include "filesystem.h"
 
 #include <iostream>
@@ -35,6 +36,20 @@ float lastFrame = 0.0f;
 // lighting
 glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
+// the std140 Lights block of the light casters shaders: each vec3 shares its 16 bytes with the float after it
+struct LightData {
+    glm::vec3 position;
+    float constant;
+    glm::vec3 direction;
+    float linear;
+    glm::vec3 ambient;
+    float quadratic;
+    glm::vec3 diffuse;
+    float cutOff;
+    glm::vec3 specular;
+    float outerCutOff;
+};
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -158,6 +173,21 @@ int main(int argc, char *argv[])
     lightingShader.use();
     lightingShader.setInt("material.diffuse", 0);
     lightingShader.setInt("material.specular", 1);
+    lightingShader.setFloat("material.shininess", 32.0f);
+
+    // light properties, in a uniform buffer object that is only written when the light changes
+    UniformArrayBuffer<LightData> lights(1);
+    UniformArrayBuffer<LightData>::BindBlock(lightingShader.ID, "Lights", 0);
+    LightData light = {};
+    light.position = lightPos;
+    light.ambient = glm::vec3(0.2f, 0.2f, 0.2f);
+    light.diffuse = glm::vec3(0.5f, 0.5f, 0.5f);
+    light.specular = glm::vec3(1.0f, 1.0f, 1.0f);
+    light.constant = 1.0f;
+    light.linear = 0.09f;
+    light.quadratic = 0.032f;
+    lights.Set(0, light);
+    lights.Update();
 
 
     // render loop
@@ -181,19 +211,8 @@ int main(int argc, char *argv[])
 
         // be sure to activate shader when setting uniforms/drawing objects
         lightingShader.use();
-        lightingShader.setVec3("light.position", lightPos);
         lightingShader.setVec3("viewPos", camera.Position);
-
-        // light properties
-        lightingShader.setVec3("light.ambient", 0.2f, 0.2f, 0.2f);
-        lightingShader.setVec3("light.diffuse", 0.5f, 0.5f, 0.5f);
-        lightingShader.setVec3("light.specular", 1.0f, 1.0f, 1.0f);
-        lightingShader.setFloat("light.constant", 1.0f);
-        lightingShader.setFloat("light.linear", 0.09f);
-        lightingShader.setFloat("light.quadratic", 0.032f);
-
-        // material properties
-        lightingShader.setFloat("material.shininess", 32.0f);
+        lights.Bind(0);
 
         // view/projection transformations
         glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
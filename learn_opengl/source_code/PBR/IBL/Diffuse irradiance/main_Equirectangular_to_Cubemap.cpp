@@ -9,6 +9,7 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "hdr_decoder.h"
 
 #include <iostream>
 
@@ -103,22 +104,19 @@ int main(int argc, char *argv[])
 
     // pbr: load the HDR environment map
     // ---------------------------------
-    stbi_set_flip_vertically_on_load(true);
-    int width, height, nrComponents;
-    float *data = stbi_loadf(FileSystem::getPath("resources/textures/hdr/newport_loft.hdr").c_str(), &width, &height, &nrComponents, 0);
-    unsigned int hdrTexture;
-    if (data)
+    // decoded a band of scanlines at a time, on every core, straight into RGB9_E5 (4 bytes a pixel, and exact for
+    // RGBE): the image never exists as floats in memory
+    unsigned int decodeStart = SDL_GetTicks();
+    HDRDecoder hdrDecoder;
+    unsigned int hdrTexture = hdrDecoder.LoadTexture(FileSystem::getPath("resources/textures/hdr/newport_loft.hdr").c_str(), HDR_RGB9_E5);
+    if (hdrTexture)
     {
-        glGenTextures(1, &hdrTexture);
-        glBindTexture(GL_TEXTURE_2D, hdrTexture);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, data); // note how we specify the texture's data value to be float
-
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-        stbi_image_free(data);
+        std::cout << hdrDecoder.width << "x" << hdrDecoder.height << " HDR image decoded in " << SDL_GetTicks() - decodeStart << " ms, "
+                  << hdrDecoder.BufferBytes(HDR_RGB9_E5) / 1024 << " KB held while decoding" << std::endl;
     }
     else
     {
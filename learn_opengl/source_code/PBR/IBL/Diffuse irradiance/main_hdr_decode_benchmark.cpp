@@ -0,0 +1,150 @@
+// headless benchmark for hdr_decoder.h: needs no window, no GL context and no GPU. Decodes the .hdr file given as the
+// first argument (main_Equirectangular_to_Cubemap.cpp's by default) with stb_image and with HDRDecoder, checks every
+// pixel of both formats against stb_image's floats and compares time and memory. The exit code is 1 on a mismatch
+
+#include "glad.h" // only for the texture format enums
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "filesystem.h"
+#include "hdr_decoder.h"
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <thread>
+#include <cstring>
+#include <cmath>
+
+bool check(const char *path, HDRPixelFormat format, const float *reference);
+double decodeTime(const char *path, HDRPixelFormat format, int threads, int iterations, size_t &bufferBytes);
+float fromHalf(unsigned short half);
+
+// settings
+const int ITERATIONS = 5;
+
+int main(int argc, char *argv[])
+{
+    std::string path = argc > 1 ? std::string(argv[1]) : FileSystem::getPath("resources/textures/hdr/newport_loft.hdr");
+
+    // stb_image, as the sample used to load it
+    // ------------------------------------------
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, nrComponents;
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    float *data = stbi_loadf(path.c_str(), &width, &height, &nrComponents, 3);
+    std::chrono::duration<double, std::milli> stbTime = std::chrono::high_resolution_clock::now() - start;
+    if (!data)
+    {
+        std::cout << "Failed to load HDR image." << std::endl;
+        return -1;
+    }
+    double pixels = (double)width * height;
+    std::cout << width << "x" << height << ", stbi_loadf: " << stbTime.count() << " ms, " << pixels * 12.0 / (1024 * 1024)
+              << " MB of floats" << std::endl;
+
+    // every pixel against stb_image's
+    // ---------------------------------
+    bool pass = check(path.c_str(), HDR_RGB9_E5, data) & check(path.c_str(), HDR_RGB16F, data);
+    stbi_image_free(data);
+
+    // time and memory, on one thread (no pool, nothing overlaps) and on every core (at least two, so the file is read
+    // while the previous band is converted)
+    // ----------------------------------------------------------------------------------------------------------------
+    int cores = std::max(1, (int)std::thread::hardware_concurrency());
+    int threads = std::max(2, cores);
+    std::cout << cores << " hardware threads" << std::endl;
+    HDRPixelFormat formats[] = { HDR_RGB9_E5, HDR_RGB16F };
+    const char *names[] = { "RGB9_E5", "RGB16F" };
+    for (int f = 0; f < 2; f++)
+    {
+        size_t bufferBytes = 0;
+        double single = decodeTime(path.c_str(), formats[f], 1, ITERATIONS, bufferBytes);
+        double parallel = decodeTime(path.c_str(), formats[f], threads, ITERATIONS, bufferBytes);
+        std::cout << names[f] << ": 1 thread " << single << " ms, " << threads << " threads " << parallel << " ms ("
+                  << single / parallel << "x), " << bufferBytes / 1024.0 << " KB held while decoding, " << pixels * HDRDecoder::BytesPerPixel(formats[f]) / (1024 * 1024)
+                  << " MB as a texture" << std::endl;
+    }
+    return pass ? 0 : 1;
+}
+
+// decodes the whole image in format and compares it with stb_image's floats: RGB9_E5 must match exactly within its
+// range and half floats to their precision
+// ------------------------------------------------------------------------------------------------------------------
+bool check(const char *path, HDRPixelFormat format, const float *reference)
+{
+    HDRDecoder decoder;
+    if (!decoder.Open(path))
+        return false;
+    std::vector<float> decoded((size_t)decoder.width * decoder.height * 3);
+    int width = decoder.width;
+    bool read = decoder.Decode(format, true, [&](int firstRow, int rowCount, const unsigned char *pixels) {
+        for (size_t i = 0; i < (size_t)rowCount * width; i++)
+        {
+            float *rgb = &decoded[((size_t)firstRow * width + i) * 3];
+            if (format == HDR_RGB9_E5)
+            {
+                unsigned int packed;
+                std::memcpy(&packed, pixels + i * 4, 4);
+                float scale = std::ldexp(1.0f, (int)(packed >> 27) - 24);
+                for (int c = 0; c < 3; c++)
+                    rgb[c] = ((packed >> (9 * c)) & 511) * scale;
+            }
+            else
+            {
+                unsigned short half[3];
+                std::memcpy(half, pixels + i * 6, 6);
+                for (int c = 0; c < 3; c++)
+                    rgb[c] = fromHalf(half[c]);
+            }
+        }
+    });
+    if (!read)
+        return false;
+
+    // the spacing of the format's values around each one: 2^-24 below RGB9_E5's range, half a half's last bit
+    size_t mismatches = 0;
+    float maxError = 0.0f;
+    for (size_t i = 0; i < decoded.size(); i++)
+    {
+        float expected = std::min(reference[i], format == HDR_RGB9_E5 ? 65408.0f : 65504.0f);
+        float error = std::abs(decoded[i] - expected);
+        float tolerance = format == HDR_RGB9_E5 ? std::ldexp(1.0f, -24) : std::max(expected * std::ldexp(1.0f, -11), std::ldexp(1.0f, -25));
+        if (error > tolerance)
+            mismatches++;
+        if (expected > 1e-3f)
+            maxError = std::max(maxError, error / expected);
+    }
+    std::cout << (format == HDR_RGB9_E5 ? "RGB9_E5" : "RGB16F") << " vs stbi_loadf: max relative error " << maxError << ", "
+              << mismatches << " values out of tolerance" << std::endl;
+    return mismatches == 0;
+}
+
+// the best of iterations decodes, with the bands thrown away as they come
+// -------------------------------------------------------------------------
+double decodeTime(const char *path, HDRPixelFormat format, int threads, int iterations, size_t &bufferBytes)
+{
+    double best = 1e30;
+    for (int i = 0; i < iterations; i++)
+    {
+        HDRDecoder decoder(threads);
+        std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+        if (!decoder.Open(path) || !decoder.Decode(format, true, [](int, int, const unsigned char*) {}))
+            return 0.0;
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+        best = std::min(best, elapsed.count());
+        bufferBytes = decoder.BufferBytes(format);
+    }
+    return best;
+}
+
+float fromHalf(unsigned short half)
+{
+    int exponent = (half >> 10) & 31;
+    int mantissa = half & 1023;
+    if (exponent == 0)
+        return std::ldexp((float)mantissa, -24);
+    return std::ldexp((float)(mantissa | 1024), exponent - 25);
+}
@@ -3,10 +3,11 @@ out vec4 FragColor;
 in vec3 WorldPos;
 
 uniform samplerCube environmentMap;
+uniform mat3 environmentRotation; // world space directions to the environment's
 
 void main()
 {		
-    vec3 envColor = textureLod(environmentMap, WorldPos, 0.0).rgb;
+    vec3 envColor = textureLod(environmentMap, environmentRotation * WorldPos, 0.0).rgb;
     
     // HDR tonemap and gamma correct
     envColor = envColor / (envColor + vec3(1.0));
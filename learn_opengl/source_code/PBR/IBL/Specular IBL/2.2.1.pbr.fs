@@ -11,9 +11,15 @@ uniform float roughness;
 uniform float ao;
 
 // IBL
-uniform samplerCube irradianceMap;
+// irradiance / PI as 9 spherical harmonics coefficients, rgb, with the basis functions' constants and the cosine
+// lobe already folded in (SHIrradiance in sh_irradiance.h)
+layout (std140) uniform SHIrradiance
+{
+    vec4 shCoefficients[9];
+};
 uniform samplerCube prefilterMap;
 uniform sampler2D brdfLUT;
+uniform mat3 environmentRotation; // world space directions to the environment's
 
 // lights
 uniform vec3 lightPositions[4];
@@ -23,6 +29,16 @@ uniform vec3 camPos;
 
 const float PI = 3.14159265359;
 // ----------------------------------------------------------------------------
+vec3 IrradianceSH(vec3 n)
+{
+    vec3 irradiance = shCoefficients[0].rgb
+                    + shCoefficients[1].rgb * n.y + shCoefficients[2].rgb * n.z + shCoefficients[3].rgb * n.x
+                    + shCoefficients[4].rgb * (n.x * n.y) + shCoefficients[5].rgb * (n.y * n.z)
+                    + shCoefficients[6].rgb * (3.0 * n.z * n.z - 1.0) + shCoefficients[7].rgb * (n.x * n.z)
+                    + shCoefficients[8].rgb * (n.x * n.x - n.y * n.y);
+    return max(irradiance, vec3(0.0));
+}
+// ----------------------------------------------------------------------------
 float DistributionGGX(vec3 N, vec3 H, float roughness)
 {
     float a = roughness*roughness;
@@ -124,12 +140,12 @@ void main()
     vec3 kD = 1.0 - kS;
     kD *= 1.0 - metallic;	  
     
-    vec3 irradiance = texture(irradianceMap, N).rgb;
+    vec3 irradiance = IrradianceSH(N);
     vec3 diffuse      = irradiance * albedo;
     
     // sample both the pre-filter map and the BRDF lut and combine them together as per the Split-Sum approximation to get the IBL specular part.
     const float MAX_REFLECTION_LOD = 4.0;
-    vec3 prefilteredColor = textureLod(prefilterMap, R,  roughness * MAX_REFLECTION_LOD).rgb;    
+    vec3 prefilteredColor = textureLod(prefilterMap, environmentRotation * R,  roughness * MAX_REFLECTION_LOD).rgb;    
     vec2 brdf  = texture(brdfLUT, vec2(max(dot(N, V), 0.0), roughness)).rg;
     vec3 specular = prefilteredColor * (F * brdf.x + brdf.y);
 
@@ -0,0 +1,22 @@
+#ifndef IBL_CACHE_KEYS_H
+#define IBL_CACHE_KEYS_H
+
+#include "ibl_cache.h"
+
+#include <string>
+
+// what each precomputed map of main_textured.cpp is derived from: the HDR image, the shader sources and the sizes.
+// main_ibl_baker.cpp bakes the same maps on the CPU and stores them under the same keys, so the sample finds them.
+// The prefilter map is derived from the environment map, so its key builds on that one
+struct SpecularIBLKeys {
+    ContentHash environment, prefilter, brdfLUT;
+
+    SpecularIBLKeys(const std::string &hdrPath)
+    {
+        environment.AddFile(hdrPath).AddFile("2.2.1.cubemap.vs").AddFile("2.2.1.equirectangular_to_cubemap.fs").AddString("512");
+        prefilter = environment;
+        prefilter.AddFile("2.2.1.prefilter.fs").AddString("128 5");
+        brdfLUT.AddFile("2.2.1.brdf.vs").AddFile("2.2.1.brdf.fs").AddString("512");
+    }
+};
+#endif
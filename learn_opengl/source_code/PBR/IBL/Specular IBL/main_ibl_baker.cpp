@@ -0,0 +1,240 @@
+// headless IBL baker: main_textured.cpp's environment and prefiltered cube maps and BRDF lookup table, baked on the
+// CPU and written to the cache files the sample loads on startup. Needs no window, no GL context and no GPU. The
+// irradiance map is baked too, as the reference the spherical harmonics irradiance is measured against. The first
+// argument, if any, is the number of threads to use; the exit code is 1 when the maps stray from what the shaders
+// compute by more than the tolerances below
+
+#include "glad.h" // only for the texture format enums
+
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+
+#include "glm/glm.hpp"
+
+#include "filesystem.h"
+#include "ibl_baker.h"
+#include "sh_irradiance.h"
+#include "ibl_cache_keys.h"
+
+#include <iostream>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <cstdlib>
+
+double elapsedSince(std::chrono::high_resolution_clock::time_point start);
+glm::vec3 irradianceReference(const IBLBaker &baker, const glm::vec3 &N);
+glm::vec3 prefilterReference(const IBLBaker &baker, const glm::vec3 &N, float roughness);
+glm::vec2 brdfReference(float NdotV, float roughness);
+float relativeError(const glm::vec3 &value, const glm::vec3 &reference);
+glm::vec3 randomTexel(const CubeMapLevel &level, int &face, int &x, int &y);
+
+// settings: the sizes main_textured.cpp renders the maps at
+const int ENVIRONMENT_SIZE = 512;
+const int IRRADIANCE_SIZE = 32;
+const int PREFILTER_SIZE = 128;
+const int PREFILTER_LEVELS = 5;
+const int BRDF_LUT_SIZE = 512;
+
+// the largest error against the shaders' own formulas, relative to the reference value, that still passes. The
+// prefilter's 256 filtered samples land a few percent from the shader's 1024 around the bright windows
+const float IRRADIANCE_TOLERANCE = 0.03f;
+const float PREFILTER_TOLERANCE = 0.08f;
+const float BRDF_LUT_TOLERANCE = 0.002f;
+const int CHECKED_TEXELS = 48;
+
+int main(int argc, char *argv[])
+{
+    int threads = argc > 1 ? std::atoi(argv[1]) : 0;
+    if (threads <= 0)
+        threads = std::max(1, (int)std::thread::hardware_concurrency());
+
+    // load the HDR environment map, bottom row first like the sample
+    // -----------------------------------------------------------------
+    std::string hdrPath = FileSystem::getPath("newport_loft.hdr");
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, nrComponents;
+    float *data = stbi_loadf(hdrPath.c_str(), &width, &height, &nrComponents, 0);
+    if (!data)
+    {
+        std::cout << "Failed to load HDR image." << std::endl;
+        return -1;
+    }
+
+    // bake
+    // ----
+    IBLBaker baker(threads);
+    std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+    baker.BakeEnvironment(data, width, height, nrComponents, ENVIRONMENT_SIZE);
+    double environmentTime = elapsedSince(start);
+    stbi_image_free(data);
+
+    start = std::chrono::high_resolution_clock::now();
+    baker.BakeIrradiance(IRRADIANCE_SIZE);
+    double irradianceTime = elapsedSince(start);
+
+    // what main_textured.cpp does instead of an irradiance map, from the same level
+    SHIrradiance shIrradiance(threads);
+    start = std::chrono::high_resolution_clock::now();
+    shIrradiance.Project(baker.environment[4]); // 512 >> 4
+    double shTime = elapsedSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    baker.BakePrefilter(PREFILTER_SIZE, PREFILTER_LEVELS);
+    double prefilterTime = elapsedSince(start);
+
+    start = std::chrono::high_resolution_clock::now();
+    baker.BakeBRDFLUT(BRDF_LUT_SIZE);
+    double brdfTime = elapsedSince(start);
+
+    std::cout << threads << " threads: environment " << environmentTime << " ms, irradiance " << irradianceTime << " ms, SH irradiance "
+              << shTime << " ms, prefilter "
+              << prefilterTime << " ms, BRDF LUT " << brdfTime << " ms" << std::endl;
+
+    // check random texels against the shaders' formulas, evaluated here at full sample counts
+    // -----------------------------------------------------------------------------------------
+    srand(1);
+    float irradianceError = 0.0f, prefilterError = 0.0f, brdfError = 0.0f, shError = 0.0f;
+    for (int i = 0; i < CHECKED_TEXELS; i++)
+    {
+        int face, x, y;
+        glm::vec3 value = randomTexel(baker.irradiance[0], face, x, y);
+        glm::vec3 N = glm::normalize(IBLBaker::FaceDirection(face, (x + 0.5f) / IRRADIANCE_SIZE * 2.0f - 1.0f, (y + 0.5f) / IRRADIANCE_SIZE * 2.0f - 1.0f));
+        irradianceError = std::max(irradianceError, relativeError(value, irradianceReference(baker, N)));
+        shError = std::max(shError, relativeError(shIrradiance.Evaluate(N), value));
+
+        int mip = i % PREFILTER_LEVELS;
+        const CubeMapLevel &level = baker.prefilter[mip];
+        value = randomTexel(level, face, x, y);
+        N = glm::normalize(IBLBaker::FaceDirection(face, (x + 0.5f) / level.size * 2.0f - 1.0f, (y + 0.5f) / level.size * 2.0f - 1.0f));
+        prefilterError = std::max(prefilterError, relativeError(value, prefilterReference(baker, N, (float)mip / (PREFILTER_LEVELS - 1))));
+
+        x = rand() % BRDF_LUT_SIZE;
+        y = rand() % BRDF_LUT_SIZE;
+        glm::vec2 reference = brdfReference((x + 0.5f) / BRDF_LUT_SIZE, (y + 0.5f) / BRDF_LUT_SIZE);
+        const float *lut = &baker.brdfLUT[(y * BRDF_LUT_SIZE + x) * 2];
+        brdfError = std::max(brdfError, std::max(std::abs(lut[0] - reference.x), std::abs(lut[1] - reference.y)));
+    }
+    bool pass = irradianceError <= IRRADIANCE_TOLERANCE && prefilterError <= PREFILTER_TOLERANCE && brdfError <= BRDF_LUT_TOLERANCE;
+    std::cout << "max error vs the shaders: irradiance " << irradianceError << ", prefilter " << prefilterError << ", BRDF LUT "
+              << brdfError << (pass ? "" : " - OUT OF TOLERANCE") << std::endl;
+    // 9 coefficients can't follow the irradiance exactly: this only shows how far they are from the map they replace
+    std::cout << "max error of the SH irradiance vs the irradiance map: " << shError << std::endl;
+
+    // write the maps where main_textured.cpp looks for them
+    // -------------------------------------------------------
+    IBLCache iblCache;
+    SpecularIBLKeys iblKeys(hdrPath);
+    std::vector<std::vector<char> > levels;
+    for (unsigned int i = 0; i < baker.environment.size(); i++)
+        levels.push_back(IBLCache::PackHalf(&baker.environment[i].texels[0], 3, baker.environment[i].size, baker.environment[i].size, 6));
+    iblCache.Write("environment", iblKeys.environment, GL_TEXTURE_CUBE_MAP, GL_RGB16F, ENVIRONMENT_SIZE, ENVIRONMENT_SIZE, levels);
+
+    levels.clear();
+    for (unsigned int i = 0; i < baker.prefilter.size(); i++)
+        levels.push_back(IBLCache::PackHalf(&baker.prefilter[i].texels[0], 3, baker.prefilter[i].size, baker.prefilter[i].size, 6));
+    iblCache.Write("prefilter", iblKeys.prefilter, GL_TEXTURE_CUBE_MAP, GL_RGB16F, PREFILTER_SIZE, PREFILTER_SIZE, levels);
+
+    levels.assign(1, IBLCache::PackHalf(&baker.brdfLUT[0], 2, BRDF_LUT_SIZE, BRDF_LUT_SIZE, 1));
+    iblCache.Write("brdf_lut", iblKeys.brdfLUT, GL_TEXTURE_2D, GL_RG16F, BRDF_LUT_SIZE, BRDF_LUT_SIZE, levels);
+    std::cout << iblCache.saved << " of 3 maps written" << std::endl;
+
+    return pass && iblCache.saved == 3 ? 0 : 1;
+}
+
+double elapsedSince(std::chrono::high_resolution_clock::time_point start)
+{
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::high_resolution_clock::now() - start;
+    return elapsed.count();
+}
+
+// 2.2.1.irradiance_convolution.fs, reading the level its implicit derivatives pick across a 32 texel face
+// ---------------------------------------------------------------------------------------------------------
+glm::vec3 irradianceReference(const IBLBaker &baker, const glm::vec3 &N)
+{
+    const float PI = 3.14159265359f;
+    float lod = std::log2((float)ENVIRONMENT_SIZE / IRRADIANCE_SIZE);
+    glm::vec3 up(0.0f, 1.0f, 0.0f);
+    glm::vec3 right = glm::normalize(glm::cross(up, N));
+    up = glm::normalize(glm::cross(N, right));
+
+    glm::vec3 irradiance(0.0f);
+    float sampleDelta = 0.025f;
+    float nrSamples = 0.0f;
+    for (float phi = 0.0f; phi < 2.0f * PI; phi += sampleDelta)
+    {
+        for (float theta = 0.0f; theta < 0.5f * PI; theta += sampleDelta)
+        {
+            glm::vec3 tangentSample(std::sin(theta) * std::cos(phi), std::sin(theta) * std::sin(phi), std::cos(theta));
+            glm::vec3 sampleVec = tangentSample.x * right + tangentSample.y * up + tangentSample.z * N;
+            irradiance += baker.SampleEnvironment(sampleVec, lod) * std::cos(theta) * std::sin(theta);
+            nrSamples++;
+        }
+    }
+    return PI * irradiance * (1.0f / nrSamples);
+}
+
+// 2.2.1.prefilter.fs, 1024 samples
+// --------------------------------
+glm::vec3 prefilterReference(const IBLBaker &baker, const glm::vec3 &N, float roughness)
+{
+    const unsigned int SAMPLE_COUNT = 1024u;
+    glm::vec3 prefilteredColor(0.0f);
+    float totalWeight = 0.0f;
+    for (unsigned int i = 0u; i < SAMPLE_COUNT; ++i)
+    {
+        glm::vec3 H = IBLBaker::ImportanceSampleGGX(IBLBaker::Hammersley(i, SAMPLE_COUNT), N, roughness);
+        glm::vec3 L = glm::normalize(2.0f * glm::dot(N, H) * H - N);
+        float NdotL = std::max(glm::dot(N, L), 0.0f);
+        if (NdotL > 0.0f)
+        {
+            float NdotH = std::max(glm::dot(N, H), 0.0f);
+            float mipLevel = roughness == 0.0f ? 0.0f : IBLBaker::SampleLod(NdotH, roughness, SAMPLE_COUNT, ENVIRONMENT_SIZE);
+            prefilteredColor += baker.SampleEnvironment(L, mipLevel) * NdotL;
+            totalWeight += NdotL;
+        }
+    }
+    return prefilteredColor / totalWeight;
+}
+
+// 2.2.1.brdf.fs, one sample at a time
+// -----------------------------------
+glm::vec2 brdfReference(float NdotV, float roughness)
+{
+    glm::vec3 V(std::sqrt(1.0f - NdotV * NdotV), 0.0f, NdotV);
+    glm::vec3 N(0.0f, 0.0f, 1.0f);
+    float k = (roughness * roughness) / 2.0f;
+    float A = 0.0f, B = 0.0f;
+    const unsigned int SAMPLE_COUNT = 1024u;
+    for (unsigned int i = 0u; i < SAMPLE_COUNT; ++i)
+    {
+        glm::vec3 H = IBLBaker::ImportanceSampleGGX(IBLBaker::Hammersley(i, SAMPLE_COUNT), N, roughness);
+        glm::vec3 L = glm::normalize(2.0f * glm::dot(V, H) * H - V);
+        float NdotL = std::max(L.z, 0.0f);
+        float NdotH = std::max(H.z, 0.0f);
+        float VdotH = std::max(glm::dot(V, H), 0.0f);
+        if (NdotL > 0.0f)
+        {
+            float G = (NdotV / (NdotV * (1.0f - k) + k)) * (NdotL / (NdotL * (1.0f - k) + k));
+            float G_Vis = (G * VdotH) / (NdotH * NdotV);
+            float Fc = std::pow(1.0f - VdotH, 5.0f);
+            A += (1.0f - Fc) * G_Vis;
+            B += Fc * G_Vis;
+        }
+    }
+    return glm::vec2(A, B) / float(SAMPLE_COUNT);
+}
+
+float relativeError(const glm::vec3 &value, const glm::vec3 &reference)
+{
+    return glm::length(value - reference) / std::max(glm::length(reference), 1e-4f);
+}
+
+glm::vec3 randomTexel(const CubeMapLevel &level, int &face, int &x, int &y)
+{
+    face = rand() % 6;
+    x = rand() % level.size;
+    y = rand() % level.size;
+    const float *texel = level.Texel(face, x, y);
+    return glm::vec3(texel[0], texel[1], texel[2]);
+}
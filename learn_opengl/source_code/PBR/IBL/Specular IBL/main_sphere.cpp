@@ -9,6 +9,8 @@
 #include "camera.h"
 #include "model.h"
 #include "filesystem.h"
+#include "sh_irradiance.h"
+#include "uniform_buffer.h"
 
 #include <iostream>
 
@@ -38,6 +40,9 @@ bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
 
+// the environment's turn about y, in radians; Q and E turn it
+float environmentAngle = 0.0f;
+
 int main(int argc, char *argv[])
 {
     SDL_Init(SDL_INIT_VIDEO);
@@ -64,13 +69,11 @@ int main(int argc, char *argv[])
     // -------------------------
     Shader pbrShader("2.2.1.pbr.vs", "2.2.1.pbr.fs");
     Shader equirectangularToCubemapShader("2.2.1.cubemap.vs", "2.2.1.equirectangular_to_cubemap.fs");
-    Shader irradianceShader("2.2.1.cubemap.vs", "2.2.1.irradiance_convolution.fs");
     Shader prefilterShader("2.2.1.cubemap.vs", "2.2.1.prefilter.fs");
     Shader brdfShader("2.2.1.brdf.vs", "2.2.1.brdf.fs");
     Shader backgroundShader("2.2.1.background.vs", "2.2.1.background.fs");
 
     pbrShader.use();
-    pbrShader.setInt("irradianceMap", 0);
     pbrShader.setInt("prefilterMap", 1);
     pbrShader.setInt("brdfLUT", 2);
     pbrShader.setVec3("albedo", 0.5f, 0.0f, 0.0f);
@@ -186,44 +189,17 @@ int main(int argc, char *argv[])
     glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
     glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
 
-    // pbr: create an irradiance cubemap, and re-scale capture FBO to irradiance scale.
-    // --------------------------------------------------------------------------------
-    unsigned int irradianceMap;
-    glGenTextures(1, &irradianceMap);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB16F, 32, 32, 0, GL_RGB, GL_FLOAT, nullptr);
-    }
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    glBindRenderbuffer(GL_RENDERBUFFER, captureRBO);
-    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, 32, 32);
-
-    // pbr: solve diffuse integral by convolution to create an irradiance (cube)map.
-    // -----------------------------------------------------------------------------
-    irradianceShader.use();
-    irradianceShader.setInt("environmentMap", 0);
-    irradianceShader.setMat4("projection", captureProjection);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-
-    glViewport(0, 0, 32, 32); // don't forget to configure the viewport to the capture dimensions.
-    glBindFramebuffer(GL_FRAMEBUFFER, captureFBO);
-    for (unsigned int i = 0; i < 6; ++i)
-    {
-        irradianceShader.setMat4("view", captureViews[i]);
-        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, irradianceMap, 0);
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    // pbr: project the irradiance onto 9 spherical harmonics coefficients, from the environment's 32x32 mip level.
+    // The level is read back once; turning the environment projects it again, at a few microseconds a time
+    // -------------------------------------------------------------------------------------------------------------
+    CubeMapLevel environmentTexels;
+    SHIrradiance::ReadBack(envCubemap, 4, environmentTexels); // 512 >> 4
+    SHIrradiance shIrradiance(1); // 6144 texels take well under a millisecond, not worth starting threads every frame
+    shIrradiance.Project(environmentTexels);
+    float projectedAngle = 0.0f;
 
-        renderCube();
-    }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    UniformArrayBuffer<glm::vec4> shBuffer(9);
+    UniformArrayBuffer<glm::vec4>::BindBlock(pbrShader.ID, "SHIrradiance", 0);
 
     // pbr: create a pre-filter cubemap, and re-scale capture FBO to pre-filter scale.
     // --------------------------------------------------------------------------------
@@ -335,16 +311,29 @@ int main(int argc, char *argv[])
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        // render scene, supplying the convoluted irradiance map to the final shader.
+        // turn the irradiance with the environment. Set() only marks the coefficients that changed, so a frame in
+        // which the environment stood still uploads nothing
+        // ---------------------------------------------------------------------------------------------------------
+        glm::mat3 environmentToWorld = glm::mat3(glm::rotate(glm::mat4(1.0f), environmentAngle, glm::vec3(0.0f, 1.0f, 0.0f)));
+        if (environmentAngle != projectedAngle)
+        {
+            shIrradiance.Project(environmentTexels, environmentToWorld);
+            projectedAngle = environmentAngle;
+        }
+        for (unsigned int i = 0; i < 9; i++)
+            shBuffer.Set(i, shIrradiance.coefficients[i]);
+        shBuffer.Update();
+        shBuffer.Bind(0);
+
+        // render scene, supplying the irradiance coefficients to the final shader.
         // ------------------------------------------------------------------------------------------
         pbrShader.use();
         glm::mat4 view = camera.GetViewMatrix();
         pbrShader.setMat4("view", view);
         pbrShader.setVec3("camPos", camera.Position);
+        pbrShader.setMat3("environmentRotation", glm::transpose(environmentToWorld));
 
         // bind pre-computed IBL data
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap);
         glActiveTexture(GL_TEXTURE1);
         glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap);
         glActiveTexture(GL_TEXTURE2);
@@ -395,9 +384,9 @@ int main(int argc, char *argv[])
         // render skybox (render as last to prevent overdraw)
         backgroundShader.use();
         backgroundShader.setMat4("view", view);
+        backgroundShader.setMat3("environmentRotation", glm::transpose(environmentToWorld));
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_CUBE_MAP, envCubemap);
-        //glBindTexture(GL_TEXTURE_CUBE_MAP, irradianceMap); // display irradiance map
         //glBindTexture(GL_TEXTURE_CUBE_MAP, prefilterMap); // display prefilter map
         renderCube();
 
@@ -480,6 +469,11 @@ void processInput(void)
     else if(keys[SDLK_d])
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
+    if(keys[SDLK_q])
+        environmentAngle -= 0.001f * deltaTime;
+    else if(keys[SDLK_e])
+        environmentAngle += 0.001f * deltaTime;
+
     if(keys[SDLK_UP])
         camera.ProcessMouseMovement(0, 10);
     else if(keys[SDLK_DOWN])
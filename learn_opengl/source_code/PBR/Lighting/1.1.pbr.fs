@@ -4,15 +4,32 @@ in vec2 TexCoords;
 in vec3 WorldPos;
 in vec3 Normal;
 
-// material parameters
-uniform vec3 albedo;
-uniform float metallic;
-uniform float roughness;
-uniform float ao;
+// material parameters, one std140 entry per sphere (MaterialData in main_PBR_shader.cpp)
+struct Material {
+    vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+    vec2 padding;
+};
+layout (std140) uniform Materials
+{
+    Material materials[49];
+};
+uniform int materialIndex;
 
 // lights
-uniform vec3 lightPositions[4];
-uniform vec3 lightColors[4];
+// std140: each vec3 padded to 16 bytes (LightData on the C++ side)
+struct Light {
+    vec3 position;
+    float padding0;
+    vec3 color;
+    float padding1;
+};
+layout (std140) uniform Lights
+{
+    Light lights[4];
+};
 
 uniform vec3 camPos;
 
@@ -60,6 +77,11 @@ vec3 fresnelSchlick(float cosTheta, vec3 F0)
 // ----------------------------------------------------------------------------
 void main()
 {		
+    vec3 albedo = materials[materialIndex].albedo;
+    float metallic = materials[materialIndex].metallic;
+    float roughness = materials[materialIndex].roughness;
+    float ao = materials[materialIndex].ao;
+
     vec3 N = normalize(Normal);
     vec3 V = normalize(camPos - WorldPos);
 
@@ -73,11 +95,11 @@ void main()
     for(int i = 0; i < 4; ++i) 
     {
         // calculate per-light radiance
-        vec3 L = normalize(lightPositions[i] - WorldPos);
+        vec3 L = normalize(lights[i].position - WorldPos);
         vec3 H = normalize(V + L);
-        float distance = length(lightPositions[i] - WorldPos);
+        float distance = length(lights[i].position - WorldPos);
         float attenuation = 1.0 / (distance * distance);
-        vec3 radiance = lightColors[i] * attenuation;
+        vec3 radiance = lights[i].color * attenuation;
 
         // Cook-Torrance BRDF
         float NDF = DistributionGGX(N, H, roughness);   
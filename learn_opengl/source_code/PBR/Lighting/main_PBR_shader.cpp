@@ -8,6 +8,7 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "uniform_buffer.h"
 #include "filesystem.h"
 
 #include <iostream>
@@ -32,6 +33,23 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
+// one element of the std140 Lights block in the pbr shaders
+struct LightData {
+    glm::vec3 position;
+    float padding0;
+    glm::vec3 color;
+    float padding1;
+};
+
+// one element of the std140 Materials block in 1.1.pbr.fs
+struct MaterialData {
+    glm::vec3 albedo;
+    float metallic;
+    float roughness;
+    float ao;
+    glm::vec2 padding;
+};
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -59,8 +77,6 @@ int main(int argc, char *argv[])
     Shader shader("1.1.pbr.vs", "1.1.pbr.fs");
 
     shader.use();
-    shader.setVec3("albedo", 0.5f, 0.0f, 0.0f);
-    shader.setFloat("ao", 1.0f);
 
     // lights
     // ------
@@ -80,6 +96,28 @@ int main(int argc, char *argv[])
     int nrColumns = 7;
     float spacing = 2.5;
 
+    // lights and materials live in uniform buffer objects: Update() only sends what changed since the last frame
+    UniformArrayBuffer<LightData> lights(4);
+    UniformArrayBuffer<LightData>::BindBlock(shader.ID, "Lights", 0);
+    UniformArrayBuffer<MaterialData> materials(nrRows * nrColumns);
+    UniformArrayBuffer<MaterialData>::BindBlock(shader.ID, "Materials", 1);
+    // one material per sphere, with varying metallic/roughness values scaled by rows and columns respectively
+    for (int row = 0; row < nrRows; ++row)
+    {
+        for (int col = 0; col < nrColumns; ++col)
+        {
+            MaterialData material = {};
+            material.albedo = glm::vec3(0.5f, 0.0f, 0.0f);
+            material.ao = 1.0f;
+            material.metallic = (float)row / (float)nrRows;
+            // we clamp the roughness to 0.05 - 1.0 as perfectly smooth surfaces (roughness of 0.0) tend to look a bit off
+            // on direct lighting.
+            material.roughness = glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f);
+            materials.Set(row * nrColumns + col, material);
+        }
+    }
+    materials.Update();
+
     // initialize static shader uniforms before rendering
     // --------------------------------------------------
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
@@ -110,16 +148,27 @@ int main(int argc, char *argv[])
         shader.setMat4("view", view);
         shader.setVec3("camPos", camera.Position);
 
-        // render rows*column number of spheres with varying metallic/roughness values scaled by rows and columns respectively
+        // update the lights before anything is drawn with them
+        for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+        {
+            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin((timer+=0.1) * 5.0) * 5.0, 0.0, 0.0);
+            newPos = lightPositions[i];
+            LightData light = {};
+            light.position = newPos;
+            light.color = lightColors[i];
+            lights.Set(i, light);
+        }
+        lights.Update();
+        lights.Bind(0);
+        materials.Bind(1);
+
+        // render rows*column number of spheres, each with its own material
         glm::mat4 model = glm::mat4(1.0f);
         for (int row = 0; row < nrRows; ++row)
         {
-            shader.setFloat("metallic", (float)row / (float)nrRows);
             for (int col = 0; col < nrColumns; ++col)
             {
-                // we clamp the roughness to 0.05 - 1.0 as perfectly smooth surfaces (roughness of 0.0) tend to look a bit off
-                // on direct lighting.
-                shader.setFloat("roughness", glm::clamp((float)col / (float)nrColumns, 0.05f, 1.0f));
+                shader.setInt("materialIndex", row * nrColumns + col);
 
                 model = glm::mat4(1.0f);
                 model = glm::translate(model, glm::vec3(
@@ -136,15 +185,10 @@ int main(int argc, char *argv[])
         // render light source (simply re-render sphere at light positions)
         // this looks a bit off as we use the same shader, but it'll make their positions obvious and
         // keeps the codeprint small.
-        for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+        for (unsigned int i = 0; i < lights.Size(); ++i)
         {
-            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin((timer+=0.1) * 5.0) * 5.0, 0.0, 0.0);
-            newPos = lightPositions[i];
-            shader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-            shader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
-
             model = glm::mat4(1.0f);
-            model = glm::translate(model, newPos);
+            model = glm::translate(model, lights[i].position);
             model = glm::scale(model, glm::vec3(0.5f));
             shader.setMat4("model", model);
             shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
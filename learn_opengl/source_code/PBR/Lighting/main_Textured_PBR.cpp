@@ -8,6 +8,7 @@
 #include "shader.h"
 #include "camera.h"
 #include "model.h"
+#include "uniform_buffer.h"
 #include "filesystem.h"
 
 #include <iostream>
@@ -32,6 +33,14 @@ bool firstMouse = true;
 float deltaTime = 0.0f;	// time between current frame and last frame
 float lastFrame = 0.0f;
 
+// one element of the std140 Lights block in the pbr shaders
+struct LightData {
+    glm::vec3 position;
+    float padding0;
+    glm::vec3 color;
+    float padding1;
+};
+
 bool main_loop = true;
 SDL_Event event;
 Uint8* keys;
@@ -85,6 +94,10 @@ int main(int argc, char *argv[])
     int nrColumns = 7;
     float spacing = 2.5;
 
+    // the lights live in a uniform buffer object: Update() only sends what changed since the last frame
+    UniformArrayBuffer<LightData> lights(4);
+    UniformArrayBuffer<LightData>::BindBlock(shader.ID, "Lights", 0);
+
     // initialize static shader uniforms before rendering
     // --------------------------------------------------
     glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
@@ -115,6 +128,19 @@ int main(int argc, char *argv[])
         shader.setMat4("view", view);
         shader.setVec3("camPos", camera.Position);
 
+        // update the lights before anything is drawn with them
+        for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+        {
+            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin((timer+=0.1) * 5.0) * 5.0, 0.0, 0.0);
+            newPos = lightPositions[i];
+            LightData light = {};
+            light.position = newPos;
+            light.color = lightColors[i];
+            lights.Set(i, light);
+        }
+        lights.Update();
+        lights.Bind(0);
+
         glActiveTexture(GL_TEXTURE0);
         glBindTexture(GL_TEXTURE_2D, albedo);
         glActiveTexture(GL_TEXTURE1);
@@ -147,15 +173,10 @@ int main(int argc, char *argv[])
         // render light source (simply re-render sphere at light positions)
         // this looks a bit off as we use the same shader, but it'll make their positions obvious and
         // keeps the codeprint small.
-        for (unsigned int i = 0; i < sizeof(lightPositions) / sizeof(lightPositions[0]); ++i)
+        for (unsigned int i = 0; i < lights.Size(); ++i)
         {
-            glm::vec3 newPos = lightPositions[i] + glm::vec3(sin((timer+=0.1) * 5.0) * 5.0, 0.0, 0.0);
-            newPos = lightPositions[i];
-            shader.setVec3("lightPositions[" + std::to_string(i) + "]", newPos);
-            shader.setVec3("lightColors[" + std::to_string(i) + "]", lightColors[i]);
-
             model = glm::mat4(1.0f);
-            model = glm::translate(model, newPos);
+            model = glm::translate(model, lights[i].position);
             model = glm::scale(model, glm::vec3(0.5f));
             shader.setMat4("model", model);
             shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
@@ -0,0 +1,193 @@
+#ifndef STATIC_BATCH_H
+#define STATIC_BATCH_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include "mesh.h"
+#include "shader.h"
+#include "gl_extensions.h"
+#include "gl_state.h"
+
+#include <vector>
+#include <map>
+#include <iostream>
+
+// Packs the geometry of many static meshes that share the Vertex layout, a program and a texture set
+// into one VBO/EBO and draws all of them with a single glMultiDrawElementsIndirect.
+//
+// Each draw gets an ID through an instanced vertex attribute (location 7, divisor 1) that the
+// indirect command's baseInstance points at. The vertex shader uses it to fetch its model matrix
+// and material index from a buffer texture: 5 RGBA32F texels per draw, the 4 matrix columns then
+// (material, 0, 0, 0). Without multi draw indirect the same buffers are drawn in a loop.
+class StaticBatch
+{
+public:
+    unsigned int submitCalls; // GL draw calls issued by the last Draw()
+
+    StaticBatch() : submitCalls(0), VAO(0), VBO(0), EBO(0), drawIdBuffer(0), indirectBuffer(0), transformBuffer(0), transformTexture(0)
+    {
+    }
+
+    // adds one draw of mesh; geometry shared between draws is only stored once. The batch binds one texture set
+    // for every draw, the first mesh's: a mesh with other textures is refused and false returned
+    bool Add(const Mesh &mesh, const glm::mat4 &model, unsigned int material = 0)
+    {
+        std::map<const Mesh*, DrawElementsIndirectCommand>::iterator it = geometry.find(&mesh);
+        if (it == geometry.end())
+        {
+            if (geometry.empty())
+                textures = mesh.textures;
+            else if (!sameTextures(mesh.textures))
+            {
+                std::cout << "ERROR::STATIC_BATCH: mesh textures differ from the batch's, batch it separately" << std::endl;
+                return false;
+            }
+            DrawElementsIndirectCommand range;
+            range.count = static_cast<GLuint>(mesh.indices.size());
+            range.instanceCount = 1;
+            range.firstIndex = static_cast<GLuint>(indices.size());
+            range.baseVertex = static_cast<GLint>(vertices.size());
+            range.baseInstance = 0;
+            vertices.insert(vertices.end(), mesh.vertices.begin(), mesh.vertices.end());
+            indices.insert(indices.end(), mesh.indices.begin(), mesh.indices.end());
+            it = geometry.insert(std::make_pair(&mesh, range)).first;
+        }
+
+        DrawElementsIndirectCommand command = it->second;
+        command.baseInstance = static_cast<GLuint>(commands.size());
+        commands.push_back(command);
+
+        for (int i = 0; i < 4; i++)
+            drawData.push_back(model[i]);
+        drawData.push_back(glm::vec4(static_cast<float>(material), 0.0f, 0.0f, 0.0f));
+        return true;
+    }
+
+    // uploads everything added so far; the batch is immutable afterwards. An empty batch creates nothing
+    void Build()
+    {
+        if (commands.empty())
+            return;
+        std::vector<GLuint> drawIds(commands.size());
+        for (unsigned int i = 0; i < drawIds.size(); i++)
+            drawIds[i] = i;
+
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glGenBuffers(1, &drawIdBuffer);
+        glGenBuffers(1, &transformBuffer);
+        glGenTextures(1, &transformTexture);
+
+        glState().BindVertexArray(VAO);
+        glState().BindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices[0], GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+
+        // same attribute layout as Mesh::setupMesh
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Normal));
+        glEnableVertexAttribArray(2);
+        glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, TexCoords));
+        glEnableVertexAttribArray(3);
+        glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Tangent));
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, Bitangent));
+
+        // draw ID: one value per "instance", selected by baseInstance
+        glState().BindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+        glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(GLuint), &drawIds[0], GL_STATIC_DRAW);
+        glEnableVertexAttribArray(7);
+        glVertexAttribIPointer(7, 1, GL_UNSIGNED_INT, sizeof(GLuint), (void*)0);
+        glVertexAttribDivisor(7, 1);
+        glState().BindVertexArray(0);
+
+        // per-draw transforms and materials
+        glState().BindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+        glBufferData(GL_TEXTURE_BUFFER, drawData.size() * sizeof(glm::vec4), &drawData[0], GL_STATIC_DRAW);
+        glState().BindTexture(0, GL_TEXTURE_BUFFER, transformTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer);
+        glState().BindTexture(0, GL_TEXTURE_BUFFER, 0);
+        glState().BindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        if (glExt().multiDrawIndirect)
+        {
+            glGenBuffers(1, &indirectBuffer);
+            glState().BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawElementsIndirectCommand), &commands[0], GL_STATIC_DRAW);
+        }
+
+        // the CPU copies of the geometry aren't needed any more
+        std::vector<Vertex>().swap(vertices);
+        std::vector<unsigned int>().swap(indices);
+        std::vector<glm::vec4>().swap(drawData);
+    }
+
+    // draws the whole batch. The shader reads its transforms from a samplerBuffer bound to transformUnit,
+    // the batch's textures go to units 0..n-1 like Mesh::Draw.
+    void Draw(Shader &shader, unsigned int transformUnit = 15)
+    {
+        if (commands.empty())
+            return;
+
+        shader.use();
+        for (unsigned int i = 0; i < textures.size(); i++)
+            glState().BindTexture(i, GL_TEXTURE_2D, textures[i].id);
+        glState().BindTexture(transformUnit, GL_TEXTURE_BUFFER, transformTexture);
+        glState().Uniform1i(glGetUniformLocation(shader.ID, "drawData"), transformUnit);
+
+        glState().BindVertexArray(VAO);
+        if (glExt().multiDrawIndirect)
+        {
+            glState().BindBuffer(GL_DRAW_INDIRECT_BUFFER, indirectBuffer);
+            glExt().MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)0, static_cast<GLsizei>(commands.size()), 0);
+            submitCalls = 1;
+        }
+        else
+        {
+            // no baseInstance in 3.3: feed the draw ID as a constant attribute instead
+            glDisableVertexAttribArray(7);
+            for (unsigned int i = 0; i < commands.size(); i++)
+            {
+                const DrawElementsIndirectCommand &command = commands[i];
+                glVertexAttribI1ui(7, command.baseInstance);
+                glDrawElementsBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT,
+                                         (void*)(command.firstIndex * sizeof(unsigned int)), command.baseVertex);
+            }
+            glEnableVertexAttribArray(7);
+            submitCalls = static_cast<unsigned int>(commands.size());
+        }
+        if (!glState().Enabled())
+        {
+            glState().BindVertexArray(0);
+            glState().ActiveTexture(0);
+        }
+    }
+
+    unsigned int DrawCount() const { return static_cast<unsigned int>(commands.size()); }
+
+private:
+    unsigned int VAO, VBO, EBO, drawIdBuffer, indirectBuffer, transformBuffer, transformTexture;
+    std::vector<Vertex> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<glm::vec4> drawData;
+    std::vector<Texture> textures;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::map<const Mesh*, DrawElementsIndirectCommand> geometry;
+
+    bool sameTextures(const std::vector<Texture> &other) const
+    {
+        if (other.size() != textures.size())
+            return false;
+        for (unsigned int i = 0; i < other.size(); i++)
+            if (other[i].id != textures[i].id)
+                return false;
+        return true;
+    }
+};
+#endif
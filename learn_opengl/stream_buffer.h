@@ -0,0 +1,181 @@
+#ifndef STREAM_BUFFER_H
+#define STREAM_BUFFER_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "gl_extensions.h"
+#include "gl_state.h"
+
+#include <vector>
+#include <cstring>
+#include <iostream>
+#include <chrono>
+
+// one sub-allocation of the current frame's region
+struct StreamAllocation {
+    void *ptr;          // write the data here, then Commit() it
+    GLintptr offset;    // byte offset inside StreamBuffer::ID, for glBindBufferRange / attribute offsets
+    GLsizeiptr size;
+};
+
+struct StreamBufferStats {
+    unsigned int stalls;      // frames that had to wait for the GPU before reusing a region
+    unsigned int stallTimeMs; // total time spent waiting in those frames
+    unsigned int orphans;     // fallback path only: times the buffer was orphaned instead of waiting
+    unsigned int failedAllocations; // Allocate() calls that found the frame's region full
+    GLsizeiptr bytesLastFrame;
+};
+
+// Ring allocator for per-frame dynamic data (vertices, uniform blocks, instance data, bone palettes).
+//
+// The buffer is split into framesInFlight regions; each frame sub-allocates linearly from its own
+// region and fences it at EndFrame, so the GPU can still read the previous frames' data while the
+// CPU writes the next. With ARB_buffer_storage the whole buffer stays persistently mapped and Commit()
+// is a no-op. Otherwise each allocation is mapped unsynchronized (the fences already guarantee the
+// range is free) and a region whose fence hasn't signaled yet gets the buffer orphaned, not waited on.
+class StreamBuffer
+{
+public:
+    unsigned int ID;
+    StreamBufferStats stats;
+
+    // regionSize is the most one frame can allocate
+    StreamBuffer(GLsizeiptr regionSize, int framesInFlight = 3) : ID(0), regionSize(regionSize), regionCount(framesInFlight),
+        region(0), head(0), mapped(NULL), persistent(false), inFrame(false), warned(false)
+    {
+        stats.stalls = stats.stallTimeMs = stats.orphans = stats.failedAllocations = 0;
+        stats.bytesLastFrame = 0;
+        fences.assign(regionCount, (GLsync)0);
+
+        glGenBuffers(1, &ID);
+        glState().BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+        GLsizeiptr total = regionSize * regionCount;
+        if (glExt().bufferStorage)
+        {
+            GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+            glExt().BufferStorage(GL_COPY_WRITE_BUFFER, total, NULL, flags);
+            mapped = (unsigned char *)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, total, flags);
+            persistent = mapped != NULL;
+        }
+        if (!persistent)
+            glBufferData(GL_COPY_WRITE_BUFFER, total, NULL, GL_STREAM_DRAW);
+    }
+
+    bool Persistent() const { return persistent; }
+
+    // moves on to the next region, waiting for the GPU only if it is still reading it
+    void BeginFrame()
+    {
+        region = (region + 1) % regionCount;
+        head = 0;
+        inFrame = true;
+        warned = false;
+
+        GLsync fence = fences[region];
+        if (!fence)
+            return;
+        fences[region] = 0;
+
+        GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+        if (status == GL_ALREADY_SIGNALED || status == GL_CONDITION_SATISFIED)
+        {
+            glDeleteSync(fence);
+            return;
+        }
+
+        if (!persistent)
+        {
+            // the GPU keeps the old storage alive for as long as it needs it
+            glState().BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glBufferData(GL_COPY_WRITE_BUFFER, regionSize * regionCount, NULL, GL_STREAM_DRAW);
+            stats.orphans++;
+            for (int i = 0; i < regionCount; i++)
+            {
+                if (fences[i])
+                    glDeleteSync(fences[i]);
+                fences[i] = 0;
+            }
+            glDeleteSync(fence);
+            return;
+        }
+
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (status == GL_TIMEOUT_EXPIRED)
+            status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000); // 1 ms
+        stats.stalls++;
+        stats.stallTimeMs += static_cast<unsigned int>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count());
+        glDeleteSync(fence);
+    }
+
+    // alignment must be a power of two (GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT for uniform blocks).
+    // Returns ptr == NULL when the frame's region is full; that is reported once a frame and counted in stats.
+    StreamAllocation Allocate(GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        StreamAllocation allocation;
+        allocation.ptr = NULL;
+        allocation.size = size;
+        GLsizeiptr start = (head + alignment - 1) & ~(alignment - 1);
+        allocation.offset = region * regionSize + start;
+        if (!inFrame || start + size > regionSize)
+        {
+            stats.failedAllocations++;
+            if (!warned)
+                std::cout << "ERROR::STREAM_BUFFER: frame region of " << regionSize << " bytes is full" << std::endl;
+            warned = true;
+            return allocation;
+        }
+        head = start + size;
+
+        if (persistent)
+            allocation.ptr = mapped + allocation.offset;
+        else
+        {
+            glState().BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            allocation.ptr = glMapBufferRange(GL_COPY_WRITE_BUFFER, allocation.offset, size,
+                                              GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        }
+        return allocation;
+    }
+
+    // makes the written data visible to the GPU; must happen before the draw that reads it
+    void Commit(const StreamAllocation &allocation)
+    {
+        if (!persistent && allocation.ptr)
+        {
+            glState().BindBuffer(GL_COPY_WRITE_BUFFER, ID);
+            glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        }
+    }
+
+    // allocate + copy + commit in one go
+    StreamAllocation Upload(const void *data, GLsizeiptr size, GLsizeiptr alignment = 16)
+    {
+        StreamAllocation allocation = Allocate(size, alignment);
+        if (allocation.ptr)
+        {
+            std::memcpy(allocation.ptr, data, size);
+            Commit(allocation);
+        }
+        return allocation;
+    }
+
+    // fences the frame's region once all draws reading it have been issued
+    void EndFrame()
+    {
+        fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        stats.bytesLastFrame = head;
+        inFrame = false;
+    }
+
+private:
+    GLsizeiptr regionSize;
+    int regionCount;
+    int region;
+    GLsizeiptr head;
+    unsigned char *mapped;
+    bool persistent;
+    bool inFrame;
+    bool warned; // the region filled up this frame and it was reported
+    std::vector<GLsync> fences;
+};
+#endif
@@ -0,0 +1,696 @@
+#ifndef TEXT_RENDERER_H
+#define TEXT_RENDERER_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include "glm/glm.hpp"
+
+#include <ft2build.h>
+#include FT_FREETYPE_H
+#include FT_ADVANCES_H
+
+#include "shader.h"
+#include "gl_state.h"
+#include "stream_buffer.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <deque>
+#include <unordered_map>
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <cmath>
+#include <cstddef>
+#include <iostream>
+
+#define SDF_BASE_SIZE 32   // em size, in atlas pixels, every glyph is stored at
+#define SDF_SPREAD 4       // distance range, in atlas pixels, on either side of the outline
+#define SDF_UPSCALE 4      // the outline is rasterized this much larger before the distance transform
+#define SDF_CELL 64        // atlas slot size; glyphs larger than a cell are cropped
+#define SDF_ATLAS_SIZE 1024
+
+/// Holds all state information relevant to a glyph, in atlas pixels (scale by size / SDF_BASE_SIZE)
+struct Glyph {
+    glm::vec2    Size;      // Size of the distance field, spread included
+    glm::vec2    Bearing;   // Offset from baseline to left/top of the distance field
+    float        Advance;   // Horizontal offset to advance to next glyph
+    glm::vec2    UVMin;     // atlas rectangle
+    glm::vec2    UVMax;
+};
+
+// distance field of one glyph, produced by a worker thread
+struct GlyphBitmap {
+    unsigned int codepoint;
+    int width, height;
+    Glyph metrics;
+    std::vector<unsigned char> pixels; // 0.5 on the outline, 1.0 SDF_SPREAD pixels inside
+};
+
+// one corner of a glyph quad, color packed as 4 normalized bytes
+struct TextVertex {
+    float x, y;
+    float u, v;
+    unsigned char r, g, b, a;
+};
+
+struct TextRendererStats {
+    unsigned int resident;    // glyphs holding an atlas cell
+    unsigned int pending;     // glyphs requested but not generated yet
+    unsigned int generated;   // distance fields built since startup
+    unsigned int evictions;   // glyphs dropped from the atlas to make room
+    unsigned int layouts;     // TextLayouts (re)built since startup
+};
+
+// one code point known to the glyph cache
+struct GlyphEntry {
+    Glyph metrics;
+    unsigned int index;                    // FreeType glyph index, for kerning
+    int cell;                              // atlas cell, -1 while pending or for blank glyphs
+    bool pending;                          // still being generated
+    unsigned int lastUsed;                 // frame the glyph was last drawn in
+    std::list<unsigned int>::iterator lru; // position in the resident list, valid while cell >= 0
+};
+
+// A retained string: laid out once (kerning, line breaks, size) into cached quads that
+// TextRenderer::AddText(TextLayout&) copies into the frame's batch. It is laid out again only when
+// Set() changes something or a glyph it uses moved in the atlas, so static labels cost a copy per frame.
+class TextLayout
+{
+public:
+    TextLayout() : x(0.0f), y(0.0f), size(0.0f), maxWidth(0.0f), color(0.0f), dirty(true), missing(0), uploadVersion(0), evictVersion(0)
+    {
+    }
+
+    // maxWidth > 0 wraps lines at spaces; '\n' always starts a new line
+    void Set(const std::string &text, float x, float y, float size, glm::vec3 color, float maxWidth = 0.0f)
+    {
+        if (text == this->text && x == this->x && y == this->y && size == this->size && color == this->color && maxWidth == this->maxWidth)
+            return;
+        this->text = text;
+        this->x = x;
+        this->y = y;
+        this->size = size;
+        this->color = color;
+        this->maxWidth = maxWidth;
+        dirty = true;
+    }
+
+    const std::string &Text() const { return text; }
+
+private:
+    friend class TextRenderer;
+
+    std::string text;
+    float x, y, size, maxWidth;
+    glm::vec3 color;
+    bool dirty;
+    unsigned int missing;                // glyphs that were still pending when laid out
+    unsigned int uploadVersion, evictVersion;
+    std::vector<TextVertex> vertices;
+    std::vector<GlyphEntry*> glyphs;     // touched every frame so the atlas keeps them
+};
+
+// squared 1D Euclidean distance transform of f (Felzenszwalb & Huttenlocher), v/z are scratch space
+inline void DistanceTransform1D(const float *f, float *d, int *v, float *z, int n)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -1e20f;
+    z[1] = 1e20f;
+    for (int q = 1; q < n; q++)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2 * q - 2 * v[k]);
+        }
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = 1e20f;
+    }
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q)
+            k++;
+        d[q] = (q - v[k]) * (q - v[k]) + f[v[k]];
+    }
+}
+
+// squared distance from every pixel to the nearest pixel with grid value 0, in place
+inline void DistanceTransform2D(std::vector<float> &grid, int width, int height)
+{
+    int n = std::max(width, height);
+    std::vector<float> f(n), d(n), z(n + 1);
+    std::vector<int> v(n);
+    for (int x = 0; x < width; x++)
+    {
+        for (int y = 0; y < height; y++)
+            f[y] = grid[y * width + x];
+        DistanceTransform1D(&f[0], &d[0], &v[0], &z[0], height);
+        for (int y = 0; y < height; y++)
+            grid[y * width + x] = d[y];
+    }
+    for (int y = 0; y < height; y++)
+    {
+        DistanceTransform1D(&grid[y * width], &d[0], &v[0], &z[0], width);
+        std::copy(d.begin(), d.begin() + width, grid.begin() + y * width);
+    }
+}
+
+// rasterizes codepoint SDF_UPSCALE times larger than SDF_BASE_SIZE and turns it into a distance field
+// at SDF_BASE_SIZE. face must already be sized with FT_Set_Pixel_Sizes(face, 0, SDF_BASE_SIZE * SDF_UPSCALE).
+inline bool GenerateGlyphSDF(FT_Face face, unsigned int codepoint, GlyphBitmap &out)
+{
+    out.codepoint = codepoint;
+    out.width = out.height = 0;
+    out.pixels.clear();
+    out.metrics.Size = out.metrics.Bearing = glm::vec2(0.0f);
+    out.metrics.Advance = 0.0f;
+    if (FT_Load_Char(face, codepoint, FT_LOAD_RENDER | FT_LOAD_NO_HINTING))
+        return false;
+    const FT_Bitmap &bitmap = face->glyph->bitmap;
+    const float up = static_cast<float>(SDF_UPSCALE);
+    out.metrics.Advance = face->glyph->advance.x / 64.0f / up;
+    if (bitmap.width == 0 || bitmap.rows == 0)
+        return true; // blank glyph (space): advance only
+
+    // pad the outline by the spread and round the high resolution size up to whole atlas pixels
+    const int pad = SDF_SPREAD * SDF_UPSCALE;
+    out.width = std::min((static_cast<int>(bitmap.width) + 2 * pad + SDF_UPSCALE - 1) / SDF_UPSCALE, SDF_CELL - 1);
+    out.height = std::min((static_cast<int>(bitmap.rows) + 2 * pad + SDF_UPSCALE - 1) / SDF_UPSCALE, SDF_CELL - 1);
+    out.metrics.Size = glm::vec2(out.width, out.height);
+    out.metrics.Bearing = glm::vec2(face->glyph->bitmap_left / up - SDF_SPREAD, face->glyph->bitmap_top / up + SDF_SPREAD);
+
+    int w = out.width * SDF_UPSCALE, h = out.height * SDF_UPSCALE;
+    std::vector<float> toInside(w * h), toOutside(w * h);
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+        {
+            int bx = x - pad, by = y - pad;
+            bool inside = bx >= 0 && by >= 0 && bx < static_cast<int>(bitmap.width) && by < static_cast<int>(bitmap.rows) &&
+                          bitmap.buffer[by * bitmap.pitch + bx] > 127;
+            toInside[y * w + x] = inside ? 0.0f : 1e20f;
+            toOutside[y * w + x] = inside ? 1e20f : 0.0f;
+        }
+    DistanceTransform2D(toInside, w, h);
+    DistanceTransform2D(toOutside, w, h);
+
+    // box filter every SDF_UPSCALE x SDF_UPSCALE block down to one atlas pixel
+    out.pixels.resize(out.width * out.height);
+    const float range = 2.0f * SDF_SPREAD * SDF_UPSCALE;
+    for (int y = 0; y < out.height; y++)
+        for (int x = 0; x < out.width; x++)
+        {
+            float sum = 0.0f;
+            for (int sy = 0; sy < SDF_UPSCALE; sy++)
+                for (int sx = 0; sx < SDF_UPSCALE; sx++)
+                {
+                    int i = (y * SDF_UPSCALE + sy) * w + x * SDF_UPSCALE + sx;
+                    sum += std::sqrt(toOutside[i]) - std::sqrt(toInside[i]);
+                }
+            float distance = sum / (SDF_UPSCALE * SDF_UPSCALE);
+            float value = glm::clamp(0.5f + distance / range, 0.0f, 1.0f);
+            out.pixels[y * out.width + x] = static_cast<unsigned char>(value * 255.0f + 0.5f);
+        }
+    return true;
+}
+
+// Batched signed distance field text.
+//
+// Glyphs are generated on first use, on worker threads, at one base size and drawn at any size from
+// the same distance field. They live in fixed SDF_CELL cells of one atlas texture; once the atlas is
+// full the least recently used glyph that isn't on screen this frame gives its cell up, so memory
+// stays bounded however many sizes and code points are used. A glyph still being generated is
+// skipped (its advance is already known) and shows up a frame or two later.
+//
+// Every string drawn during a frame is appended to one vertex list, so the whole frame's text costs
+// one buffer upload and one draw.
+class TextRenderer
+{
+public:
+    unsigned int AtlasID;
+    unsigned int drawCalls; // draws issued by the last Flush()
+    TextRendererStats stats;
+
+    TextRenderer() : AtlasID(0), drawCalls(0), ft(NULL), face(NULL), lineHeight(0.0f), VAO(0), frame(0),
+        uploadVersion(0), evictVersion(0), stopping(false)
+    {
+        std::fill(latin1Known, latin1Known + 256, false);
+        stats.resident = stats.pending = stats.generated = stats.evictions = stats.layouts = 0;
+    }
+
+    // only joins the workers and frees FreeType; the GL objects die with the context
+    ~TextRenderer()
+    {
+        {
+            std::lock_guard<std::mutex> lock(jobMutex);
+            stopping = true;
+        }
+        jobReady.notify_all();
+        for (unsigned int i = 0; i < workers.size(); i++)
+            workers[i].join();
+        if (face)
+            FT_Done_Face(face);
+        if (ft)
+            FT_Done_FreeType(ft);
+    }
+
+    // reads the font file and starts the workers; no glyph is rasterized here. false on error.
+    bool Load(const std::string &fontPath, unsigned int workerCount = 0)
+    {
+        std::ifstream file(fontPath.c_str(), std::ios::binary);
+        fontData.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+        if (fontData.empty())
+        {
+            std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+            return false;
+        }
+
+        // FreeType faces aren't thread safe: this one only answers advance queries on the render thread
+        // All functions return a value different than 0 whenever an error occurred
+        if (FT_Init_FreeType(&ft))
+        {
+            ft = NULL;
+            std::cout << "ERROR::FREETYPE: Could not init FreeType Library" << std::endl;
+            return false;
+        }
+        if (FT_New_Memory_Face(ft, &fontData[0], static_cast<FT_Long>(fontData.size()), 0, &face))
+        {
+            face = NULL;
+            std::cout << "ERROR::FREETYPE: Failed to load font" << std::endl;
+            return false;
+        }
+        FT_Set_Pixel_Sizes(face, 0, SDF_BASE_SIZE * SDF_UPSCALE);
+        lineHeight = face->size->metrics.height / 64.0f / SDF_UPSCALE;
+
+        // empty atlas, 0 is "far outside" in the distance field encoding
+        std::vector<unsigned char> clear(SDF_ATLAS_SIZE * SDF_ATLAS_SIZE, 0);
+        glGenTextures(1, &AtlasID);
+        glState().BindTexture(0, GL_TEXTURE_2D, AtlasID);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1); // disable byte-alignment restriction
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, SDF_ATLAS_SIZE, SDF_ATLAS_SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, &clear[0]);
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        int cells = SDF_ATLAS_SIZE / SDF_CELL;
+        for (int i = cells * cells - 1; i >= 0; i--)
+            freeCells.push_back(i);
+
+        // the attribute pointers are set at Flush(), once the frame's batch has an offset
+        glGenVertexArrays(1, &VAO);
+
+        if (workerCount == 0)
+        {
+            unsigned int cores = std::thread::hardware_concurrency();
+            workerCount = cores > 2 ? std::min(cores - 1, 4u) : 1;
+        }
+        for (unsigned int i = 0; i < workerCount; i++)
+            workers.push_back(std::thread(&TextRenderer::workerLoop, this));
+        return true;
+    }
+
+    // appends a UTF-8 string, size pixels high, to this frame's batch; nothing is drawn until Flush().
+    // Laid out every call: meant for text that changes, use a TextLayout for text that doesn't.
+    void AddText(const std::string &text, float x, float y, float size, glm::vec3 color, float maxWidth = 0.0f)
+    {
+        uploadFinished();
+        layoutText(text, x, y, size, color, maxWidth, vertices, NULL);
+    }
+
+    // appends a retained layout, laying it out again only if it is stale
+    void AddText(TextLayout &layout)
+    {
+        uploadFinished();
+        bool stale = layout.dirty || layout.evictVersion != evictVersion || (layout.missing > 0 && layout.uploadVersion != uploadVersion);
+        if (stale)
+        {
+            layout.vertices.clear();
+            layout.glyphs.clear();
+            layout.missing = layoutText(layout.text, layout.x, layout.y, layout.size, layout.color, layout.maxWidth, layout.vertices, &layout.glyphs);
+            std::sort(layout.glyphs.begin(), layout.glyphs.end());
+            layout.glyphs.erase(std::unique(layout.glyphs.begin(), layout.glyphs.end()), layout.glyphs.end());
+            layout.dirty = false;
+            layout.uploadVersion = uploadVersion;
+            layout.evictVersion = evictVersion;
+            stats.layouts++;
+        }
+        else
+        {
+            // no eviction since the layout was built, so its entries are all still alive
+            for (unsigned int i = 0; i < layout.glyphs.size(); i++)
+                touch(*layout.glyphs[i]);
+        }
+        vertices.insert(vertices.end(), layout.vertices.begin(), layout.vertices.end());
+    }
+
+    // uploads the frame's text through the stream buffer and draws it with one call
+    void Flush(Shader &shader, StreamBuffer &stream)
+    {
+        drawCalls = 0;
+        frame++;
+        if (vertices.empty())
+            return;
+        StreamAllocation batch = stream.Upload(&vertices[0], vertices.size() * sizeof(TextVertex));
+        if (batch.ptr)
+        {
+            shader.use();
+            glState().BindTexture(0, GL_TEXTURE_2D, AtlasID);
+            glState().BindVertexArray(VAO);
+            // the batch lands at a different offset every frame, so the attribute pointers follow it
+            glState().BindBuffer(GL_ARRAY_BUFFER, stream.ID);
+            glEnableVertexAttribArray(0);
+            glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (void*)batch.offset);
+            glEnableVertexAttribArray(1);
+            glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(TextVertex), (void*)(batch.offset + offsetof(TextVertex, r)));
+            glDrawArrays(GL_TRIANGLES, 0, static_cast<GLsizei>(vertices.size()));
+            drawCalls = 1;
+        }
+        vertices.clear();
+    }
+
+    // reads one code point and moves i past it; malformed bytes decode as U+FFFD
+    static unsigned int DecodeUTF8(const std::string &text, size_t &i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i++]);
+        int extra = c < 0x80 ? 0 : c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+        if (extra < 0)
+            return 0xFFFD;
+        unsigned int codepoint = extra == 0 ? c : c & (0x3F >> extra);
+        for (int k = 0; k < extra; k++, i++)
+        {
+            if (i >= text.size() || (static_cast<unsigned char>(text[i]) & 0xC0) != 0x80)
+                return 0xFFFD;
+            codepoint = (codepoint << 6) | (static_cast<unsigned char>(text[i]) & 0x3F);
+        }
+        return codepoint;
+    }
+
+private:
+    FT_Library ft;
+    FT_Face face;
+    float lineHeight; // baseline to baseline, in atlas pixels
+    std::vector<unsigned char> fontData;
+    unsigned int VAO;
+    unsigned int frame;
+    std::vector<TextVertex> vertices;
+
+    // glyph cache, render thread only: a flat table for ASCII and Latin-1, a hash map for the rest. Entries don't
+    // move while they live, TextLayouts keep pointers to them
+    GlyphEntry latin1[256];
+    bool latin1Known[256];
+    std::unordered_map<unsigned int, GlyphEntry> otherGlyphs;
+    std::list<unsigned int> resident; // glyphs holding a cell, most recently used first
+    std::vector<int> freeCells;
+    std::vector<GlyphBitmap> waiting; // generated, but every cell is in use this frame
+    unsigned int uploadVersion;       // bumped when glyphs are added to the atlas
+    unsigned int evictVersion;        // bumped when glyphs are dropped from it
+
+    // worker queues
+    std::vector<std::thread> workers;
+    std::mutex jobMutex, resultMutex;
+    std::condition_variable jobReady;
+    std::deque<unsigned int> jobs;
+    std::vector<GlyphBitmap> results;
+    bool stopping;
+
+    // looks the glyph up, queues its generation the first time it is seen
+    GlyphEntry &request(unsigned int codepoint)
+    {
+        GlyphEntry *known = find(codepoint);
+        if (!known)
+        {
+            GlyphEntry entry;
+            entry.index = FT_Get_Char_Index(face, codepoint);
+            entry.cell = -1;
+            entry.pending = true;
+            entry.metrics.Size = entry.metrics.Bearing = glm::vec2(0.0f);
+            // the advance is cheap to get and keeps the layout stable while the glyph is generated
+            FT_Fixed advance = 0;
+            FT_Get_Advance(face, entry.index, FT_LOAD_NO_HINTING, &advance);
+            entry.metrics.Advance = advance / 65536.0f / SDF_UPSCALE;
+            if (codepoint < 256)
+            {
+                latin1[codepoint] = entry;
+                latin1Known[codepoint] = true;
+                known = &latin1[codepoint];
+            }
+            else
+                known = &otherGlyphs.insert(std::make_pair(codepoint, entry)).first->second;
+            {
+                std::lock_guard<std::mutex> lock(jobMutex);
+                jobs.push_back(codepoint);
+            }
+            jobReady.notify_one();
+            stats.pending++;
+        }
+        touch(*known);
+        return *known;
+    }
+
+    // the cache entry of codepoint, NULL if it was never requested or has been evicted
+    GlyphEntry *find(unsigned int codepoint)
+    {
+        if (codepoint < 256)
+            return latin1Known[codepoint] ? &latin1[codepoint] : NULL;
+        std::unordered_map<unsigned int, GlyphEntry>::iterator it = otherGlyphs.find(codepoint);
+        return it == otherGlyphs.end() ? NULL : &it->second;
+    }
+
+    // marks the glyph as on screen this frame
+    void touch(GlyphEntry &entry)
+    {
+        entry.lastUsed = frame;
+        if (entry.cell >= 0)
+            resident.splice(resident.begin(), resident, entry.lru);
+    }
+
+    // lays text out into out, starting at the baseline of its first line. used, if not NULL, collects
+    // the glyph entries. Returns how many glyphs were still being generated.
+    unsigned int layoutText(const std::string &text, float x, float y, float size, glm::vec3 color, float maxWidth,
+                            std::vector<TextVertex> &out, std::vector<GlyphEntry*> *used)
+    {
+        float scale = size / SDF_BASE_SIZE;
+        float lineStep = lineHeight * scale;
+        unsigned char r = static_cast<unsigned char>(glm::clamp(color.r, 0.0f, 1.0f) * 255.0f);
+        unsigned char g = static_cast<unsigned char>(glm::clamp(color.g, 0.0f, 1.0f) * 255.0f);
+        unsigned char b = static_cast<unsigned char>(glm::clamp(color.b, 0.0f, 1.0f) * 255.0f);
+        bool kerning = FT_HAS_KERNING(face) != 0;
+
+        unsigned int missing = 0, previous = 0;
+        float penX = x, penY = y;
+        // last place the current line can be broken: right after a space
+        bool canBreak = false;
+        size_t breakVertex = 0;
+        float breakX = 0.0f;
+        for (size_t i = 0; i < text.size(); )
+        {
+            unsigned int codepoint = DecodeUTF8(text, i);
+            if (codepoint == '\n')
+            {
+                penX = x;
+                penY -= lineStep;
+                previous = 0;
+                canBreak = false;
+                continue;
+            }
+            GlyphEntry &entry = request(codepoint);
+            if (used)
+                used->push_back(&entry);
+            if (entry.pending)
+                missing++;
+            const Glyph &ch = entry.metrics;
+            if (kerning && previous && entry.index)
+            {
+                FT_Vector delta;
+                FT_Get_Kerning(face, previous, entry.index, FT_KERNING_UNFITTED, &delta);
+                penX += delta.x / 64.0f / SDF_UPSCALE * scale;
+            }
+            previous = entry.index;
+
+            if (codepoint == ' ')
+            {
+                penX += ch.Advance * scale;
+                canBreak = true;
+                breakVertex = out.size();
+                breakX = penX;
+                continue;
+            }
+            // the word doesn't fit: move what was laid out of it since the last space to a new line
+            if (maxWidth > 0.0f && canBreak && penX + ch.Advance * scale - x > maxWidth)
+            {
+                float shift = breakX - x;
+                for (size_t v = breakVertex; v < out.size(); v++)
+                {
+                    out[v].x -= shift;
+                    out[v].y -= lineStep;
+                }
+                penX -= shift;
+                penY -= lineStep;
+                canBreak = false;
+            }
+
+            if (entry.cell >= 0)
+            {
+                float xpos = penX + ch.Bearing.x * scale;
+                float ypos = penY - (ch.Size.y - ch.Bearing.y) * scale;
+                float w = ch.Size.x * scale;
+                float h = ch.Size.y * scale;
+                TextVertex quad[6] = {
+                    { xpos,     ypos + h, ch.UVMin.x, ch.UVMin.y, r, g, b, 255 },
+                    { xpos,     ypos,     ch.UVMin.x, ch.UVMax.y, r, g, b, 255 },
+                    { xpos + w, ypos,     ch.UVMax.x, ch.UVMax.y, r, g, b, 255 },
+
+                    { xpos,     ypos + h, ch.UVMin.x, ch.UVMin.y, r, g, b, 255 },
+                    { xpos + w, ypos,     ch.UVMax.x, ch.UVMax.y, r, g, b, 255 },
+                    { xpos + w, ypos + h, ch.UVMax.x, ch.UVMin.y, r, g, b, 255 }
+                };
+                out.insert(out.end(), quad, quad + 6);
+            }
+            // now advance cursors for next glyph
+            penX += ch.Advance * scale;
+        }
+        return missing;
+    }
+
+    // moves finished distance fields into the atlas
+    void uploadFinished()
+    {
+        {
+            std::lock_guard<std::mutex> lock(resultMutex);
+            if (results.empty() && waiting.empty())
+                return;
+            waiting.insert(waiting.end(), results.begin(), results.end());
+            results.clear();
+        }
+
+        std::vector<GlyphBitmap> stillWaiting;
+        for (unsigned int i = 0; i < waiting.size(); i++)
+        {
+            GlyphBitmap &bitmap = waiting[i];
+            GlyphEntry &entry = *find(bitmap.codepoint);
+            if (bitmap.width == 0)
+            {
+                // blank or missing glyph: nothing to store, the entry stays as an advance
+                entry.pending = false;
+                uploadVersion++;
+                stats.generated++;
+                stats.pending--;
+                continue;
+            }
+            int cell = allocateCell();
+            if (cell < 0)
+            {
+                stillWaiting.push_back(bitmap);
+                continue;
+            }
+            int cells = SDF_ATLAS_SIZE / SDF_CELL;
+            int cx = (cell % cells) * SDF_CELL, cy = (cell / cells) * SDF_CELL;
+            glState().BindTexture(0, GL_TEXTURE_2D, AtlasID);
+            // the whole cell, zero padded: a cell taken from an evicted glyph still holds its texels, and linear
+            // filtering at UVMax would blend them in
+            std::vector<unsigned char> block(SDF_CELL * SDF_CELL, 0);
+            for (int y = 0; y < bitmap.height; y++)
+                std::copy(bitmap.pixels.begin() + y * bitmap.width, bitmap.pixels.begin() + (y + 1) * bitmap.width, block.begin() + y * SDF_CELL);
+            glTexSubImage2D(GL_TEXTURE_2D, 0, cx, cy, SDF_CELL, SDF_CELL, GL_RED, GL_UNSIGNED_BYTE, &block[0]);
+
+            // keep the advance the layout already used
+            float advance = entry.metrics.Advance;
+            entry.metrics = bitmap.metrics;
+            entry.metrics.Advance = advance;
+            entry.metrics.UVMin = glm::vec2(cx, cy) / static_cast<float>(SDF_ATLAS_SIZE);
+            entry.metrics.UVMax = glm::vec2(cx + bitmap.width, cy + bitmap.height) / static_cast<float>(SDF_ATLAS_SIZE);
+            entry.cell = cell;
+            entry.pending = false;
+            uploadVersion++;
+            resident.push_front(bitmap.codepoint);
+            entry.lru = resident.begin();
+            stats.generated++;
+            stats.pending--;
+        }
+        waiting.swap(stillWaiting);
+        stats.resident = static_cast<unsigned int>(resident.size());
+    }
+
+    // a free cell, or the cell of the least recently used glyph not drawn this frame; -1 if none
+    int allocateCell()
+    {
+        if (!freeCells.empty())
+        {
+            int cell = freeCells.back();
+            freeCells.pop_back();
+            return cell;
+        }
+        if (resident.empty())
+            return -1;
+        unsigned int codepoint = resident.back();
+        GlyphEntry *victim = find(codepoint);
+        if (victim->lastUsed == frame)
+            return -1;
+        int cell = victim->cell;
+        resident.pop_back();
+        if (codepoint < 256)
+            latin1Known[codepoint] = false;
+        else
+            otherGlyphs.erase(codepoint);
+        evictVersion++;
+        stats.evictions++;
+        return cell;
+    }
+
+    void workerLoop()
+    {
+        // every worker rasterizes with its own FreeType instance
+        FT_Library library;
+        FT_Face workerFace = NULL;
+        if (!FT_Init_FreeType(&library))
+        {
+            if (FT_New_Memory_Face(library, &fontData[0], static_cast<FT_Long>(fontData.size()), 0, &workerFace))
+                workerFace = NULL;
+            else
+                FT_Set_Pixel_Sizes(workerFace, 0, SDF_BASE_SIZE * SDF_UPSCALE);
+        }
+        else
+            library = NULL;
+
+        for (;;)
+        {
+            unsigned int codepoint;
+            {
+                std::unique_lock<std::mutex> lock(jobMutex);
+                while (jobs.empty() && !stopping)
+                    jobReady.wait(lock);
+                if (stopping)
+                    break;
+                codepoint = jobs.front();
+                jobs.pop_front();
+            }
+            // a failed glyph comes back blank, so it isn't requested again
+            GlyphBitmap bitmap;
+            if (!workerFace || !GenerateGlyphSDF(workerFace, codepoint, bitmap))
+            {
+                bitmap.codepoint = codepoint;
+                bitmap.width = bitmap.height = 0;
+                bitmap.metrics.Advance = 0.0f;
+                bitmap.pixels.clear();
+            }
+            std::lock_guard<std::mutex> lock(resultMutex);
+            results.push_back(bitmap);
+        }
+
+        if (workerFace)
+            FT_Done_Face(workerFace);
+        if (library)
+            FT_Done_FreeType(library);
+    }
+};
+#endif
@@ -0,0 +1,96 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include "glad.h" // holds all OpenGL type declarations
+
+#include <vector>
+#include <cstring>
+
+struct UniformBufferStats {
+    unsigned int uploads;        // glBufferSubData calls of the last Update()
+    GLsizeiptr bytesLastUpdate;  // bytes they sent
+};
+
+// A std140 uniform block holding an array of T, e.g. every light or material of a scene.
+//
+// T must follow std140 rules by itself, with the padding spelled out as members so Set() can
+// compare whole elements: a vec3 followed by a float packs into 16 bytes, a lone vec3 or float
+// still takes 16, and the size is a multiple of 16 so the C++ array stride matches the block's. Set() only flags an
+// element dirty when its bytes actually change and Update() uploads the dirty runs, so a frame in
+// which nothing moved sends nothing at all.
+template <typename T>
+class UniformArrayBuffer
+{
+public:
+    unsigned int ID;
+    UniformBufferStats stats;
+
+    UniformArrayBuffer(unsigned int count) : ID(0), items(count), dirty(count, true)
+    {
+        static_assert(sizeof(T) % 16 == 0, "std140 array elements are padded to 16 bytes");
+        stats.uploads = 0;
+        stats.bytesLastUpdate = 0;
+        std::memset((void*)&items[0], 0, count * sizeof(T));
+
+        // plain glBindBuffer: glBindBufferBase also moves the GL_UNIFORM_BUFFER binding, behind glState()'s back
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, count * sizeof(T), NULL, GL_DYNAMIC_DRAW);
+    }
+
+    unsigned int Size() const { return static_cast<unsigned int>(items.size()); }
+    const T& operator[](unsigned int index) const { return items[index]; }
+
+    void Set(unsigned int index, const T &value)
+    {
+        if (std::memcmp(&items[index], &value, sizeof(T)) != 0)
+        {
+            items[index] = value;
+            dirty[index] = true;
+        }
+    }
+
+    // sends the elements changed since the last call, one glBufferSubData per run of dirty elements
+    void Update()
+    {
+        stats.uploads = 0;
+        stats.bytesLastUpdate = 0;
+        unsigned int count = Size();
+        for (unsigned int first = 0; first < count; first++)
+        {
+            if (!dirty[first])
+                continue;
+            unsigned int last = first;
+            while (last + 1 < count && dirty[last + 1])
+                last++;
+            GLsizeiptr size = (last - first + 1) * sizeof(T);
+            if (stats.uploads == 0)
+                glBindBuffer(GL_UNIFORM_BUFFER, ID);
+            glBufferSubData(GL_UNIFORM_BUFFER, first * sizeof(T), size, &items[first]);
+            stats.uploads++;
+            stats.bytesLastUpdate += size;
+            for (unsigned int i = first; i <= last; i++)
+                dirty[i] = false;
+            first = last;
+        }
+    }
+
+    // once per pass; every program whose block was pointed at bindingPoint reads it from there
+    void Bind(GLuint bindingPoint) const
+    {
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+    }
+
+    // once per program, after linking
+    static void BindBlock(unsigned int program, const char *blockName, GLuint bindingPoint)
+    {
+        GLuint index = glGetUniformBlockIndex(program, blockName);
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(program, index, bindingPoint);
+    }
+
+private:
+    std::vector<T> items;
+    std::vector<bool> dirty;
+};
+#endif